@@ -0,0 +1,354 @@
+"""Static cost estimate for the GLSL shaders under src/.
+
+Counts, per shader invocation, texture fetches, transcendental ops and matrix
+inverses, multiplying through loops with constant trip counts and calls into
+user functions. Both sides of a branch are counted, so totals are upper bounds;
+loops bounded by a uniform count a single iteration and are listed as such.
+
+Writes JSON. Given a baseline written by an earlier run, exits non-zero when a
+shader got more expensive.
+
+Eg:
+    python python/shader_cost.py --output build/shader_cost.json
+    python python/shader_cost.py -D NR_POINT_LIGHTS=8 src/2.7.10.permutations.frag
+    python python/shader_cost.py --baseline old.json --output new.json
+"""
+
+import argparse
+import json
+import re
+import sys
+from collections import Counter
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+
+STAGES = {".vert": "vertex", ".frag": "fragment", ".geom": "geometry", ".comp": "compute"}
+
+TEXTURE_FETCHES = {
+    "texture", "texture2D", "textureLod", "textureOffset", "textureProj", "textureGrad",
+    "textureGather", "texelFetch", "texelFetchOffset", "imageLoad",
+}
+TRANSCENDENTALS = {
+    "exp", "exp2", "log", "log2", "pow", "sqrt", "inversesqrt", "sin", "cos", "tan",
+    "asin", "acos", "atan", "sinh", "cosh", "tanh", "normalize", "length", "distance",
+}
+MATRIX_INVERSES = {"inverse", "determinant"}
+
+# rough relative costs -- only the trend between runs matters
+WEIGHTS = {"texture_fetches": 4.0, "transcendentals": 2.0, "matrix_inverses": 32.0}
+
+TOKEN_RE = re.compile(r"[A-Za-z_]\w*|\d+\.?\d*(?:[eE][-+]?\d+)?[uUfF]?|\.\d+|\S")
+DEFINE_RE = re.compile(r"^\s*#\s*define\s+(\w+)\s+(.+?)\s*$")
+CONST_RE = re.compile(r"\bconst\s+u?int\s+(\w+)\s*=\s*([^;]+);")
+FOR_INIT_RE = re.compile(r"^\s*(?:u?int\s+)?(\w+)\s*=\s*(.+)$")
+FOR_COND_RE = re.compile(r"^\s*(\w+)\s*(<=|<|>=|>)\s*(.+?)\s*(?:&&.*|\|\|.*)?$")
+FOR_STEP_RE = re.compile(r"^\s*(?:\+\+(\w+)|(\w+)\+\+|--(\w+)|(\w+)--|(\w+)\s*([-+])=\s*(.+))$")
+
+
+def strip_comments(src):
+    """comments replaced by whitespace, keeping line numbers."""
+    src = re.sub(r"/\*.*?\*/", lambda m: re.sub(r"[^\n]", " ", m.group(0)), src, flags=re.S)
+    return re.sub(r"//[^\n]*", "", src)
+
+
+def evaluate(expr, constants):
+    """value of an integer expression over literals and known constants, else None."""
+    expr = re.sub(r"\b(\d+)[uU]\b", r"\1", expr)
+    names = set(re.findall(r"[A-Za-z_]\w*", expr))
+    if not names <= constants.keys() or not re.fullmatch(r"[\w\s+\-*/%()]*", expr):
+        return None
+    for name in names:
+        expr = re.sub(rf"\b{name}\b", f"({constants[name]})", expr)
+    try:
+        return int(eval(expr.replace("/", "//"), {"__builtins__": {}}))
+    except (SyntaxError, ZeroDivisionError, TypeError):
+        return None
+
+
+def trip_count(header, constants):
+    """iterations of a for loop given the text between its parentheses, else None."""
+    parts = header.split(";")
+    if len(parts) != 3:
+        return None
+    init, cond, step = (FOR_INIT_RE.match(parts[0]), FOR_COND_RE.match(parts[1]),
+                        FOR_STEP_RE.match(parts[2]))
+    if not (init and cond and step):
+        return None
+    start = evaluate(init.group(2), constants)
+    bound = evaluate(cond.group(3), constants)
+    if start is None or bound is None:
+        return None
+    if step.group(1) or step.group(2):
+        stride = 1
+    elif step.group(3) or step.group(4):
+        stride = -1
+    else:
+        stride = evaluate(step.group(7), constants)
+        if stride is None:
+            return None
+        stride = stride if step.group(6) == "+" else -stride
+    op = cond.group(2)
+    span = {"<": bound - start, "<=": bound - start + 1,
+            ">": start - bound, ">=": start - bound + 1}[op]
+    if span <= 0:
+        return 0
+    if (stride > 0) != (op in ("<", "<=")):
+        return None  # never terminates, or not the loop variable we think it is
+    return -(-span // abs(stride))
+
+
+def tokenize(src):
+    """tokens as (text, line), preprocessor lines dropped."""
+    tokens = []
+    for lineno, line in enumerate(src.split("\n"), 1):
+        if line.lstrip().startswith("#"):
+            continue
+        tokens.extend((text, lineno) for text in TOKEN_RE.findall(line))
+    return tokens
+
+
+def text_of(tokens):
+    """tokens rejoined, spaced only where two words would run together."""
+    res = ""
+    for text, _ in tokens:
+        if res and re.match(r"\w", res[-1]) and re.match(r"\w", text):
+            res += " "
+        res += text
+    return res
+
+
+def matching(tokens, i):
+    """index of the bracket closing the one at tokens[i]."""
+    pair = {"(": ")", "{": "}", "[": "]"}[tokens[i][0]]
+    depth = 0
+    for j in range(i, len(tokens)):
+        if tokens[j][0] == tokens[i][0]:
+            depth += 1
+        elif tokens[j][0] == pair:
+            depth -= 1
+            if depth == 0:
+                return j
+    raise ValueError(f"unbalanced {tokens[i][0]} on line {tokens[i][1]}")
+
+
+def arguments(tokens, open_paren, close_paren):
+    """source text of each call argument."""
+    args, current, depth = [], [], 0
+    for token in tokens[open_paren + 1 : close_paren]:
+        if token[0] in "([{":
+            depth += 1
+        elif token[0] in ")]}":
+            depth -= 1
+        if token[0] == "," and depth == 0:
+            args.append(current)
+            current = []
+        else:
+            current.append(token)
+    args.append(current)
+    return [text_of(arg) for arg in args]
+
+
+def functions(tokens):
+    """body token ranges of the function definitions, by name."""
+    res = {}
+    i = 0
+    while i < len(tokens):
+        text = tokens[i][0]
+        if text == "{":
+            i = matching(tokens, i) + 1  # struct or interface block
+            continue
+        if text == "(" and i >= 2 and re.match(r"\w", tokens[i - 2][0]):
+            close = matching(tokens, i)
+            if close + 1 < len(tokens) and tokens[close + 1][0] == "{":
+                end = matching(tokens, close + 1)
+                res[tokens[i - 1][0]] = (close + 2, end)
+                i = end + 1
+                continue
+            i = close + 1
+            continue
+        i += 1
+    return res
+
+
+class Cost:
+    def __init__(self):
+        self.counts = Counter()
+        self.fetches = Counter()  # (sampler, coordinate) -> count
+        self.calls = Counter()  # user function -> count
+
+    def add(self, other, mult):
+        for key, value in other.counts.items():
+            self.counts[key] += mult * value
+        for key, value in other.fetches.items():
+            self.fetches[key] += mult * value
+
+
+def analyze_body(tokens, begin, end, constants, loops, function):
+    """direct cost of tokens[begin:end] and its calls, multiplied through loops."""
+    cost = Cost()
+    frames = []  # (multiplier, close brace index or None for a single statement, depth)
+    depth = 0
+    pending = None  # multiplier for the statement following a loop header
+
+    def multiplier():
+        res = 1
+        for mult, _, _ in frames:
+            res *= mult
+        return res
+
+    i = begin
+    while i < end:
+        text, line = tokens[i]
+        if pending is not None:
+            if text == "{":
+                frames.append((pending, matching(tokens, i), depth + 1))
+            else:
+                frames.append((pending, None, depth))
+            pending = None
+        if text in ("for", "while") and tokens[i + 1][0] == "(":
+            close = matching(tokens, i + 1)
+            header = text_of(tokens[i + 2 : close])
+            trips = trip_count(header, constants) if text == "for" else None
+            loops.append({"line": line, "function": function, "header": header,
+                          "trips": trips})
+            pending = 1 if trips is None else trips
+            i = close + 1
+            continue
+        if text == "{":
+            depth += 1
+        elif text == "}":
+            depth -= 1
+            while frames and frames[-1][1] == i:
+                frames.pop()
+        elif text == ";":
+            while frames and frames[-1][1] is None and frames[-1][2] == depth:
+                frames.pop()
+        elif re.match(r"[A-Za-z_]", text) and tokens[i + 1][0] == "(" and \
+                (i == begin or tokens[i - 1][0] != "."):
+            mult = multiplier()
+            if text in TEXTURE_FETCHES:
+                cost.counts["texture_fetches"] += mult
+                args = arguments(tokens, i + 1, matching(tokens, i + 1))
+                cost.fetches[(args[0], args[1] if len(args) > 1 else "")] += mult
+            elif text in TRANSCENDENTALS:
+                cost.counts["transcendentals"] += mult
+            elif text in MATRIX_INVERSES:
+                cost.counts["matrix_inverses"] += mult
+            else:
+                cost.calls[text] += mult
+        i += 1
+    return cost
+
+
+def analyze(path, defines):
+    src = strip_comments(path.read_text())
+    constants = {}
+    for line in src.split("\n"):
+        match = DEFINE_RE.match(line)
+        if match and match.group(1) not in constants:  # first of #ifndef alternatives
+            constants[match.group(1)] = match.group(2)
+    for name, value in CONST_RE.findall(src):
+        constants.setdefault(name, value)
+    constants.update(defines)
+    constants = {k: v for k, v in ((k, evaluate(v, {})) for k, v in constants.items())
+                 if v is not None}
+
+    tokens = tokenize(src)
+    bodies = functions(tokens)
+    loops = []
+    direct = {name: analyze_body(tokens, begin, end, constants, loops, name)
+              for name, (begin, end) in bodies.items()}
+
+    inclusive = {}
+
+    def total(name, stack=()):
+        if name not in inclusive:
+            if name in stack:
+                raise ValueError(f"{path}: recursion through {name}")
+            res = Cost()
+            res.add(direct[name], 1)
+            for callee, mult in direct[name].calls.items():
+                if callee in direct:  # else a constructor or builtin not worth counting
+                    res.add(total(callee, stack + (name,)), mult)
+            inclusive[name] = res
+        return inclusive[name]
+
+    cost = total("main") if "main" in direct else Cost()
+    stage = STAGES.get(path.suffix, path.suffix)
+    invocation = {"vertex": "vertex", "fragment": "fragment"}.get(stage, "invocation")
+
+    warnings = []
+    for (sampler, coord), count in sorted(cost.fetches.items()):
+        if count > 1:
+            warnings.append(f"{sampler} fetched at {coord} {count} times per "
+                            f"{invocation} -- fetch once and reuse")
+    if cost.counts["matrix_inverses"]:
+        warnings.append(f"{cost.counts['matrix_inverses']} matrix inverse(s) per "
+                        f"{invocation} -- precompute on the cpu")
+    for loop in loops:
+        if loop["trips"] is None:
+            warnings.append(f"line {loop['line']}: loop ({loop['header']}) has no constant "
+                            f"trip count -- counted as one iteration")
+
+    report = {
+        "stage": stage,
+        "texture_fetches": cost.counts["texture_fetches"],
+        "transcendentals": cost.counts["transcendentals"],
+        "matrix_inverses": cost.counts["matrix_inverses"],
+        "fetches": [{"sampler": s, "coord": c, "count": n}
+                    for (s, c), n in sorted(cost.fetches.items())],
+        "loops": loops,
+        "warnings": warnings,
+    }
+    report["cost"] = sum(WEIGHTS[k] * report[k] for k in WEIGHTS)
+    return report
+
+
+def regressions(baseline, shaders, tolerance):
+    res = []
+    for name, report in shaders.items():
+        old = baseline.get(name)
+        if old is not None and report["cost"] > old["cost"] * (1.0 + tolerance):
+            res.append(f"{name}: cost {old['cost']} -> {report['cost']}")
+    return res
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("shaders", nargs="*", type=Path,
+                        help="default: every shader under src/")
+    parser.add_argument("-D", dest="defines", action="append", default=[],
+                        metavar="NAME=VALUE", help="override a #define, eg: a permutation")
+    parser.add_argument("--output", type=Path, help="default: stdout")
+    parser.add_argument("--baseline", type=Path, help="report of an earlier run")
+    parser.add_argument("--tolerance", type=float, default=0.0,
+                        help="allowed fractional cost increase over the baseline")
+    args = parser.parse_args()
+
+    defines = dict(d.split("=", 1) if "=" in d else (d, "1") for d in args.defines)
+    paths = args.shaders or sorted(p for p in (ROOT / "src").iterdir() if p.suffix in STAGES)
+
+    shaders = {}
+    for path in paths:
+        path = path.resolve()
+        name = path.relative_to(ROOT).as_posix() if path.is_relative_to(ROOT) else str(path)
+        shaders[name] = analyze(path, defines)
+    report = json.dumps({"weights": WEIGHTS, "shaders": shaders}, indent=2)
+
+    if args.output:
+        args.output.write_text(report + "\n")
+    else:
+        print(report)
+
+    if args.baseline:
+        baseline = json.loads(args.baseline.read_text())["shaders"]
+        found = regressions(baseline, shaders, args.tolerance)
+        for line in found:
+            print(f"shader cost regression: {line}", file=sys.stderr)
+        if found:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
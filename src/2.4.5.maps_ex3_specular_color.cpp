@@ -16,6 +16,7 @@
 #include "gl_debug.h"
 #include "image.h"
 #include "shader_program.h"
+#include "texture_cache.h"
 
 #include <algorithm>
 #include <array>
@@ -40,13 +41,13 @@ struct MaterialLocs {
 };
 
 struct CubeContext {
-  unsigned int          vbo;
-  unsigned int          vao;
-  unsigned int          ebo;
-  GLuint                diffuseTexture;
-  std::array<GLuint, 3> specularTextures;
-  int                   activeSpecular;
-  GLuint                program;
+  unsigned int                        vbo;
+  unsigned int                        vao;
+  unsigned int                        ebo;
+  TextureCache::Handle                diffuseTexture;
+  std::array<TextureCache::Handle, 3> specularTextures;
+  int                                 activeSpecular;
+  GLuint                              program;
   struct Locations {
     GLint        model;
     GLint        view;
@@ -89,6 +90,7 @@ const char *lightFragmentShaderPath = "src/2.1.light_source.frag";
 
 float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
 
+TextureCache textures{};
 CubeContext  cube{};
 LightContext light{};
 
@@ -284,9 +286,9 @@ int main() {
 
     glUniformMatrix4fv(cube.locs.model, 1, GL_FALSE, glm::value_ptr(model));
     glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
-    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture.id());
     glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
-    glBindTexture(GL_TEXTURE_2D, cube.specularTextures[cube.activeSpecular]);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTextures[cube.activeSpecular].id());
     glUniform1f(cube.locs.material.shininess, 64.0f);
     glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
 
@@ -311,6 +313,7 @@ int main() {
 
   cube.cleanup();
   light.cleanup();
+  textures.cleanup();
 
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -376,41 +379,13 @@ void CubeContext::init() {
   glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
   glBindVertexArray(0);             // unbind -- for debugging
 
-  diffuseTexture = 0;
-  glGenTextures(1, &diffuseTexture);
-  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
-  stbi_set_flip_vertically_on_load(true);
-  auto diffuseImage = stb::Image("assets/container2.png");
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
-               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  specularTextures = {};
-  glGenTextures(3, specularTextures.data());
-  {
-    glBindTexture(GL_TEXTURE_2D, specularTextures[0]);
-    stbi_set_flip_vertically_on_load(true);
-    auto specularImage = stb::Image("assets/container2_specular.png");
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  {
-    glBindTexture(GL_TEXTURE_2D, specularTextures[1]);
-    stbi_set_flip_vertically_on_load(true);
-    auto specularImage = stb::Image("assets/container2_specular_color.png");
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  {
-    glBindTexture(GL_TEXTURE_2D, specularTextures[2]);
-    stbi_set_flip_vertically_on_load(true);
-    auto specularImage = stb::Image("assets/container2_specular_mycolor.png");
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
+  // through the shared cache -- loading any of these again elsewhere is a lookup
+  diffuseTexture   = textures.get("assets/container2.png");
+  specularTextures = {
+    textures.get("assets/container2_specular.png"),
+    textures.get("assets/container2_specular_color.png"),
+    textures.get("assets/container2_specular_mycolor.png"),
+  };
   activeSpecular = 0;
 }
 
@@ -441,6 +416,8 @@ void CubeContext::cleanup() {
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
   glDeleteProgram(cube.program);
+  diffuseTexture   = {};
+  specularTextures = {};
 }
 
 void LightContext::init(const CubeContext &cube) {
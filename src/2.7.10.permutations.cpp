@@ -0,0 +1,530 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "light_assignment.h"
+#include "lights.h"
+#include "shader_permutations.h"
+#include "shader_program.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+constexpr const int NR_POINT_LIGHTS = 4; // also the most any variant loops over
+constexpr const int NR_SPOT_LIGHTS  = 4;
+constexpr const int NR_CUBES        = 1000;
+
+// 2.6.1's spot lights, and 2.5.5's flashlight
+const float SPOT_COS_INNER       = glm::cos(glm::pi<float>() * 0.06f);
+const float SPOT_COS_OUTER       = glm::cos(glm::pi<float>() * 0.07f);
+const float FLASHLIGHT_COS_INNER = glm::cos(glm::pi<float>() * 0.06f);
+const float FLASHLIGHT_COS_OUTER = glm::cos(glm::pi<float>() * 0.10f);
+
+constexpr Attenuation SPOT_ATTENUATION{}; // hardcoded in 2.7.10.permutations.frag
+// stronger falloff than 2.6.1 so each point light reaches only a few cubes
+constexpr Attenuation POINT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct PointLightLocs {
+  GLint v_pos;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct SpotLightLocs {
+  GLint v_pos;
+  GLint direction;
+  GLint spotlightCosInner;
+  GLint spotlightCosOuter;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct FlashlightLocs {
+  GLint spotlightCosInner;
+  GLint spotlightCosOuter;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+// uniforms of one variant of 2.7.10.permutations.frag -- -1 where compiled out
+struct UberLocs {
+  GLint          model;
+  GLint          view;
+  GLint          projection;
+  MaterialLocs   material;
+  DirLightLocs   dirLight;
+  PointLightLocs pointLights[NR_POINT_LIGHTS];
+  GLint          pointAttenuation;
+  SpotLightLocs  spotLights[NR_SPOT_LIGHTS];
+  FlashlightLocs flashlight;
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+
+  void init();
+  void cleanup();
+};
+
+// one cube and the lights that can reach it
+struct Draw {
+  uint32_t cube;
+  uint8_t  pointMask; // bit i: point light i
+  uint8_t  spotMask;  // bit i: spot light i
+  bool     flashlight;
+
+  // variants are grouped by this, so draws sharing a program are consecutive
+  uint32_t variant() const {
+    return std::popcount(pointMask) * 16 + std::popcount(spotMask) * 2 + flashlight;
+  }
+};
+
+void      processInput(GLFWwindow *window);
+UberLocs  uberLocs(GLuint program, const ShaderDefines &defines);
+glm::mat4 cubeModel(unsigned int i);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.4.maps_texcoord_cube.vert";
+const char *cubeFragmentShaderPath = "src/2.7.10.permutations.frag";
+
+CubeContext                  cube{};
+ShaderPermutations<UberLocs> uber(cubeVertexShaderPath, cubeFragmentShaderPath, uberLocs);
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus  = true;
+bool flashlightOn = true;
+bool specializeOn = true; // G: one general variant for every draw instead
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+                         flashlightOn = !flashlightOn;
+                       }
+                       if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+                         specializeOn = !specializeOn;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+
+  // world-space lights: 2.6.1's spot lights, and point lights scattered in the grid
+  std::vector<glm::vec3> pointPoss, pointColors;
+  for (uint32_t i = 0; i < NR_POINT_LIGHTS; ++i) {
+    pointPoss.push_back(glm::vec3(whisky2f(i, 0), whisky2f(i, 1), whisky2f(i, 2)) *
+                            18.0f -
+                        glm::vec3(5.0f, 5.0f, 23.0f));
+    pointColors.push_back(
+        glm::normalize(glm::vec3(whisky2f(i, 3), whisky2f(i, 4), whisky2f(i, 5))));
+  }
+  const glm::vec3 spotPoss[NR_SPOT_LIGHTS] = {
+    glm::vec3(1.0f, 0.4f, 3.0f),
+    glm::vec3(5.0f, 0.0f, 4.0f),
+    glm::vec3(5.0f, 5.0f, 4.0f),
+    glm::vec3(5.0f, 10.0f, 4.0f),
+  };
+  const glm::vec3 spotTargets[NR_SPOT_LIGHTS] = {
+    glm::vec3(0.0f, 0.0f, 0.0f),
+    glm::vec3(0.0f, 0.0f, -20.0f),
+    glm::vec3(0.0f, 0.0f, -20.0f),
+    glm::vec3(0.0f, 0.0f, -20.0f),
+  };
+  const glm::vec3 spotColors[NR_SPOT_LIGHTS] = {
+    glm::vec3(1.0f, 0.0f, 0.0f),
+    glm::vec3(0.0f, 1.0f, 0.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f),
+    glm::vec3(1.0f, 0.0f, 0.0f),
+  };
+  float pointRange = attenuationRange(POINT_ATTENUATION);
+  float spotRange  = attenuationRange(SPOT_ATTENUATION);
+
+  std::vector<Aabb> cubeBounds;
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    Aabb unit{ .min = glm::vec3(-0.5f), .max = glm::vec3(0.5f) };
+    cubeBounds.push_back(unit.transformed(cubeModel(i)));
+  }
+
+  std::vector<Draw> draws(NR_CUBES);
+  float             titleTime  = 0.0f;
+  unsigned int      nrFrames   = 0;
+  unsigned int      nrSwitches = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      uber.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view   = camera.view();
+    float     aspect = windowWidth / (float)windowHeight;
+    projection       = glm::perspective(camera.fov, aspect, 0.1f, 100.0f);
+
+    // pick the lights reaching each cube, then sort so draws sharing a variant are
+    // consecutive
+    glm::vec3 cameraFront = camera.rayDir(glm::vec2(0.0f), aspect);
+    for (unsigned int i = 0; i < NR_CUBES; i++) {
+      Draw &draw = draws[i];
+      draw       = { .cube = i, .pointMask = 0, .spotMask = 0, .flashlight = false };
+      for (int l = 0; l < NR_POINT_LIGHTS; ++l) {
+        // cosOuter <= -1: no cone
+        LightInfluence influence{ pointPoss[l], pointRange, glm::vec3(0.0f), -2.0f };
+        if (!specializeOn || influences(influence, cubeBounds[i])) {
+          draw.pointMask |= 1 << l;
+        }
+      }
+      for (int l = 0; l < NR_SPOT_LIGHTS; ++l) {
+        LightInfluence influence{ spotPoss[l], spotRange,
+                                  glm::normalize(spotTargets[l] - spotPoss[l]),
+                                  SPOT_COS_OUTER };
+        if (!specializeOn || influences(influence, cubeBounds[i])) {
+          draw.spotMask |= 1 << l;
+        }
+      }
+      LightInfluence flashlight{ camera.pos, spotRange, cameraFront,
+                                 FLASHLIGHT_COS_OUTER };
+      draw.flashlight =
+          flashlightOn && (!specializeOn || influences(flashlight, cubeBounds[i]));
+    }
+    std::ranges::sort(draws, {}, &Draw::variant);
+
+    glBindVertexArray(cube.vao);
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+
+    auto            dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto            dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    uint32_t        lastVariant   = UINT32_MAX;
+    const UberLocs *locs          = nullptr;
+    for (const Draw &draw : draws) {
+      if (draw.variant() != lastVariant) {
+        // uniforms are per program, so each switch sets the shared ones again
+        lastVariant           = draw.variant();
+        ShaderDefines defines = {
+          { "DIR_LIGHT", 1 },
+          { "NR_POINT_LIGHTS", std::popcount(draw.pointMask) },
+          { "NR_SPOT_LIGHTS", std::popcount(draw.spotMask) },
+          { "FLASHLIGHT", draw.flashlight },
+        };
+        const auto &variant = uber.get(defines);
+        locs                = &variant.locs;
+        ++nrSwitches;
+
+        glUseProgram(variant.program);
+        glUniformMatrix4fv(locs->view, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(locs->projection, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniform1f(locs->material.shininess, 64.0f);
+
+        glUniform3f(locs->dirLight.direction, dirLightDir.x, dirLightDir.y,
+                    dirLightDir.z);
+        glUniform3f(locs->dirLight.ambient, 0.2f * dirLightColor.x,
+                    0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+        glUniform3f(locs->dirLight.diffuse, 0.5f * dirLightColor.x,
+                    0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+        glUniform3f(locs->dirLight.specular, 1.0f * dirLightColor.x,
+                    1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+        glUniform3f(locs->pointAttenuation, POINT_ATTENUATION.k0, POINT_ATTENUATION.k1,
+                    POINT_ATTENUATION.k2);
+
+        glUniform1f(locs->flashlight.spotlightCosInner, FLASHLIGHT_COS_INNER);
+        glUniform1f(locs->flashlight.spotlightCosOuter, FLASHLIGHT_COS_OUTER);
+        glUniform3f(locs->flashlight.ambient, 0.0f, 0.0f, 0.0f);
+        glUniform3f(locs->flashlight.diffuse, 0.8f, 0.8f, 0.8f);
+        glUniform3f(locs->flashlight.specular, 1.0f, 1.0f, 1.0f);
+      }
+
+      glm::mat4 model = cubeModel(draw.cube);
+      glUniformMatrix4fv(locs->model, 1, GL_FALSE, glm::value_ptr(model));
+
+      // this draw's lights fill the first slots of the arrays
+      int slot = 0;
+      for (int l = 0; l < NR_POINT_LIGHTS; ++l) {
+        if (!(draw.pointMask & (1 << l))) {
+          continue;
+        }
+        const auto &pl    = locs->pointLights[slot++];
+        glm::vec3   vPos  = view * glm::vec4(pointPoss[l], 1.0f);
+        glm::vec3   color = pointColors[l];
+        glUniform3f(pl.v_pos, vPos.x, vPos.y, vPos.z);
+        glUniform3f(pl.ambient, 0.2f * color.x, 0.2f * color.y, 0.2f * color.z);
+        glUniform3f(pl.diffuse, 0.5f * color.x, 0.5f * color.y, 0.5f * color.z);
+        glUniform3f(pl.specular, color.x, color.y, color.z);
+      }
+      slot = 0;
+      for (int l = 0; l < NR_SPOT_LIGHTS; ++l) {
+        if (!(draw.spotMask & (1 << l))) {
+          continue;
+        }
+        const auto &sl    = locs->spotLights[slot++];
+        glm::vec3   vPos  = view * glm::vec4(spotPoss[l], 1.0f);
+        glm::vec3   dir   = view * glm::vec4(spotTargets[l] - spotPoss[l], 0.0f);
+        glm::vec3   color = spotColors[l];
+        glUniform3f(sl.v_pos, vPos.x, vPos.y, vPos.z);
+        glUniform3f(sl.direction, dir.x, dir.y, dir.z);
+        glUniform1f(sl.spotlightCosInner, SPOT_COS_INNER);
+        glUniform1f(sl.spotlightCosOuter, SPOT_COS_OUTER);
+        glUniform3f(sl.ambient, 0.2f * color.x, 0.2f * color.y, 0.2f * color.z);
+        glUniform3f(sl.diffuse, 0.5f * color.x, 0.5f * color.y, 0.5f * color.z);
+        glUniform3f(sl.specular, color.x, color.y, color.z);
+      }
+
+      glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+    }
+
+    ++nrFrames;
+    if (time - titleTime > 0.5f) {
+      auto title = CURRENT_BASENAME() + " -- " +
+                   (specializeOn ? "specialized" : "general (G)") + ", " +
+                   std::to_string(uber.size()) + " variants, " +
+                   std::to_string(nrSwitches / nrFrames) + " switches/frame, " +
+                   std::to_string(1000.0f * (time - titleTime) / nrFrames) + "ms";
+      glfwSetWindowTitle(window, title.c_str());
+      titleTime  = time;
+      nrFrames   = 0;
+      nrSwitches = 0;
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  uber.cleanup();
+  cube.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    uber.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+glm::mat4 cubeModel(unsigned int i) {
+  auto gridMove =
+      2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+      glm::vec3(5.0f);
+  return glm::translate(glm::mat4(1.0f), gridMove);
+}
+
+UberLocs uberLocs(GLuint program, const ShaderDefines &defines) {
+  auto loc = [program](const std::string &name) {
+    return glGetUniformLocation(program, name.c_str());
+  };
+
+  UberLocs locs;
+  locs.model              = loc("model");
+  locs.view               = loc("view");
+  locs.projection         = loc("projection");
+  locs.material.diffuse   = loc("material.diffuse");
+  locs.material.specular  = loc("material.specular");
+  locs.material.shininess = loc("material.shininess");
+
+  locs.dirLight.direction = loc("dir_light.direction");
+  locs.dirLight.ambient   = loc("dir_light.ambient");
+  locs.dirLight.diffuse   = loc("dir_light.diffuse");
+  locs.dirLight.specular  = loc("dir_light.specular");
+
+  // compiled-out lights get -1, which glUniform* ignores
+  for (int i = 0; i < NR_POINT_LIGHTS; ++i) {
+    auto prefix                  = "point_lights[" + std::to_string(i) + "].";
+    locs.pointLights[i].v_pos    = loc(prefix + "v_pos");
+    locs.pointLights[i].ambient  = loc(prefix + "ambient");
+    locs.pointLights[i].diffuse  = loc(prefix + "diffuse");
+    locs.pointLights[i].specular = loc(prefix + "specular");
+  }
+  locs.pointAttenuation = loc("point_attenuation");
+
+  for (int i = 0; i < NR_SPOT_LIGHTS; ++i) {
+    auto prefix                          = "spot_lights[" + std::to_string(i) + "].";
+    locs.spotLights[i].v_pos             = loc(prefix + "v_pos");
+    locs.spotLights[i].direction         = loc(prefix + "direction");
+    locs.spotLights[i].spotlightCosInner = loc(prefix + "spotlight_cos_inner");
+    locs.spotLights[i].spotlightCosOuter = loc(prefix + "spotlight_cos_outer");
+    locs.spotLights[i].ambient           = loc(prefix + "ambient");
+    locs.spotLights[i].diffuse           = loc(prefix + "diffuse");
+    locs.spotLights[i].specular          = loc(prefix + "specular");
+  }
+
+  locs.flashlight.spotlightCosInner = loc("flashlight.spotlight_cos_inner");
+  locs.flashlight.spotlightCosOuter = loc("flashlight.spotlight_cos_outer");
+  locs.flashlight.ambient           = loc("flashlight.ambient");
+  locs.flashlight.diffuse           = loc("flashlight.diffuse");
+  locs.flashlight.specular          = loc("flashlight.specular");
+
+  // set constant uniforms
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  return locs;
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+}
@@ -0,0 +1,134 @@
+#version 330 core
+// Uber-shader for the 2.5.x/2.6.1 light casters. ShaderPermutations injects the
+// defines below after the #version line; the defaults only make the file compile
+// on its own (eg: in an editor).
+#ifndef DIR_LIGHT
+#define DIR_LIGHT 1
+#endif
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+#ifndef NR_SPOT_LIGHTS
+#define NR_SPOT_LIGHTS 4
+#endif
+#ifndef FLASHLIGHT
+#define FLASHLIGHT 1
+#endif
+
+out vec4 FragColor;
+
+in vec3 v_normal;
+in vec3 v_pos;
+in vec2 tex_coord;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction; // from light towards object
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 v_pos;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 v_pos;
+    vec3 direction;
+    float spotlight_cos_inner;
+    float spotlight_cos_outer;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct Flashlight {
+    float spotlight_cos_inner;
+    float spotlight_cos_outer;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Material material;
+#if DIR_LIGHT
+uniform DirLight dir_light;
+#endif
+#if NR_POINT_LIGHTS > 0
+uniform PointLight point_lights[NR_POINT_LIGHTS];
+uniform vec3 point_attenuation;
+#endif
+#if NR_SPOT_LIGHTS > 0
+uniform SpotLight spot_lights[NR_SPOT_LIGHTS];
+#endif
+#if FLASHLIGHT
+uniform Flashlight flashlight;
+#endif
+
+vec3 diffuse_color;
+vec3 specular_color;
+vec3 norm;
+vec3 camera_dir;
+
+// ambient + diffuse + specular of a light from light_dir (towards the source)
+vec3 phong(vec3 light_dir, vec3 ambient, vec3 diffuse, vec3 specular) {
+    float cos_theta = max(0.0, dot(norm, light_dir));
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), material.shininess);
+    return ambient * diffuse_color + cos_theta * diffuse * diffuse_color +
+           spec * specular * specular_color;
+}
+
+float attenuation(float d_2, vec3 k) {
+    float d = sqrt(d_2);
+    return 1.0/(k.x + k.y * d + k.z * d_2);
+}
+
+void main() {
+    diffuse_color = vec3(texture(material.diffuse, tex_coord));
+    specular_color = vec3(texture(material.specular, tex_coord));
+    norm = normalize(v_normal);
+    camera_dir = normalize(-v_pos);
+
+    vec3 res = vec3(0.0);
+#if DIR_LIGHT
+    res += phong(normalize(-dir_light.direction), dir_light.ambient, dir_light.diffuse,
+                 dir_light.specular);
+#endif
+#if NR_POINT_LIGHTS > 0
+    for (int i = 0; i < NR_POINT_LIGHTS; ++i) {
+        PointLight light = point_lights[i];
+        vec3 to_light = light.v_pos - v_pos;
+        res += attenuation(dot(to_light, to_light), point_attenuation) *
+               phong(normalize(to_light), light.ambient, light.diffuse, light.specular);
+    }
+#endif
+#if NR_SPOT_LIGHTS > 0
+    for (int i = 0; i < NR_SPOT_LIGHTS; ++i) {
+        SpotLight light = spot_lights[i];
+        vec3 to_light = light.v_pos - v_pos;
+        vec3 light_dir = normalize(to_light);
+        float cos_theta_spotlight = dot(light_dir, -normalize(light.direction));
+        res += attenuation(dot(to_light, to_light), vec3(1.0, 0.009, 0.0032)) *
+               smoothstep(light.spotlight_cos_outer, light.spotlight_cos_inner, cos_theta_spotlight) *
+               phong(light_dir, light.ambient, light.diffuse, light.specular);
+    }
+#endif
+#if FLASHLIGHT
+    // held at the camera, pointing down -z
+    float cos_theta_flashlight = dot(vec3(0.0, 0.0, -1.0), -camera_dir);
+    res += attenuation(dot(v_pos, v_pos), vec3(1.0, 0.009, 0.0032)) *
+           smoothstep(flashlight.spotlight_cos_outer, flashlight.spotlight_cos_inner, cos_theta_flashlight) *
+           phong(camera_dir, flashlight.ambient, flashlight.diffuse, flashlight.specular);
+#endif
+    FragColor = vec4(res, 1.0);
+}
@@ -0,0 +1,475 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "cube_info.h"
+#include "dynamic_resolution.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "lights.h"
+#include "shader_program.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+constexpr GLuint LIGHTS_BINDING = 0;
+
+constexpr const int MAX_LIGHTS = 256; // keep in sync with 2.7.11.dynamic_resolution.frag
+constexpr const int NR_CUBES   = 1000;
+
+constexpr float FRAME_BUDGET_MS = 1000.0f / 60.0f; // scene pass only
+constexpr float MIN_SCALE       = 0.5f;
+
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+// offscreen target the scene renders into -- allocated at window size, of which only
+// the bottom-left scale * size corner is drawn each frame
+struct Framebuffer {
+  GLuint       fbo;
+  GLuint       colorTexture;
+  GLuint       depthTexture;
+  unsigned int width;
+  unsigned int height;
+
+  void init(unsigned int width, unsigned int height);
+  void cleanup();
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  unsigned int instanceVbo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       lightsUbo;
+  GLuint       program;
+  struct Locations {
+    GLint        view;
+    GLint        projection;
+    MaterialLocs material;
+    DirLightLocs dirLight;
+    GLint        attenuation;
+    GLint        nrLights;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.7.11.dynamic_resolution.vert";
+const char *cubeFragmentShaderPath = "src/2.7.11.dynamic_resolution.frag";
+
+CubeContext cube{};
+Framebuffer framebuffer{};
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+bool dynamic     = true; // adjust the render scale, else render at full size
+int  nrLights    = 32;   // the load -- every fragment shades every light
+
+glm::vec3 cubePos(unsigned int i) {
+  return 2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+         glm::vec3(5.0f);
+}
+
+// lights scattered through the cube grid, as in 2.7.8.light_lists
+std::vector<GpuSpotLight> makeLights(const glm::mat4 &view) {
+  float                     range = attenuationRange(LIGHT_ATTENUATION);
+  std::vector<GpuSpotLight> res(MAX_LIGHTS);
+  for (uint32_t i = 0; i < MAX_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    bool      isSpot   = i % 2 == 0;
+    glm::vec3 pos      = rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f);
+    glm::vec3 dir      = glm::normalize(rand3(1) - glm::vec3(0.5f));
+    glm::vec3 viewPos  = view * glm::vec4(pos, 1.0f);
+    glm::vec3 viewDir  = view * glm::vec4(dir, 0.0f);
+    float     cosOuter = isSpot ? COS_OUTER : POINT_COS_OUTER;
+    float     cosInner = isSpot ? COS_INNER : POINT_COS_INNER;
+    res[i]             = {
+                  .vPosRange         = glm::vec4(viewPos, range),
+                  .directionCosOuter = glm::vec4(viewDir, cosOuter),
+                  .colorCosInner     = glm::vec4(glm::normalize(rand3(2)), cosInner),
+    };
+  }
+  return res;
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (action != GLFW_PRESS) {
+                         return;
+                       }
+                       if (key == GLFW_KEY_V) {
+                         dynamic = !dynamic;
+                       } else if (key == GLFW_KEY_UP) {
+                         nrLights = std::min(2 * nrLights, MAX_LIGHTS);
+                       } else if (key == GLFW_KEY_DOWN) {
+                         nrLights = std::max(nrLights / 2, 1);
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+  cube.reload();
+
+  GpuTimer timer;
+  timer.init();
+  ResolutionController controller(FRAME_BUDGET_MS, MIN_SCALE);
+
+  float titleTime = 0.0f;
+  float gpuMs     = 0.0f;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      cube.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    if (framebuffer.width != windowWidth || framebuffer.height != windowHeight) {
+      framebuffer.cleanup();
+      framebuffer.init(windowWidth, windowHeight);
+    }
+
+    // results are a few frames old: the controller is told the scale they were
+    // measured at
+    if (auto sample = timer.poll()) {
+      gpuMs = sample->ms;
+      controller.update(sample->ms, sample->scale);
+    }
+    float        scale        = dynamic ? controller.scale() : 1.0f;
+    unsigned int renderWidth  = std::max(1u, (unsigned int)(windowWidth * scale));
+    unsigned int renderHeight = std::max(1u, (unsigned int)(windowHeight * scale));
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 100.0f);
+
+    auto gpuLights = makeLights(view);
+    glBindBuffer(GL_UNIFORM_BUFFER, cube.lightsUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GpuSpotLight) * nrLights,
+                    gpuLights.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // scene pass, into the scaled corner of the offscreen target
+    timer.begin(scale);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+    glViewport(0, 0, renderWidth, renderHeight);
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(cube.program);
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(cube.locs.attenuation, LIGHT_ATTENUATION.k0, LIGHT_ATTENUATION.k1,
+                LIGHT_ATTENUATION.k2);
+    glUniform1i(cube.locs.nrLights, nrLights);
+
+    auto dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    glUniform3f(cube.locs.dirLight.direction, dirLightDir.x, dirLightDir.y,
+                dirLightDir.z);
+    glUniform3f(cube.locs.dirLight.ambient, 0.2f * dirLightColor.x,
+                0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.diffuse, 0.5f * dirLightColor.x,
+                0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.specular, 1.0f * dirLightColor.x,
+                1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+    glUniform1f(cube.locs.material.shininess, 64.0f);
+
+    glDrawElementsInstanced(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0,
+                            NR_CUBES);
+    timer.end();
+
+    // upscale to the window, filtering between the scaled texels
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (time - titleTime > 0.5f) {
+      titleTime  = time;
+      auto title = CURRENT_BASENAME() + " -- scale " +
+                   std::to_string((int)(100.0f * scale)) + "%, gpu " +
+                   std::to_string(gpuMs) + "ms, " + std::to_string(nrLights) +
+                   " lights" + (dynamic ? "" : " (fixed)");
+      glfwSetWindowTitle(window, title.c_str());
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  timer.cleanup();
+  framebuffer.cleanup();
+  cube.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void Framebuffer::init(unsigned int width_, unsigned int height_) {
+  width  = width_;
+  height = height_;
+
+  colorTexture = 0;
+  glGenTextures(1, &colorTexture);
+  glBindTexture(GL_TEXTURE_2D, colorTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  depthTexture = 0;
+  glGenTextures(1, &depthTexture);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  fbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         colorTexture, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture,
+                         0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "framebuffer incomplete" << std::endl;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::cleanup() {
+  glDeleteFramebuffers(1, &fbo); // 0 silently ignored
+  glDeleteTextures(1, &colorTexture);
+  glDeleteTextures(1, &depthTexture);
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  std::vector<glm::vec3> offsets(NR_CUBES);
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    offsets[i] = cubePos(i);
+  }
+  instanceVbo = 0;
+  glGenBuffers(1, &instanceVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * NR_CUBES, offsets.data(),
+               GL_STATIC_DRAW);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(3);
+  glVertexAttribDivisor(3, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  lightsUbo = 0;
+  glGenBuffers(1, &lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, lightsUbo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuSpotLight) * MAX_LIGHTS, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, cubeFragmentShaderPath);
+
+  // get uniform locations
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.dirLight.direction = glGetUniformLocation(program, "dir_light.direction");
+  locs.dirLight.ambient   = glGetUniformLocation(program, "dir_light.ambient");
+  locs.dirLight.diffuse   = glGetUniformLocation(program, "dir_light.diffuse");
+  locs.dirLight.specular  = glGetUniformLocation(program, "dir_light.specular");
+  locs.attenuation        = glGetUniformLocation(program, "attenuation");
+  locs.nrLights           = glGetUniformLocation(program, "nr_lights");
+
+  // set constant uniforms
+  glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Lights"),
+                        LIGHTS_BINDING);
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &instanceVbo);
+  glDeleteBuffers(1, &lightsUbo);
+  glDeleteProgram(program);
+}
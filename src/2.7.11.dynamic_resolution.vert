@@ -0,0 +1,20 @@
+#version 330 core
+layout(location = 0) in vec3 l_pos;
+layout(location = 1) in vec2 in_tex_coord;
+layout(location = 2) in vec3 l_normal;
+layout(location = 3) in vec3 instance_offset; // world-space translation of this cube
+
+out vec3 v_pos;
+out vec3 v_normal;
+out vec2 tex_coord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    vec4 pos = view * vec4(l_pos + instance_offset, 1.0);
+    v_pos = pos.xyz;
+    v_normal = mat3(view) * l_normal; // model is a pure translation
+    gl_Position = projection * pos;
+    tex_coord = in_tex_coord;
+}
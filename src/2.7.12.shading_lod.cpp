@@ -0,0 +1,441 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "lights.h"
+#include "shader_permutations.h"
+#include "shader_program.h"
+#include "shading_lod.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+constexpr GLuint LIGHTS_BINDING = 0;
+
+constexpr const int NR_LIGHTS = 32;    // keep in sync with 2.7.12.shading_lod.{vert,frag}
+constexpr const int NR_CUBES  = 10000; // 100 layers deep
+
+// per pixel up to LOD_BAND, per vertex beyond
+constexpr float LOD_BAND       = 25.0f;
+constexpr float LOD_HYSTERESIS = 0.1f;
+
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+// shading levels, nearest first
+enum Level : unsigned int {
+  PER_PIXEL  = 0,
+  PER_VERTEX = 1,
+};
+
+// tints when showing levels (V)
+const glm::vec3 LEVEL_TINTS[] = {
+  glm::vec3(1.0f, 0.6f, 0.6f),
+  glm::vec3(0.6f, 0.6f, 1.0f),
+};
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+// uniforms of one variant of 2.7.12.shading_lod.{vert,frag} -- -1 where compiled out
+struct LodLocs {
+  GLint        view;
+  GLint        projection;
+  MaterialLocs material;
+  GLint        shininess; // per-vertex variant's copy of material.shininess
+  DirLightLocs dirLight;
+  GLint        attenuation;
+  GLint        tint;
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  unsigned int instanceVbo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       lightsUbo;
+
+  void init();
+  void cleanup();
+};
+
+void    processInput(GLFWwindow *window);
+LodLocs lodLocs(GLuint program, const ShaderDefines &defines);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.7.12.shading_lod.vert";
+const char *cubeFragmentShaderPath = "src/2.7.12.shading_lod.frag";
+
+CubeContext                 cube{};
+ShaderPermutations<LodLocs> shading(cubeVertexShaderPath, cubeFragmentShaderPath,
+                                    lodLocs);
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+bool lodOn       = true;  // L: every cube per pixel instead
+bool showLevels  = false; // V: tint cubes by level
+
+glm::vec3 cubePos(unsigned int i) {
+  return 2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+         glm::vec3(5.0f);
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+                         lodOn = !lodOn;
+                       }
+                       if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+                         showLevels = !showLevels;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+
+  // lights scattered through the nearest layers, as in 2.7.8.light_lists
+  std::vector<glm::vec3> lightPoss, lightDirs, lightColors;
+  for (uint32_t i = 0; i < NR_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    lightPoss.push_back(rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f));
+    lightDirs.push_back(glm::normalize(rand3(1) - glm::vec3(0.5f)));
+    lightColors.push_back(glm::normalize(rand3(2)));
+  }
+  float range = attenuationRange(LIGHT_ATTENUATION);
+
+  std::vector<glm::vec3> centers(NR_CUBES);
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    centers[i] = cubePos(i);
+  }
+
+  ShadingLod                lod({ LOD_BAND }, LOD_HYSTERESIS);
+  std::vector<GpuSpotLight> gpuLights(NR_LIGHTS);
+  std::vector<glm::vec3>    offsets(NR_CUBES);
+
+  float        titleTime  = 0.0f;
+  unsigned int nrFrames   = 0;
+  unsigned int nrSwitches = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      shading.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 250.0f);
+
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+      bool      isSpot   = i % 2 == 0;
+      glm::vec3 viewPos  = view * glm::vec4(lightPoss[i], 1.0f);
+      glm::vec3 viewDir  = view * glm::vec4(lightDirs[i], 0.0f);
+      float     cosOuter = isSpot ? COS_OUTER : POINT_COS_OUTER;
+      float     cosInner = isSpot ? COS_INNER : POINT_COS_INNER;
+      gpuLights[i]       = {
+              .vPosRange         = glm::vec4(viewPos, range),
+              .directionCosOuter = glm::vec4(viewDir, cosOuter),
+              .colorCosInner     = glm::vec4(lightColors[i], cosInner),
+      };
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, cube.lightsUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GpuSpotLight) * gpuLights.size(),
+                    gpuLights.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // bucket the cubes by level; each bucket is a contiguous run of instances
+    lod.update(centers, camera.pos);
+    nrSwitches += lod.nrSwitches();
+    size_t                                 nrOffsets = 0;
+    std::vector<std::pair<size_t, size_t>> runs; // (first instance, count) per level
+    for (unsigned int level = 0; level < lod.nrLevels(); ++level) {
+      const auto &bucket = lod.bucket(level);
+      runs.emplace_back(nrOffsets, bucket.size());
+      for (uint32_t i : bucket) {
+        offsets[nrOffsets++] = centers[i];
+      }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, cube.instanceVbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * offsets.size(),
+                    offsets.data());
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glBindVertexArray(cube.vao);
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+
+    auto dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    for (unsigned int level = 0; level < lod.nrLevels(); ++level) {
+      auto [first, count] = runs[level];
+      if (count == 0) {
+        continue;
+      }
+      bool        gouraud = lodOn && level == PER_VERTEX;
+      const auto &variant = shading.get({ { "GOURAUD", gouraud } });
+      const auto &locs    = variant.locs;
+
+      glUseProgram(variant.program);
+      glUniformMatrix4fv(locs.view, 1, GL_FALSE, glm::value_ptr(view));
+      glUniformMatrix4fv(locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+      glUniform1f(locs.material.shininess, 64.0f);
+      glUniform1f(locs.shininess, 64.0f);
+      glUniform3f(locs.attenuation, LIGHT_ATTENUATION.k0, LIGHT_ATTENUATION.k1,
+                  LIGHT_ATTENUATION.k2);
+      glUniform3f(locs.dirLight.direction, dirLightDir.x, dirLightDir.y, dirLightDir.z);
+      glUniform3f(locs.dirLight.ambient, 0.2f * dirLightColor.x, 0.2f * dirLightColor.y,
+                  0.2f * dirLightColor.z);
+      glUniform3f(locs.dirLight.diffuse, 0.5f * dirLightColor.x, 0.5f * dirLightColor.y,
+                  0.5f * dirLightColor.z);
+      glUniform3f(locs.dirLight.specular, 1.0f * dirLightColor.x, 1.0f * dirLightColor.y,
+                  1.0f * dirLightColor.z);
+      glm::vec3 tint = showLevels ? LEVEL_TINTS[level] : glm::vec3(1.0f);
+      glUniform3f(locs.tint, tint.x, tint.y, tint.z);
+
+      // point the instance attribute at this level's run
+      glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                            (void *)(first * sizeof(glm::vec3)));
+      glDrawElementsInstanced(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0,
+                              count);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    ++nrFrames;
+    if (time - titleTime > 0.5f) {
+      auto title = CURRENT_BASENAME() + " -- " +
+                   std::to_string(lod.bucket(PER_PIXEL).size()) + " per pixel, " +
+                   std::to_string(lod.bucket(PER_VERTEX).size()) + " per vertex" +
+                   (lodOn ? "" : " (off)") + ", " +
+                   std::to_string(nrSwitches / nrFrames) + " switches/frame, " +
+                   std::to_string(1000.0f * (time - titleTime) / nrFrames) + "ms";
+      glfwSetWindowTitle(window, title.c_str());
+      titleTime  = time;
+      nrFrames   = 0;
+      nrSwitches = 0;
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  shading.cleanup();
+  cube.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    shading.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+LodLocs lodLocs(GLuint program, const ShaderDefines &defines) {
+  LodLocs locs;
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.shininess          = glGetUniformLocation(program, "shininess");
+  locs.dirLight.direction = glGetUniformLocation(program, "dir_light.direction");
+  locs.dirLight.ambient   = glGetUniformLocation(program, "dir_light.ambient");
+  locs.dirLight.diffuse   = glGetUniformLocation(program, "dir_light.diffuse");
+  locs.dirLight.specular  = glGetUniformLocation(program, "dir_light.specular");
+  locs.attenuation        = glGetUniformLocation(program, "attenuation");
+  locs.tint               = glGetUniformLocation(program, "tint");
+
+  // set constant uniforms
+  glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Lights"),
+                        LIGHTS_BINDING);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  return locs;
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  // offsets in level order, rewritten each frame -- each level's draw points
+  // attribute 3 at its own run
+  instanceVbo = 0;
+  glGenBuffers(1, &instanceVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * NR_CUBES, nullptr, GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(3);
+  glVertexAttribDivisor(3, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  lightsUbo = 0;
+  glGenBuffers(1, &lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, lightsUbo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuSpotLight) * NR_LIGHTS, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &instanceVbo);
+  glDeleteBuffers(1, &lightsUbo);
+}
@@ -0,0 +1,85 @@
+#version 330 core
+// Both shading levels of 2.7.12.shading_lod. ShaderPermutations injects GOURAUD:
+// 0 lights per pixel in the fragment shader, 1 lights per vertex here and only
+// interpolates the result.
+#ifndef GOURAUD
+#define GOURAUD 0
+#endif
+
+layout(location = 0) in vec3 l_pos;
+layout(location = 1) in vec2 in_tex_coord;
+layout(location = 2) in vec3 l_normal;
+layout(location = 3) in vec3 instance_offset; // world-space translation of this cube
+
+out vec2 tex_coord;
+#if GOURAUD
+out vec3 diffuse_light;  // ambient + diffuse, scales the diffuse map
+out vec3 specular_light; // scales the specular map
+#else
+out vec3 v_pos;
+out vec3 v_normal;
+#endif
+
+uniform mat4 view;
+uniform mat4 projection;
+
+#if GOURAUD
+#define NR_LIGHTS 32 // keep in sync with 2.7.12.shading_lod.cpp
+
+struct DirLight {
+    vec3 direction; // from light towards object
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec4 v_pos_range;         // xyz: view-space position, w: attenuation range
+    vec4 direction_cos_outer; // xyz: view-space direction, w: cos of outer cutoff
+    vec4 color_cos_inner;     // rgb: color, w: cos of inner cutoff
+};
+
+layout(std140) uniform Lights {
+    SpotLight spot_lights[NR_LIGHTS];
+};
+
+uniform DirLight dir_light;
+uniform vec3 attenuation; // k_0, k_1, k_2
+uniform float shininess;
+#endif
+
+void main() {
+    vec4 pos = view * vec4(l_pos + instance_offset, 1.0);
+    vec3 normal = mat3(view) * l_normal; // model is a pure translation
+    gl_Position = projection * pos;
+    tex_coord = in_tex_coord;
+#if GOURAUD
+    vec3 norm = normalize(normal);
+    vec3 camera_dir = normalize(-pos.xyz);
+
+    vec3 light_dir = normalize(-dir_light.direction);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    diffuse_light = dir_light.ambient + max(0.0, dot(norm, light_dir)) * dir_light.diffuse;
+    specular_light = pow(max(0.0, dot(camera_dir, bounce_dir)), shininess) * dir_light.specular;
+
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+        SpotLight light = spot_lights[i];
+        vec3 color = light.color_cos_inner.rgb;
+        vec3 to_light = light.v_pos_range.xyz - pos.xyz;
+        float d_2 = dot(to_light, to_light);
+        float d = sqrt(d_2);
+        light_dir = to_light / d;
+        bounce_dir = reflect(-light_dir, norm);
+
+        float f_att = 1.0/(attenuation.x + attenuation.y * d + attenuation.z * d_2);
+        float cos_theta_spotlight = dot(light_dir, -normalize(light.direction_cos_outer.xyz));
+        f_att *= smoothstep(light.direction_cos_outer.w, light.color_cos_inner.w, cos_theta_spotlight);
+
+        diffuse_light += f_att * (0.2 + 0.5 * max(0.0, dot(norm, light_dir))) * color;
+        specular_light += f_att * pow(max(0.0, dot(camera_dir, bounce_dir)), shininess) * color;
+    }
+#else
+    v_pos = pos.xyz;
+    v_normal = normal;
+#endif
+}
@@ -0,0 +1,455 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "lights.h"
+#include "shader_program.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+constexpr GLuint LIGHTS_BINDING         = 0;
+constexpr GLuint CLUSTER_LIGHTS_BINDING = 1;
+
+// keep in sync with 2.7.5.clustered{_cull.comp,.frag}
+constexpr unsigned int CLUSTER_TILE_SIZE      = 64;
+constexpr unsigned int NR_SLICES              = 24;
+constexpr unsigned int MAX_LIGHTS_PER_CLUSTER = 128;
+
+constexpr float Z_NEAR = 0.1f;
+constexpr float Z_FAR  = 100.0f;
+
+constexpr const int NR_LIGHTS = 2048; // even: spot, odd: point
+constexpr const int NR_CUBES  = 1000;
+
+// wider cones than 2.6.1 so the scattered lights visibly overlap
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+// point lights share the spot light layout with a cone covering every direction
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+// stronger falloff than 2.6.1 so each light reaches only a few cubes
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       program;
+  struct Locations {
+    GLint        model;
+    GLint        view;
+    GLint        projection;
+    MaterialLocs material;
+    DirLightLocs dirLight;
+    GLint        attenuation;
+    GLint        nrTiles;
+    GLint        zNear;
+    GLint        sliceScale;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+struct CullContext {
+  GLuint       program;
+  GLuint       lightsBuffer;
+  GLuint       clusterLightsBuffer;
+  unsigned int width;
+  unsigned int height;
+  unsigned int nrTilesX;
+  unsigned int nrTilesY;
+  struct Locations {
+    GLint invProjection;
+    GLint screenSize;
+    GLint zNear;
+    GLint zFar;
+    GLint nrLights;
+  } locs;
+
+  void init();
+  void resize(unsigned int width, unsigned int height);
+  void reload();
+  void cleanup();
+};
+
+struct WorldLight {
+  glm::vec3 pos;
+  glm::vec3 direction; // unused for point lights
+  glm::vec3 color;
+  bool      isSpot;
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.4.maps_texcoord_cube.vert";
+const char *cubeFragmentShaderPath = "src/2.7.5.clustered.frag";
+const char *cullComputeShaderPath  = "src/2.7.5.clustered_cull.comp";
+
+CubeContext cube{};
+CullContext cull{};
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+
+glm::mat4 cubeModel(unsigned int i) {
+  auto gridMove =
+      2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+      glm::vec3(5.0f);
+  return glm::translate(glm::mat4(1.0f), gridMove);
+}
+
+// lights scattered through the cube grid, spots pointing in random directions
+std::vector<WorldLight> makeLights() {
+  std::vector<WorldLight> res(NR_LIGHTS);
+  for (uint32_t i = 0; i < NR_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    res[i].pos       = rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f);
+    res[i].direction = glm::normalize(rand3(1) - glm::vec3(0.5f));
+    res[i].color     = glm::normalize(rand3(2));
+    res[i].isSpot    = i % 2 == 0;
+  }
+  return res;
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+  glDebugMessageCallback(glDebugMessageCb, 0);
+
+  cube.init();
+  cube.reload();
+
+  cull.init();
+  cull.reload();
+
+  auto                      lights = makeLights();
+  std::vector<GpuSpotLight> gpuLights(NR_LIGHTS);
+  float                     range = attenuationRange(LIGHT_ATTENUATION);
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      cube.reload();
+    }
+    if (fileChanged(cullComputeShaderPath)) {
+      cull.reload();
+    }
+    if (cull.width != windowWidth || cull.height != windowHeight) {
+      cull.resize(windowWidth, windowHeight);
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, Z_NEAR, Z_FAR);
+
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+      glm::vec3 viewPos  = view * glm::vec4(lights[i].pos, 1.0f);
+      glm::vec3 viewDir  = view * glm::vec4(lights[i].direction, 0.0f);
+      float     cosOuter = lights[i].isSpot ? COS_OUTER : POINT_COS_OUTER;
+      float     cosInner = lights[i].isSpot ? COS_INNER : POINT_COS_INNER;
+      gpuLights[i]       = {
+              .vPosRange         = glm::vec4(viewPos, range),
+              .directionCosOuter = glm::vec4(viewDir, cosOuter),
+              .colorCosInner     = glm::vec4(lights[i].color, cosInner),
+      };
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cull.lightsBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuSpotLight) * gpuLights.size(),
+                    gpuLights.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // 1. assign lights to clusters -- depends only on the camera, not on the scene
+    glUseProgram(cull.program);
+    glm::mat4 invProjection = glm::inverse(projection);
+    glUniformMatrix4fv(cull.locs.invProjection, 1, GL_FALSE,
+                       glm::value_ptr(invProjection));
+    glUniform2ui(cull.locs.screenSize, windowWidth, windowHeight);
+    glUniform1f(cull.locs.zNear, Z_NEAR);
+    glUniform1f(cull.locs.zFar, Z_FAR);
+    glUniform1ui(cull.locs.nrLights, NR_LIGHTS);
+    glDispatchCompute(cull.nrTilesX, cull.nrTilesY, NR_SLICES);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // 2. shading -- each fragment loops over its cluster's lights
+    glUseProgram(cube.program);
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform2ui(cube.locs.nrTiles, cull.nrTilesX, cull.nrTilesY);
+    glUniform1f(cube.locs.zNear, Z_NEAR);
+    glUniform1f(cube.locs.sliceScale, NR_SLICES / glm::log(Z_FAR / Z_NEAR));
+    glUniform3f(cube.locs.attenuation, LIGHT_ATTENUATION.k0, LIGHT_ATTENUATION.k1,
+                LIGHT_ATTENUATION.k2);
+
+    auto dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    glUniform3f(cube.locs.dirLight.direction, dirLightDir.x, dirLightDir.y,
+                dirLightDir.z);
+    glUniform3f(cube.locs.dirLight.ambient, 0.2f * dirLightColor.x,
+                0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.diffuse, 0.5f * dirLightColor.x,
+                0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.specular, 1.0f * dirLightColor.x,
+                1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+    glUniform1f(cube.locs.material.shininess, 64.0f);
+
+    for (unsigned int i = 0; i < NR_CUBES; i++) {
+      glm::mat4 model = cubeModel(i);
+      glUniformMatrix4fv(cube.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+      glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  cube.cleanup();
+  cull.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+    cull.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, cubeFragmentShaderPath);
+
+  // get uniform locations
+  locs.model              = glGetUniformLocation(program, "model");
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.dirLight.direction = glGetUniformLocation(program, "dir_light.direction");
+  locs.dirLight.ambient   = glGetUniformLocation(program, "dir_light.ambient");
+  locs.dirLight.diffuse   = glGetUniformLocation(program, "dir_light.diffuse");
+  locs.dirLight.specular  = glGetUniformLocation(program, "dir_light.specular");
+  locs.attenuation        = glGetUniformLocation(program, "attenuation");
+  locs.nrTiles            = glGetUniformLocation(program, "nr_tiles");
+  locs.zNear              = glGetUniformLocation(program, "z_near");
+  locs.sliceScale         = glGetUniformLocation(program, "slice_scale");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteProgram(program);
+}
+
+void CullContext::init() {
+  lightsBuffer = 0;
+  glGenBuffers(1, &lightsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuSpotLight) * NR_LIGHTS, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, lightsBuffer);
+
+  clusterLightsBuffer = 0;
+  glGenBuffers(1, &clusterLightsBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING, clusterLightsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void CullContext::resize(unsigned int width_, unsigned int height_) {
+  width    = width_;
+  height   = height_;
+  nrTilesX = (width + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+  nrTilesY = (height + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+
+  // per cluster: count followed by up to MAX_LIGHTS_PER_CLUSTER indices
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterLightsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               sizeof(GLuint) * nrTilesX * nrTilesY * NR_SLICES *
+                   (MAX_LIGHTS_PER_CLUSTER + 1),
+               nullptr, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void CullContext::reload() {
+  reloadComputeProgram(program, cullComputeShaderPath);
+
+  // get uniform locations
+  locs.invProjection = glGetUniformLocation(program, "inv_projection");
+  locs.screenSize    = glGetUniformLocation(program, "screen_size");
+  locs.zNear         = glGetUniformLocation(program, "z_near");
+  locs.zFar          = glGetUniformLocation(program, "z_far");
+  locs.nrLights      = glGetUniformLocation(program, "nr_lights");
+}
+
+void CullContext::cleanup() {
+  glDeleteBuffers(1, &lightsBuffer);
+  glDeleteBuffers(1, &clusterLightsBuffer);
+  glDeleteProgram(program);
+}
@@ -0,0 +1,647 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "light_volumes.h"
+#include "lights.h"
+#include "shader_program.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT          = 5;
+constexpr int SPECULAR_TEXTURE_UNIT         = 7;
+constexpr int ALBEDO_SPEC_TEXTURE_UNIT      = 0;
+constexpr int NORMAL_SHININESS_TEXTURE_UNIT = 1;
+constexpr int DEPTH_TEXTURE_UNIT            = 2;
+
+constexpr GLuint LIGHTS_BINDING = 0;
+
+constexpr const int NR_SPOT_LIGHTS  = 1024; // spots first in the light buffer
+constexpr const int NR_POINT_LIGHTS = 1024; // then points
+constexpr const int NR_LIGHTS       = NR_SPOT_LIGHTS + NR_POINT_LIGHTS;
+constexpr const int NR_CUBES        = 1000;
+
+// wider cones than 2.6.1 so the scattered lights visibly overlap
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+// point lights share the spot light layout with a cone covering every direction
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+// stronger falloff than 2.6.1 so each light reaches only a few cubes
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+const glm::vec3 BACKGROUND = glm::vec3(0.1f, 0.1f, 0.2f);
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct GBufferLocs {
+  GLint albedoSpec;
+  GLint normalShininess;
+  GLint depth;
+};
+
+// geometry pass writes the G-buffer, lighting passes sum into the accumulation target.
+// the accumulation target has its own copy of the depth so light volumes can be depth
+// tested while the G-buffer depth is sampled.
+struct GBuffer {
+  GLuint       fbo;
+  GLuint       albedoSpec;      // RGBA8
+  GLuint       normalShininess; // RGB10_A2
+  GLuint       depth;           // DEPTH_COMPONENT32F
+  GLuint       lightFbo;
+  GLuint       lightColor;
+  GLuint       lightDepth;
+  unsigned int width;
+  unsigned int height;
+
+  void init(unsigned int width, unsigned int height);
+  void cleanup();
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       program;
+  struct Locations {
+    GLint        model;
+    GLint        view;
+    GLint        projection;
+    MaterialLocs material;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+struct LightContext {
+  struct Volume {
+    GLuint   vbo;
+    GLuint   vao;
+    GLuint   ebo;
+    uint32_t nrIndices;
+
+    void init(const VolumeMesh &mesh);
+    void cleanup();
+  } sphere, cone;
+  GLuint lightsBuffer;
+  GLuint emptyVao; // for the attribute-less full-screen triangle
+  GLuint dirProgram;
+  GLuint volumeProgram;
+  struct DirLocations {
+    GBufferLocs  gBuffer;
+    GLint        invProjection;
+    DirLightLocs dirLight;
+    GLint        background;
+  } dirLocs;
+  struct VolumeLocations {
+    GBufferLocs gBuffer;
+    GLint       projection;
+    GLint       invProjection;
+    GLint       firstLight;
+    GLint       attenuation;
+  } volumeLocs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+struct WorldLight {
+  glm::vec3 pos;
+  glm::vec3 direction; // unused for point lights
+  glm::vec3 color;
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath     = "src/2.4.maps_texcoord_cube.vert";
+const char *gBufferFragShaderPath    = "src/2.7.6.gbuffer.frag";
+const char *fullscreenVertShaderPath = "src/2.7.6.fullscreen.vert";
+const char *dirFragShaderPath        = "src/2.7.6.deferred_dir.frag";
+const char *volumeVertShaderPath     = "src/2.7.6.light_volume.vert";
+const char *volumeFragShaderPath     = "src/2.7.6.deferred_light.frag";
+
+CubeContext  cube{};
+LightContext light{};
+GBuffer      gBuffer{};
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+
+glm::mat4 cubeModel(unsigned int i) {
+  auto gridMove =
+      2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+      glm::vec3(5.0f);
+  return glm::translate(glm::mat4(1.0f), gridMove);
+}
+
+// lights scattered through the cube grid, spots pointing in random directions
+std::vector<WorldLight> makeLights() {
+  std::vector<WorldLight> res(NR_LIGHTS);
+  for (uint32_t i = 0; i < NR_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    res[i].pos       = rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f);
+    res[i].direction = glm::normalize(rand3(1) - glm::vec3(0.5f));
+    res[i].color     = glm::normalize(rand3(2));
+  }
+  return res;
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+  glDebugMessageCallback(glDebugMessageCb, 0);
+
+  cube.init();
+  cube.reload();
+
+  light.init();
+  light.reload();
+
+  auto                      lights = makeLights();
+  std::vector<GpuSpotLight> gpuLights(NR_LIGHTS);
+  float                     range = attenuationRange(LIGHT_ATTENUATION);
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(gBufferFragShaderPath)) {
+      cube.reload();
+    }
+    if (fileChanged(fullscreenVertShaderPath) || fileChanged(dirFragShaderPath) ||
+        fileChanged(volumeVertShaderPath) || fileChanged(volumeFragShaderPath)) {
+      light.reload();
+    }
+    if (gBuffer.width != windowWidth || gBuffer.height != windowHeight) {
+      gBuffer.cleanup();
+      gBuffer.init(windowWidth, windowHeight);
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 100.0f);
+    glm::mat4 invProjection = glm::inverse(projection);
+
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+      bool      isSpot   = i < NR_SPOT_LIGHTS;
+      glm::vec3 viewPos  = view * glm::vec4(lights[i].pos, 1.0f);
+      glm::vec3 viewDir  = view * glm::vec4(lights[i].direction, 0.0f);
+      float     cosOuter = isSpot ? COS_OUTER : POINT_COS_OUTER;
+      float     cosInner = isSpot ? COS_INNER : POINT_COS_INNER;
+      gpuLights[i]       = {
+              .vPosRange         = glm::vec4(viewPos, range),
+              .directionCosOuter = glm::vec4(viewDir, cosOuter),
+              .colorCosInner     = glm::vec4(lights[i].color, cosInner),
+      };
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, light.lightsBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuSpotLight) * gpuLights.size(),
+                    gpuLights.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // 1. geometry pass -- material and normal only, overdraw costs a few texture reads
+    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.fbo);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(cube.program);
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+    glUniform1f(cube.locs.material.shininess, 64.0f);
+
+    for (unsigned int i = 0; i < NR_CUBES; i++) {
+      glm::mat4 model = cubeModel(i);
+      glUniformMatrix4fv(cube.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+      glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+    }
+
+    // lighting passes read the G-buffer and write the accumulation target
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gBuffer.lightFbo);
+    glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight,
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.lightFbo);
+
+    glActiveTexture(GL_TEXTURE0 + ALBEDO_SPEC_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gBuffer.albedoSpec);
+    glActiveTexture(GL_TEXTURE0 + NORMAL_SHININESS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gBuffer.normalShininess);
+    glActiveTexture(GL_TEXTURE0 + DEPTH_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gBuffer.depth);
+
+    // 2. directional light, once per pixel -- also writes the background
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(light.dirProgram);
+    glUniformMatrix4fv(light.dirLocs.invProjection, 1, GL_FALSE,
+                       glm::value_ptr(invProjection));
+    glUniform3f(light.dirLocs.background, BACKGROUND.x, BACKGROUND.y, BACKGROUND.z);
+
+    auto dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    glUniform3f(light.dirLocs.dirLight.direction, dirLightDir.x, dirLightDir.y,
+                dirLightDir.z);
+    glUniform3f(light.dirLocs.dirLight.ambient, 0.2f * dirLightColor.x,
+                0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+    glUniform3f(light.dirLocs.dirLight.diffuse, 0.5f * dirLightColor.x,
+                0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+    glUniform3f(light.dirLocs.dirLight.specular, 1.0f * dirLightColor.x,
+                1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+    glBindVertexArray(light.emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // 3. light volumes, additively blended. drawing back faces that lie behind the
+    // scene surface touches exactly the pixels inside the volume, and keeps working
+    // when the camera is inside it.
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    glUseProgram(light.volumeProgram);
+    glUniformMatrix4fv(light.volumeLocs.projection, 1, GL_FALSE,
+                       glm::value_ptr(projection));
+    glUniformMatrix4fv(light.volumeLocs.invProjection, 1, GL_FALSE,
+                       glm::value_ptr(invProjection));
+    glUniform3f(light.volumeLocs.attenuation, LIGHT_ATTENUATION.k0, LIGHT_ATTENUATION.k1,
+                LIGHT_ATTENUATION.k2);
+
+    glUniform1ui(light.volumeLocs.firstLight, 0);
+    glBindVertexArray(light.cone.vao);
+    glDrawElementsInstanced(GL_TRIANGLES, light.cone.nrIndices, GL_UNSIGNED_INT, 0,
+                            NR_SPOT_LIGHTS);
+
+    glUniform1ui(light.volumeLocs.firstLight, NR_SPOT_LIGHTS);
+    glBindVertexArray(light.sphere.vao);
+    glDrawElementsInstanced(GL_TRIANGLES, light.sphere.nrIndices, GL_UNSIGNED_INT, 0,
+                            NR_POINT_LIGHTS);
+
+    glDisable(GL_BLEND);
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer.lightFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  cube.cleanup();
+  light.cleanup();
+  gBuffer.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+    light.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+static GLuint makeTexture2D(GLenum internalFormat, unsigned int width,
+                            unsigned int height, GLenum format, GLenum type) {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+void GBuffer::init(unsigned int width_, unsigned int height_) {
+  width  = width_;
+  height = height_;
+
+  albedoSpec = makeTexture2D(GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+  normalShininess =
+      makeTexture2D(GL_RGB10_A2, width, height, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV);
+  depth = makeTexture2D(GL_DEPTH_COMPONENT32F, width, height, GL_DEPTH_COMPONENT,
+                        GL_FLOAT);
+
+  fbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpec,
+                         0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
+                         normalShininess, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+  GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+  glDrawBuffers(std::size(drawBuffers), drawBuffers);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "G-buffer framebuffer incomplete" << std::endl;
+  }
+
+  lightColor = makeTexture2D(GL_RGBA16F, width, height, GL_RGBA, GL_FLOAT);
+
+  lightDepth = 0;
+  glGenRenderbuffers(1, &lightDepth);
+  glBindRenderbuffer(GL_RENDERBUFFER, lightDepth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  lightFbo = 0;
+  glGenFramebuffers(1, &lightFbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, lightFbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightColor,
+                         0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                            lightDepth);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "light framebuffer incomplete" << std::endl;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::cleanup() {
+  glDeleteFramebuffers(1, &fbo); // 0 silently ignored
+  glDeleteFramebuffers(1, &lightFbo);
+  glDeleteTextures(1, &albedoSpec);
+  glDeleteTextures(1, &normalShininess);
+  glDeleteTextures(1, &depth);
+  glDeleteTextures(1, &lightColor);
+  glDeleteRenderbuffers(1, &lightDepth);
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, gBufferFragShaderPath);
+
+  // get uniform locations
+  locs.model              = glGetUniformLocation(program, "model");
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteProgram(program);
+}
+
+void LightContext::Volume::init(const VolumeMesh &mesh) {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.positions.size(),
+               mesh.positions.data(), GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * mesh.indices.size(),
+               mesh.indices.data(), GL_STATIC_DRAW);
+  nrIndices = static_cast<uint32_t>(mesh.indices.size());
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+}
+
+void LightContext::Volume::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+}
+
+void LightContext::init() {
+  sphere.init(makeSphereVolume());
+  cone.init(makeConeVolume());
+
+  emptyVao = 0;
+  glGenVertexArrays(1, &emptyVao);
+
+  lightsBuffer = 0;
+  glGenBuffers(1, &lightsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuSpotLight) * NR_LIGHTS, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, lightsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static GBufferLocs gBufferLocs(GLuint program) {
+  return {
+    .albedoSpec      = glGetUniformLocation(program, "g_albedo_spec"),
+    .normalShininess = glGetUniformLocation(program, "g_normal_shininess"),
+    .depth           = glGetUniformLocation(program, "g_depth"),
+  };
+}
+
+static void setGBufferUnits(GLuint program, const GBufferLocs &locs) {
+  glUseProgram(program);
+  glUniform1i(locs.albedoSpec, ALBEDO_SPEC_TEXTURE_UNIT);
+  glUniform1i(locs.normalShininess, NORMAL_SHININESS_TEXTURE_UNIT);
+  glUniform1i(locs.depth, DEPTH_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void LightContext::reload() {
+  reloadProgram(dirProgram, fullscreenVertShaderPath, dirFragShaderPath);
+  reloadProgram(volumeProgram, volumeVertShaderPath, volumeFragShaderPath);
+
+  // get uniform locations
+  dirLocs.gBuffer            = gBufferLocs(dirProgram);
+  dirLocs.invProjection      = glGetUniformLocation(dirProgram, "inv_projection");
+  dirLocs.dirLight.direction = glGetUniformLocation(dirProgram, "dir_light.direction");
+  dirLocs.dirLight.ambient   = glGetUniformLocation(dirProgram, "dir_light.ambient");
+  dirLocs.dirLight.diffuse   = glGetUniformLocation(dirProgram, "dir_light.diffuse");
+  dirLocs.dirLight.specular  = glGetUniformLocation(dirProgram, "dir_light.specular");
+  dirLocs.background         = glGetUniformLocation(dirProgram, "background");
+
+  volumeLocs.gBuffer       = gBufferLocs(volumeProgram);
+  volumeLocs.projection    = glGetUniformLocation(volumeProgram, "projection");
+  volumeLocs.invProjection = glGetUniformLocation(volumeProgram, "inv_projection");
+  volumeLocs.firstLight    = glGetUniformLocation(volumeProgram, "first_light");
+  volumeLocs.attenuation   = glGetUniformLocation(volumeProgram, "attenuation");
+
+  // set constant uniforms
+  setGBufferUnits(dirProgram, dirLocs.gBuffer);
+  setGBufferUnits(volumeProgram, volumeLocs.gBuffer);
+}
+
+void LightContext::cleanup() {
+  sphere.cleanup();
+  cone.cleanup();
+  glDeleteVertexArrays(1, &emptyVao);
+  glDeleteBuffers(1, &lightsBuffer);
+  glDeleteProgram(dirProgram);
+  glDeleteProgram(volumeProgram);
+}
@@ -0,0 +1,67 @@
+#version 330 core
+out vec4 FragColor;
+
+// full-screen pass of the deferred renderer: directional light and background.
+// overwrites the accumulation target, light volumes are added on top.
+
+#define MAX_SHININESS 256.0 // keep in sync with 2.7.6.gbuffer.frag
+
+struct DirLight {
+    vec3 direction; // from light towards object
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform sampler2D g_albedo_spec;
+uniform sampler2D g_normal_shininess;
+uniform sampler2D g_depth;
+uniform mat4 inv_projection;
+uniform DirLight dir_light;
+uniform vec3 background;
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    }
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(g_depth, pixel, 0).r;
+    if (depth == 1.0) {
+        FragColor = vec4(background, 1.0); // nothing drawn here
+        return;
+    }
+    vec4 albedo_spec = texelFetch(g_albedo_spec, pixel, 0);
+    vec4 normal_shininess = texelFetch(g_normal_shininess, pixel, 0);
+    vec3 diffuse_color = albedo_spec.rgb;
+    vec3 specular_color = vec3(albedo_spec.a);
+    vec3 norm = octDecode(normal_shininess.rg);
+    float shininess = normal_shininess.b * MAX_SHININESS;
+
+    vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(g_depth, 0))) * 2.0 - 1.0;
+    vec4 p = inv_projection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 v_pos = p.xyz / p.w;
+
+    vec3 light_dir = normalize(-dir_light.direction); // from object towards source
+
+    vec3 ambient = dir_light.ambient * diffuse_color;
+
+    float cos_theta = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta * dir_light.diffuse * diffuse_color;
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), shininess);
+    vec3 specular = spec * dir_light.specular * specular_color;
+
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
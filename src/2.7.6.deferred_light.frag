@@ -0,0 +1,81 @@
+#version 430 core
+out vec4 FragColor;
+
+// light volume pass of the deferred renderer: runs once per covered pixel per
+// light and is summed into the accumulation target with additive blending.
+// same light model as spotLightColor in 2.7.4.forward_plus.frag
+
+#define MAX_SHININESS 256.0 // keep in sync with 2.7.6.gbuffer.frag
+
+struct SpotLight {
+    vec4 v_pos_range;         // xyz: view-space position, w: attenuation range
+    vec4 direction_cos_outer; // xyz: view-space direction, w: cos of outer cutoff
+    vec4 color_cos_inner;     // rgb: color, w: cos of inner cutoff
+};
+
+layout(std430, binding = 0) readonly buffer Lights {
+    SpotLight spot_lights[];
+};
+
+flat in uint light_index;
+
+uniform sampler2D g_albedo_spec;
+uniform sampler2D g_normal_shininess;
+uniform sampler2D g_depth;
+uniform mat4 inv_projection;
+uniform vec3 attenuation; // k_0, k_1, k_2
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    }
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(g_depth, pixel, 0).r;
+    vec4 albedo_spec = texelFetch(g_albedo_spec, pixel, 0);
+    vec4 normal_shininess = texelFetch(g_normal_shininess, pixel, 0);
+    vec3 diffuse_color = albedo_spec.rgb;
+    vec3 specular_color = vec3(albedo_spec.a);
+    vec3 norm = octDecode(normal_shininess.rg);
+    float shininess = normal_shininess.b * MAX_SHININESS;
+
+    vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(g_depth, 0))) * 2.0 - 1.0;
+    vec4 p = inv_projection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 v_pos = p.xyz / p.w;
+
+    SpotLight light = spot_lights[light_index];
+    vec3 color = light.color_cos_inner.rgb;
+    vec3 light_pos = light.v_pos_range.xyz;
+
+    vec3 ambient = 0.2 * color * diffuse_color;
+
+    vec3 light_dir = normalize(light_pos - v_pos); // towards light source
+    float cos_theta_surface = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta_surface * 0.5 * color * diffuse_color;
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), shininess);
+    vec3 specular = spec * color * specular_color;
+
+    vec3 res = ambient + diffuse + specular;
+
+    float d_2 = dot(v_pos - light_pos, v_pos - light_pos); // squared distance
+    float d = sqrt(d_2);
+    float f_att = 1.0/(attenuation.x + attenuation.y * d + attenuation.z * d_2);
+    res *= f_att;
+
+    float cos_theta_spotlight = dot(light_dir, -normalize(light.direction_cos_outer.xyz)); // away from spotlight center
+    res *= smoothstep(light.direction_cos_outer.w, light.color_cos_inner.w, cos_theta_spotlight);
+
+    FragColor = vec4(res, 1.0);
+}
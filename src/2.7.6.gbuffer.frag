@@ -0,0 +1,43 @@
+#version 330 core
+// geometry pass of the deferred renderer: material and surface only, no lighting.
+// G-buffer layout, 64 bits of color per pixel plus depth:
+//   0: RGBA8     rgb: albedo, a: specular intensity
+//   1: RGB10_A2  rg: octahedral view-space normal, b: shininess / MAX_SHININESS
+layout(location = 0) out vec4 g_albedo_spec;
+layout(location = 1) out vec4 g_normal_shininess;
+
+in vec3 v_normal;
+in vec3 v_pos;
+in vec2 tex_coord;
+
+#define MAX_SHININESS 256.0 // keep in sync with 2.7.6.deferred_*.frag
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+uniform Material material;
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector -> [0, 1]^2 by projecting onto the octahedron |x|+|y|+|z| = 1
+// and folding the lower half over the diagonals
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 res = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return res * 0.5 + 0.5;
+}
+
+void main() {
+    vec3 albedo = vec3(texture(material.diffuse, tex_coord));
+    vec3 specular = vec3(texture(material.specular, tex_coord));
+    float specular_intensity = dot(specular, vec3(0.2126, 0.7152, 0.0722));
+
+    g_albedo_spec = vec4(albedo, specular_intensity);
+    g_normal_shininess = vec4(octEncode(normalize(v_normal)),
+                              material.shininess / MAX_SHININESS, 0.0);
+}
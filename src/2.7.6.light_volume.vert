@@ -0,0 +1,42 @@
+#version 430 core
+// places a unit light volume around each instance's light, in view space.
+// spot lights use the cone mesh, point lights (cos_outer <= -1) the sphere mesh.
+layout(location = 0) in vec3 l_pos;
+
+struct SpotLight {
+    vec4 v_pos_range;         // xyz: view-space position, w: attenuation range
+    vec4 direction_cos_outer; // xyz: view-space direction, w: cos of outer cutoff
+    vec4 color_cos_inner;     // rgb: color, w: cos of inner cutoff
+};
+
+layout(std430, binding = 0) readonly buffer Lights {
+    SpotLight spot_lights[];
+};
+
+uniform mat4 projection;
+uniform uint first_light;
+
+flat out uint light_index;
+
+void main() {
+    light_index = first_light + uint(gl_InstanceID);
+    SpotLight light = spot_lights[light_index];
+    vec3 center = light.v_pos_range.xyz;
+    float range = light.v_pos_range.w;
+    float cos_outer = light.direction_cos_outer.w;
+
+    vec3 v_pos;
+    if (cos_outer <= -1.0) {
+        v_pos = center + range * l_pos;
+    } else {
+        // cone along -z -> along the light direction, base radius range * tan(outer)
+        float tan_outer = sqrt(max(0.0, 1.0 - cos_outer * cos_outer)) / cos_outer;
+        vec3 w = -normalize(light.direction_cos_outer.xyz);
+        vec3 up = abs(w.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+        vec3 u = normalize(cross(up, w));
+        vec3 v = cross(w, u);
+        vec3 local = vec3(l_pos.xy * tan_outer, l_pos.z) * range;
+        v_pos = center + mat3(u, v, w) * local;
+    }
+    gl_Position = projection * vec4(v_pos, 1.0);
+}
@@ -0,0 +1,654 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/geometric.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "cascaded_shadows.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "shader_program.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+constexpr int SHADOW_TEXTURE_UNIT   = 3;
+
+constexpr const unsigned int SHADOW_RESOLUTION = 1024;
+constexpr const float        SHADOW_DISTANCE   = 40.0f; // view-space, no shadows beyond
+constexpr const unsigned int NR_CASCADES       = ShadowCascades::NR_CASCADES;
+
+constexpr const int   NR_CUBES      = 1000;
+constexpr const float BOB_AMPLITUDE = 0.5f;
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct SpotLightLocs {
+  GLint v_pos;
+  GLint direction;
+  GLint spotlightCosInner;
+  GLint spotlightCosOuter;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+constexpr const int NR_SPOT_LIGHTS = 4;
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       program;
+  struct Locations {
+    GLint         model;
+    GLint         view;
+    GLint         projection;
+    GLint         wsCameraPos;
+    MaterialLocs  material;
+    DirLightLocs  dirLight;
+    SpotLightLocs spotLights[NR_SPOT_LIGHTS];
+    GLint         shadowMaps;
+    GLint         shadowMatrices;
+    GLint         cascadeSplits;
+    GLint         cascadeTexelSizes;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+struct LightContext {
+  GLuint       program;
+  unsigned int vao;
+  unsigned int ebo;
+  struct Locations {
+    GLint model;
+    GLint view;
+    GLint projection;
+    GLint lightColor;
+  } locs;
+
+  void init(const CubeContext &cube);
+  void reload();
+  void cleanup();
+};
+
+// depth-only array textures, one layer per cascade
+struct ShadowContext {
+  GLuint fbo;
+  GLuint staticMaps; // static casters, only re-rendered when their cascade moves
+  GLuint maps;       // copy of staticMaps with dynamic casters on top, for shading
+  GLuint program;
+  struct Locations {
+    GLint model;
+    GLint view;
+    GLint projection;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath    = "src/2.4.maps_texcoord_cube.vert";
+const char *cubeFragmentShaderPath  = "src/2.7.7.cascaded_shadows.frag";
+const char *lightVertexShaderPath   = "src/2.1.light_source.vert";
+const char *lightFragmentShaderPath = "src/2.1.light_source.frag";
+const char *shadowFragShaderPath    = "src/2.7.depth_only.frag";
+
+float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+
+CubeContext   cube{};
+LightContext  light{};
+ShadowContext shadow{};
+
+glm::mat4 model      = glm::mat4(1.0f);
+glm::mat4 view       = glm::mat4(1.0f);
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+auto lightPos = glm::vec3(1.0f, 0.4f, 3.0f);
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+
+// every 7th cube bobs up and down and is drawn into the shadow maps every frame
+bool isDynamic(unsigned int i) { return i % 7 == 0; }
+
+glm::vec3 cubePos(unsigned int i, float time) {
+  auto gridMove =
+      2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+      glm::vec3(5.0f);
+  if (isDynamic(i)) {
+    gridMove.y += BOB_AMPLITUDE * glm::sin(2.0f * time + (float)i);
+  }
+  return gridMove;
+}
+
+Aabb cubeBounds(glm::vec3 pos) {
+  return Aabb{ .min = pos - glm::vec3(0.5f), .max = pos + glm::vec3(0.5f) };
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+  cube.reload();
+
+  light.init(cube);
+  light.reload();
+
+  shadow.init();
+  shadow.reload();
+
+  // bounds of every caster wherever it moves -- kept fixed so the cache stays valid
+  Aabb sceneBounds;
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    sceneBounds.grow(cubeBounds(cubePos(i, 0.0f)));
+  }
+  sceneBounds.min.y -= BOB_AMPLITUDE;
+  sceneBounds.max.y += BOB_AMPLITUDE;
+
+  ShadowCascades cascades(SHADOW_RESOLUTION, 0.1f, SHADOW_DISTANCE);
+  glm::vec3      dirLightWsDir = glm::vec3(-1.0f, -1.0f, -0.3f);
+
+  float titleTime       = 0.0f;
+  int   nrStaticRenders = 0; // cascades whose static casters were re-rendered
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      cube.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glm::mat4 view = camera.view();
+
+    // shadow pass -- static casters only when the cascade moved, dynamic ones always
+    cascades.update(camera, windowWidth / (float)windowHeight, dirLightWsDir,
+                    sceneBounds);
+    glViewport(0, 0, SHADOW_RESOLUTION, SHADOW_RESOLUTION);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadow.fbo);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f); // slope-scaled bias against acne
+    glUseProgram(shadow.program);
+    glBindVertexArray(light.vao);
+    glm::mat4 lightView = cascades.lightView();
+    glUniformMatrix4fv(shadow.locs.view, 1, GL_FALSE, glm::value_ptr(lightView));
+    for (unsigned int c = 0; c < NR_CASCADES; ++c) {
+      const auto &cascade = cascades.cascade(c);
+      glUniformMatrix4fv(shadow.locs.projection, 1, GL_FALSE,
+                         glm::value_ptr(cascade.projection));
+      if (cascade.staticChanged) {
+        ++nrStaticRenders;
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow.staticMaps,
+                                  0, c);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        for (unsigned int i = 0; i < NR_CUBES; i++) {
+          glm::vec3 pos = cubePos(i, time);
+          if (isDynamic(i) || !cascades.covers(c, cubeBounds(pos))) {
+            continue;
+          }
+          glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+          glUniformMatrix4fv(shadow.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+          glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+        }
+      }
+
+      glCopyImageSubData(shadow.staticMaps, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c, shadow.maps,
+                         GL_TEXTURE_2D_ARRAY, 0, 0, 0, c, SHADOW_RESOLUTION,
+                         SHADOW_RESOLUTION, 1);
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow.maps, 0, c);
+      for (unsigned int i = 0; i < NR_CUBES; i++) {
+        glm::vec3 pos = cubePos(i, time);
+        if (!isDynamic(i) || !cascades.covers(c, cubeBounds(pos))) {
+          continue;
+        }
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+        glUniformMatrix4fv(shadow.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+        glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+      }
+    }
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    // glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 100.0f);
+
+    glUseProgram(cube.program);
+
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(cube.locs.wsCameraPos, camera.pos.x, camera.pos.y, camera.pos.z);
+
+    auto dirLightColor = glm::vec3(1.0f, 0.0f, 1.0f);
+    auto dirLightDir   = view * glm::vec4(dirLightWsDir, 0.0f);
+    glUniform3f(cube.locs.dirLight.direction, dirLightDir.x, dirLightDir.y,
+                dirLightDir.z);
+    glUniform3f(cube.locs.dirLight.ambient, 0.2f * dirLightColor.x,
+                0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.diffuse, 0.5f * dirLightColor.x,
+                0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.specular, 1.0f * dirLightColor.x,
+                1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+    glm::vec4 spotLightViewPoss[] = {
+      view * glm::vec4(lightPos, 1.0),
+      view * glm::vec4(5.0, 0.0, 4.0, 1.0),
+      view * glm::vec4(5.0, 5.0, 4.0, 1.0),
+      view * glm::vec4(5.0, 10.0, 4.0, 1.0),
+    };
+    glm::vec3 spotLightViewDirs[] = {
+      view * glm::vec4(0.0, 0.0, 0.0, 1.0) - spotLightViewPoss[0],
+      view * glm::vec4(0.0, 0.0, -20.0, 1.0) - spotLightViewPoss[1],
+      view * glm::vec4(0.0, 0.0, -20.0, 1.0) - spotLightViewPoss[2],
+      view * glm::vec4(0.0, 0.0, -20.0, 1.0) - spotLightViewPoss[3],
+    };
+    glm::vec3 spotLightColors[] = {
+      glm::vec3(1.0, 0.0, 0.0),
+      glm::vec3(0.0, 1.0, 0.0),
+      glm::vec3(0.0, 0.0, 1.0),
+      glm::vec3(1.0, 0.0, 0.0),
+    };
+
+    for (int i = 0; i < NR_SPOT_LIGHTS; ++i) {
+      auto &viewPos = spotLightViewPoss[i];
+      auto &dir     = spotLightViewDirs[i];
+      auto &color   = spotLightColors[i];
+      glUniform3f(cube.locs.spotLights[i].v_pos, viewPos.x, viewPos.y, viewPos.z);
+      glUniform3f(cube.locs.spotLights[i].direction, dir.x, dir.y, dir.z);
+      glUniform1f(cube.locs.spotLights[i].spotlightCosInner,
+                  glm::cos(glm::pi<float>() * 0.06));
+      glUniform1f(cube.locs.spotLights[i].spotlightCosOuter,
+                  glm::cos(glm::pi<float>() * 0.07));
+      glUniform3f(cube.locs.spotLights[i].ambient, 0.2f * color.x, 0.2f * color.y,
+                  0.2f * color.z);
+      glUniform3f(cube.locs.spotLights[i].diffuse, 0.5f * color.x, 0.5f * color.y,
+                  0.5f * color.z);
+      glUniform3f(cube.locs.spotLights[i].specular, color.x, color.y, color.z);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+    glUniform1f(cube.locs.material.shininess, 64.0f);
+
+    glm::mat4 invView = glm::inverse(view);
+    glm::mat4 shadowMatrices[NR_CASCADES];
+    float     cascadeSplits[NR_CASCADES];
+    float     cascadeTexelSizes[NR_CASCADES];
+    for (unsigned int c = 0; c < NR_CASCADES; ++c) {
+      shadowMatrices[c]    = cascades.viewProjection(c) * invView;
+      cascadeSplits[c]     = cascades.cascade(c).splitFar;
+      cascadeTexelSizes[c] = cascades.texelSize(c);
+    }
+    glUniformMatrix4fv(cube.locs.shadowMatrices, NR_CASCADES, GL_FALSE,
+                       glm::value_ptr(shadowMatrices[0]));
+    glUniform1fv(cube.locs.cascadeSplits, NR_CASCADES, cascadeSplits);
+    glUniform1fv(cube.locs.cascadeTexelSizes, NR_CASCADES, cascadeTexelSizes);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadow.maps);
+
+    for (unsigned int i = 0; i < NR_CUBES; i++) {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePos(i, time));
+      glUniformMatrix4fv(cube.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+
+      glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+    }
+
+    if (time - titleTime > 0.5f) {
+      auto title = CURRENT_BASENAME() + " -- static cascade renders/s: " +
+                   std::to_string((int)(nrStaticRenders / (time - titleTime)));
+      glfwSetWindowTitle(window, title.c_str());
+      titleTime       = time;
+      nrStaticRenders = 0;
+    }
+
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, lightPos);
+    model = glm::scale(model, glm::vec3(0.1f));
+    glUseProgram(light.program);
+    glBindVertexArray(light.vao);
+    glUniformMatrix4fv(light.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(light.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(light.locs.model, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3f(light.locs.lightColor, spotLightColors[0].x, spotLightColors[0].y,
+                spotLightColors[0].z);
+    glDrawElements(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0);
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  cube.cleanup();
+  light.cleanup();
+  shadow.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+    light.reload();
+  }
+
+  // fixme: debug: move cube
+  const float speed = 2.0f * dt;
+  if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+    lightPos.z -= speed;
+  if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
+    lightPos.z += speed;
+  if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+    lightPos.x -= speed;
+  if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
+    lightPos.x += speed;
+  if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS)
+    lightPos.y += speed;
+  if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS)
+    lightPos.y -= speed;
+
+  camera.pollKeyboard(window, dt);
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, cubeFragmentShaderPath);
+
+  // get uniform locations
+  locs.model              = glGetUniformLocation(program, "model");
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+
+  locs.dirLight.direction = glGetUniformLocation(program, "dir_light.direction");
+  locs.dirLight.ambient   = glGetUniformLocation(program, "dir_light.ambient");
+  locs.dirLight.diffuse   = glGetUniformLocation(program, "dir_light.diffuse");
+  locs.dirLight.specular  = glGetUniformLocation(program, "dir_light.specular");
+
+#define GET_ITH_SPOTLIGHT_LOCS(i)                                                        \
+  do {                                                                                   \
+    locs.spotLights[i].v_pos =                                                           \
+        glGetUniformLocation(program, "spot_lights[" #i "].v_pos");                      \
+    locs.spotLights[i].direction =                                                       \
+        glGetUniformLocation(program, "spot_lights[" #i "].direction");                  \
+    locs.spotLights[i].spotlightCosInner =                                               \
+        glGetUniformLocation(program, "spot_lights[" #i "].spotlight_cos_inner");        \
+    locs.spotLights[i].spotlightCosOuter =                                               \
+        glGetUniformLocation(program, "spot_lights[" #i "].spotlight_cos_outer");        \
+    locs.spotLights[i].ambient =                                                         \
+        glGetUniformLocation(program, "spot_lights[" #i "].ambient");                    \
+    locs.spotLights[i].diffuse =                                                         \
+        glGetUniformLocation(program, "spot_lights[" #i "].diffuse");                    \
+    locs.spotLights[i].specular =                                                        \
+        glGetUniformLocation(program, "spot_lights[" #i "].specular");                   \
+  } while (0)
+
+  GET_ITH_SPOTLIGHT_LOCS(0);
+  GET_ITH_SPOTLIGHT_LOCS(1);
+  GET_ITH_SPOTLIGHT_LOCS(2);
+  GET_ITH_SPOTLIGHT_LOCS(3);
+
+#undef GET_ITH_SPOTLIGHT_LOCS
+
+  locs.shadowMaps        = glGetUniformLocation(program, "shadow_maps");
+  locs.shadowMatrices    = glGetUniformLocation(program, "shadow_matrices");
+  locs.cascadeSplits     = glGetUniformLocation(program, "cascade_splits");
+  locs.cascadeTexelSizes = glGetUniformLocation(program, "cascade_texel_sizes");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUniform1i(locs.shadowMaps, SHADOW_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteProgram(cube.program);
+}
+
+void LightContext::init(const CubeContext &cube) {
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindBuffer(GL_ARRAY_BUFFER, cube.vbo);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind
+  glBindVertexArray(0);             // unbind
+}
+
+void LightContext::reload() {
+  reloadProgram(program, lightVertexShaderPath, lightFragmentShaderPath);
+
+  // get uniform locations
+  locs.model      = glGetUniformLocation(program, "model");
+  locs.view       = glGetUniformLocation(program, "view");
+  locs.projection = glGetUniformLocation(program, "projection");
+  locs.lightColor = glGetUniformLocation(program, "light_color");
+
+  // set constant uniforms -- N/A
+}
+
+void LightContext::cleanup() {
+  glDeleteBuffers(1, &vao);
+  glDeleteBuffers(1, &ebo);
+  glDeleteProgram(program);
+}
+
+static GLuint makeShadowMapArray() {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, SHADOW_RESOLUTION,
+                 SHADOW_RESOLUTION, NR_CASCADES);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor); // lit
+  // sampler2DArrayShadow: hardware depth compare, bilinear filtered
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  return texture;
+}
+
+void ShadowContext::init() {
+  staticMaps = makeShadowMapArray();
+  maps       = makeShadowMapArray();
+
+  fbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, maps, 0, 0);
+  glDrawBuffer(GL_NONE); // depth only
+  glReadBuffer(GL_NONE);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "shadow framebuffer incomplete" << std::endl;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowContext::reload() {
+  reloadProgram(program, lightVertexShaderPath, shadowFragShaderPath);
+
+  // get uniform locations
+  locs.model      = glGetUniformLocation(program, "model");
+  locs.view       = glGetUniformLocation(program, "view");
+  locs.projection = glGetUniformLocation(program, "projection");
+
+  // set constant uniforms -- N/A
+}
+
+void ShadowContext::cleanup() {
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &staticMaps);
+  glDeleteTextures(1, &maps);
+  glDeleteProgram(program);
+}
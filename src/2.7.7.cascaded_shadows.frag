@@ -0,0 +1,132 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 v_normal;
+in vec3 v_pos;
+in vec2 tex_coord;
+
+// derived from 2.6.1.multilights.frag -- the directional light is shadowed by
+// cascaded shadow maps, see ShadowCascades in cascaded_shadows.h
+
+#define NR_CASCADES 4 // keep in sync with ShadowCascades::NR_CASCADES
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction; // from light towards object
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 v_pos;
+    vec3 direction;
+    float spotlight_cos_inner;
+    float spotlight_cos_outer;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Material material;
+uniform DirLight dir_light;
+#define NR_SPOT_LIGHTS 4
+uniform SpotLight spot_lights[NR_SPOT_LIGHTS];
+
+uniform sampler2DArrayShadow shadow_maps;
+uniform mat4 shadow_matrices[NR_CASCADES]; // view space -> cascade clip space
+uniform float cascade_splits[NR_CASCADES]; // view-space distance each cascade ends at
+uniform float cascade_texel_sizes[NR_CASCADES];
+
+float shadowFactor();
+vec3 dirLightColor(DirLight light);
+vec3 spotLightColor(SpotLight light);
+
+void main() {
+    vec3 res = dirLightColor(dir_light);
+    for(int i = 0; i < NR_SPOT_LIGHTS; ++i) {
+        res += spotLightColor(spot_lights[i]);
+    }
+    FragColor = vec4(res, 1.0);
+}
+
+
+vec3 dirLightColor(DirLight light) {
+    vec3 light_dir = normalize(-light.direction); // from object towards source
+
+    vec3 ambient = light.ambient * vec3(texture(material.diffuse, tex_coord));
+
+    vec3 norm = normalize(v_normal);
+    float cos_theta = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta * light.diffuse * vec3(texture(material.diffuse, tex_coord));
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), material.shininess);
+    vec3 specular = spec * light.specular * vec3(texture(material.specular, tex_coord));
+
+    vec3 res = ambient + shadowFactor() * (diffuse + specular);
+
+    return res;
+}
+
+// fraction of the directional light reaching this fragment, 3x3 PCF
+float shadowFactor() {
+    float d = -v_pos.z;
+    int cascade = 0;
+    while (cascade < NR_CASCADES && d > cascade_splits[cascade]) {
+        ++cascade;
+    }
+    if (cascade == NR_CASCADES) {
+        return 1.0; // beyond the shadow distance
+    }
+
+    // push the lookup off the surface by about a texel against acne
+    vec3 offset_pos = v_pos + normalize(v_normal) * 1.5 * cascade_texel_sizes[cascade];
+    vec4 clip = shadow_matrices[cascade] * vec4(offset_pos, 1.0);
+    vec3 coord = clip.xyz / clip.w * 0.5 + 0.5;
+
+    vec2 texel = 1.0 / vec2(textureSize(shadow_maps, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            vec2 uv = coord.xy + vec2(x, y) * texel;
+            lit += texture(shadow_maps, vec4(uv, cascade, coord.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+vec3 spotLightColor(SpotLight light) {
+    vec3 ambient = light.ambient * vec3(texture(material.diffuse, tex_coord));
+
+    vec3 norm = normalize(v_normal);
+    vec3 light_dir = normalize(light.v_pos - v_pos); // towards light source
+    float cos_theta_surface = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta_surface * light.diffuse * vec3(texture(material.diffuse, tex_coord));
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), material.shininess);
+    vec3 specular = spec * light.specular * vec3(texture(material.specular, tex_coord));
+
+    vec3 res = ambient + diffuse + specular;
+
+    float d_2 = dot(v_pos - light.v_pos, v_pos - light.v_pos); // squared distance
+    float d = sqrt(d_2);
+    float k_0 = 1.0;
+    float k_1 = 0.009;
+    float k_2 = 0.0032;
+    float f_att = 1.0/(k_0 + k_1 * d + k_2 * d_2);
+    res *= f_att;
+
+    float cos_theta_spotlight = dot(light_dir, -normalize(light.direction)); // away from spotlight center
+    res *= smoothstep(light.spotlight_cos_outer, light.spotlight_cos_inner, cos_theta_spotlight);
+
+    return res;
+}
\ No newline at end of file
@@ -0,0 +1,448 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "light_assignment.h"
+#include "lights.h"
+#include "shader_program.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+constexpr GLuint LIGHTS_BINDING = 0;
+
+constexpr const int NR_LIGHTS = 64; // keep in sync with 2.7.8.light_lists.frag
+constexpr const int NR_CUBES  = 1000;
+
+// wider cones than 2.6.1 so the scattered lights visibly overlap
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+// point lights share the spot light layout with a cone covering every direction
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+// stronger falloff than 2.6.1 so each light reaches only a few cubes
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+// per-instance vertex data -- attributes 3 and 4 of 2.7.8.light_lists.vert
+struct CubeInstance {
+  glm::vec3  offset;
+  glm::uvec4 lights; // LightAssignment::LightList, two 16-bit indices per component
+};
+
+struct DirLightLocs {
+  GLint direction;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  unsigned int instanceVbo;
+  GLuint       diffuseTexture;
+  GLuint       specularTexture;
+  GLuint       lightsUbo;
+  GLuint       program;
+  struct Locations {
+    GLint        view;
+    GLint        projection;
+    MaterialLocs material;
+    DirLightLocs dirLight;
+    GLint        attenuation;
+  } locs;
+
+  void init();
+  void reload();
+  void cleanup();
+};
+
+struct WorldLight {
+  bool      isSpot;
+  glm::vec3 pos;
+  glm::vec3 direction;
+  glm::vec3 color;
+  float     spin; // radians per second about +y
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.7.8.light_lists.vert";
+const char *cubeFragmentShaderPath = "src/2.7.8.light_lists.frag";
+
+CubeContext cube{};
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+bool animate     = true;
+
+glm::vec3 cubePos(unsigned int i) {
+  return 2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+         glm::vec3(5.0f);
+}
+
+// lights scattered through the cube grid, spots pointing in random directions
+std::vector<WorldLight> makeLights() {
+  std::vector<WorldLight> res(NR_LIGHTS);
+  for (uint32_t i = 0; i < NR_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    res[i].isSpot    = i % 2 == 0;
+    res[i].pos       = rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f);
+    res[i].direction = glm::normalize(rand3(1) - glm::vec3(0.5f));
+    res[i].color     = glm::normalize(rand3(2));
+    res[i].spin      = rand3(3).x - 0.5f;
+  }
+  return res;
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+                         animate = !animate;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+  cube.reload();
+
+  auto  lights = makeLights();
+  float range  = attenuationRange(LIGHT_ATTENUATION);
+
+  std::vector<Aabb> cubeBounds;
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    cubeBounds.push_back(
+        Aabb{ .min = cubePos(i) - glm::vec3(0.5f), .max = cubePos(i) + glm::vec3(0.5f) });
+  }
+
+  LightAssignment             assignment(range);
+  std::vector<LightInfluence> influences(NR_LIGHTS);
+  std::vector<CubeInstance>   instances(NR_CUBES);
+  std::vector<GpuSpotLight>   gpuLights(NR_LIGHTS);
+
+  float  titleTime    = 0.0f;
+  double assignMicros = 0.0;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      cube.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    if (animate) {
+      for (auto &light : lights) {
+        glm::mat4 spin = glm::rotate(glm::mat4(1.0f), light.spin * dt, Camera::UP);
+        light.direction = glm::vec3(spin * glm::vec4(light.direction, 0.0f));
+      }
+    }
+
+    // assign lights to cubes and pack the lists into the instance data
+    auto assignStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+      influences[i] = {
+        .pos       = lights[i].pos,
+        .range     = range,
+        .direction = lights[i].direction,
+        .cosOuter  = lights[i].isSpot ? COS_OUTER : POINT_COS_OUTER,
+      };
+    }
+    assignment.assign(influences, cubeBounds);
+    size_t nrAssigned = 0;
+    for (unsigned int i = 0; i < NR_CUBES; i++) {
+      const auto &list = assignment.lights(i);
+      instances[i].offset = cubePos(i);
+      for (int k = 0; k < 4; ++k) {
+        instances[i].lights[k] = list[2 * k] | (uint32_t)list[2 * k + 1] << 16;
+      }
+      nrAssigned += std::ranges::find(list, LightAssignment::NO_LIGHT) - list.begin();
+    }
+    assignMicros = std::chrono::duration<double, std::micro>(
+                       std::chrono::steady_clock::now() - assignStart)
+                       .count();
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 100.0f);
+
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+      glm::vec3 viewPos  = view * glm::vec4(lights[i].pos, 1.0f);
+      glm::vec3 viewDir  = view * glm::vec4(lights[i].direction, 0.0f);
+      float     cosOuter = lights[i].isSpot ? COS_OUTER : POINT_COS_OUTER;
+      float     cosInner = lights[i].isSpot ? COS_INNER : POINT_COS_INNER;
+      gpuLights[i]       = {
+              .vPosRange         = glm::vec4(viewPos, range),
+              .directionCosOuter = glm::vec4(viewDir, cosOuter),
+              .colorCosInner     = glm::vec4(lights[i].color, cosInner),
+      };
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, cube.lightsUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GpuSpotLight) * gpuLights.size(),
+                    gpuLights.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, cube.instanceVbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(CubeInstance) * instances.size(),
+                    instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(cube.program);
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(cube.locs.attenuation, LIGHT_ATTENUATION.k0, LIGHT_ATTENUATION.k1,
+                LIGHT_ATTENUATION.k2);
+
+    auto dirLightColor = glm::vec3(0.3f, 0.3f, 0.4f);
+    auto dirLightDir   = view * glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    glUniform3f(cube.locs.dirLight.direction, dirLightDir.x, dirLightDir.y,
+                dirLightDir.z);
+    glUniform3f(cube.locs.dirLight.ambient, 0.2f * dirLightColor.x,
+                0.2f * dirLightColor.y, 0.2f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.diffuse, 0.5f * dirLightColor.x,
+                0.5f * dirLightColor.y, 0.5f * dirLightColor.z);
+    glUniform3f(cube.locs.dirLight.specular, 1.0f * dirLightColor.x,
+                1.0f * dirLightColor.y, 1.0f * dirLightColor.z);
+
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.specularTexture);
+    glUniform1f(cube.locs.material.shininess, 64.0f);
+
+    glDrawElementsInstanced(GL_TRIANGLES, std::size(cubeIndices), GL_UNSIGNED_INT, 0,
+                            NR_CUBES);
+
+    if (time - titleTime > 0.5f) {
+      titleTime  = time;
+      auto title = CURRENT_BASENAME() + " -- assign " +
+                   std::to_string((int)assignMicros) + "us, " +
+                   std::to_string(nrAssigned / (float)NR_CUBES) + " lights/cube" +
+                   (animate ? "" : " (paused)");
+      glfwSetWindowTitle(window, title.c_str());
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  cube.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void CubeContext::init() {
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, CUBE_POS_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_POS_OFF));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, CUBE_TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_TEX_OFF)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, CUBE_NORMAL_SIZE, GL_FLOAT, GL_FALSE, sizeof(CubeVertex),
+                        (void *)(CUBE_NORMAL_OFF));
+  glEnableVertexAttribArray(2);
+
+  instanceVbo = 0;
+  glGenBuffers(1, &instanceVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(CubeInstance) * NR_CUBES, nullptr,
+               GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                        (void *)offsetof(CubeInstance, offset));
+  glEnableVertexAttribArray(3);
+  glVertexAttribDivisor(3, 1);
+  glVertexAttribIPointer(4, 4, GL_UNSIGNED_INT, sizeof(CubeInstance),
+                         (void *)offsetof(CubeInstance, lights)); // integer, no convert
+  glEnableVertexAttribArray(4);
+  glVertexAttribDivisor(4, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+
+  lightsUbo = 0;
+  glGenBuffers(1, &lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, lightsUbo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuSpotLight) * NR_LIGHTS, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lightsUbo);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  specularTexture = 0;
+  glGenTextures(1, &specularTexture);
+  glBindTexture(GL_TEXTURE_2D, specularTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto specularImage = stb::Image("assets/container2_specular.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, cubeFragmentShaderPath);
+
+  // get uniform locations
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.dirLight.direction = glGetUniformLocation(program, "dir_light.direction");
+  locs.dirLight.ambient   = glGetUniformLocation(program, "dir_light.ambient");
+  locs.dirLight.diffuse   = glGetUniformLocation(program, "dir_light.diffuse");
+  locs.dirLight.specular  = glGetUniformLocation(program, "dir_light.specular");
+  locs.attenuation        = glGetUniformLocation(program, "attenuation");
+
+  // set constant uniforms
+  glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Lights"),
+                        LIGHTS_BINDING);
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &instanceVbo);
+  glDeleteBuffers(1, &lightsUbo);
+  glDeleteProgram(program);
+}
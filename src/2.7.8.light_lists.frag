@@ -0,0 +1,106 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 v_normal;
+in vec3 v_pos;
+in vec2 tex_coord;
+flat in uvec4 light_list;
+
+// derived from 2.7.4.forward_plus.frag -- instead of a per-tile list, each object
+// carries a short list of the lights reaching it, assigned on the CPU
+
+#define NR_LIGHTS 64 // keep in sync with 2.7.8.light_lists.cpp
+#define MAX_LIGHTS_PER_OBJECT 8 // keep in sync with LightAssignment
+#define NO_LIGHT 0xffffu
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction; // from light towards object
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec4 v_pos_range;         // xyz: view-space position, w: attenuation range
+    vec4 direction_cos_outer; // xyz: view-space direction, w: cos of outer cutoff
+    vec4 color_cos_inner;     // rgb: color, w: cos of inner cutoff
+};
+
+layout(std140) uniform Lights {
+    SpotLight spot_lights[NR_LIGHTS];
+};
+
+uniform Material material;
+uniform DirLight dir_light;
+uniform vec3 attenuation; // k_0, k_1, k_2
+
+vec3 dirLightColor(DirLight light, vec3 diffuse_color, vec3 specular_color);
+vec3 spotLightColor(SpotLight light, vec3 diffuse_color, vec3 specular_color);
+
+void main() {
+    vec3 diffuse_color = vec3(texture(material.diffuse, tex_coord));
+    vec3 specular_color = vec3(texture(material.specular, tex_coord));
+
+    vec3 res = dirLightColor(dir_light, diffuse_color, specular_color);
+
+    for (int i = 0; i < MAX_LIGHTS_PER_OBJECT; ++i) {
+        uint index = (light_list[i / 2] >> (16 * (i % 2))) & 0xffffu;
+        if (index == NO_LIGHT) {
+            break;
+        }
+        res += spotLightColor(spot_lights[index], diffuse_color, specular_color);
+    }
+    FragColor = vec4(res, 1.0);
+}
+
+vec3 dirLightColor(DirLight light, vec3 diffuse_color, vec3 specular_color) {
+    vec3 light_dir = normalize(-light.direction); // from object towards source
+
+    vec3 ambient = light.ambient * diffuse_color;
+
+    vec3 norm = normalize(v_normal);
+    float cos_theta = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta * light.diffuse * diffuse_color;
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), material.shininess);
+    vec3 specular = spec * light.specular * specular_color;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 spotLightColor(SpotLight light, vec3 diffuse_color, vec3 specular_color) {
+    vec3 color = light.color_cos_inner.rgb;
+    vec3 light_pos = light.v_pos_range.xyz;
+
+    vec3 ambient = 0.2 * color * diffuse_color;
+
+    vec3 norm = normalize(v_normal);
+    vec3 light_dir = normalize(light_pos - v_pos); // towards light source
+    float cos_theta_surface = max(0.0, dot(norm, light_dir));
+    vec3 diffuse = cos_theta_surface * 0.5 * color * diffuse_color;
+
+    vec3 camera_dir = normalize(-v_pos);
+    vec3 bounce_dir = reflect(-light_dir, norm);
+    float spec = pow(max(0.0, dot(camera_dir, bounce_dir)), material.shininess);
+    vec3 specular = spec * color * specular_color;
+
+    vec3 res = ambient + diffuse + specular;
+
+    float d_2 = dot(v_pos - light_pos, v_pos - light_pos); // squared distance
+    float d = sqrt(d_2);
+    float f_att = 1.0/(attenuation.x + attenuation.y * d + attenuation.z * d_2);
+    res *= f_att;
+
+    float cos_theta_spotlight = dot(light_dir, -normalize(light.direction_cos_outer.xyz)); // away from spotlight center
+    res *= smoothstep(light.direction_cos_outer.w, light.color_cos_inner.w, cos_theta_spotlight);
+
+    return res;
+}
@@ -0,0 +1,417 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "cube_info.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "image.h"
+#include "lightmap.h"
+#include "lights.h"
+#include "shader_program.h"
+#include "thread_pool.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int LIGHTMAP_TEXTURE_UNIT = 6;
+
+constexpr const int NR_LIGHTS = 64;
+constexpr const int NR_CUBES  = 1000;
+
+// wider cones than 2.6.1 so the scattered lights visibly overlap
+const float COS_INNER = glm::cos(glm::pi<float>() * 0.15f);
+const float COS_OUTER = glm::cos(glm::pi<float>() * 0.20f);
+
+// point lights share the spot light layout with a cone covering every direction
+constexpr float POINT_COS_INNER = -1.0f;
+constexpr float POINT_COS_OUTER = -2.0f;
+
+// stronger falloff than 2.6.1 so each light reaches only a few cubes
+constexpr Attenuation LIGHT_ATTENUATION{ .k0 = 1.0f, .k1 = 0.7f, .k2 = 1.8f };
+
+const glm::vec3 DIR_LIGHT_COLOR = glm::vec3(0.3f, 0.3f, 0.4f);
+const glm::vec3 DIR_LIGHT_DIR   = glm::vec3(-1.0f, -1.0f, 0.0f); // world space
+
+// the whole grid pre-transformed into one static mesh, with a chart per face
+struct LightmapVertex {
+  float pos[3]; // world space
+  float tex[2];
+  float lightmapUv[2];
+};
+
+struct CubeContext {
+  unsigned int vbo;
+  unsigned int vao;
+  unsigned int ebo;
+  GLsizei      nrIndices;
+  GLuint       diffuseTexture;
+  GLuint       lightmapTexture;
+  glm::vec3    albedo; // mean of the diffuse map, for the bounce
+  GLuint       program;
+  struct Locations {
+    GLint view;
+    GLint projection;
+    GLint diffuse;
+    GLint lightmap;
+    GLint ambient;
+    GLint showLightmap;
+  } locs;
+
+  void init();
+  void initMesh(const Lightmap &lightmap);
+  void uploadLightmap(const Lightmap &lightmap);
+  void reload();
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *cubeVertexShaderPath   = "src/2.7.9.lightmap.vert";
+const char *cubeFragmentShaderPath = "src/2.7.9.lightmap.frag";
+
+// relative to the working directory, eg: the build directory
+const std::string lightmapCachePath = CURRENT_BASENAME() + ".lmap";
+
+CubeContext cube{};
+
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus  = true;
+bool rebake       = false;
+bool showLightmap = false;
+
+glm::vec3 cubePos(unsigned int i) {
+  return 2.0f * glm::vec3((float)(i % 10), (float)((i / 10) % 10), -(float)(i / 100)) -
+         glm::vec3(5.0f);
+}
+
+// every cube face as a quad, in the same order as the mesh built by initMesh,
+// lit by dir_light and the static lights scattered through the grid
+LightmapScene makeScene(glm::vec3 albedo) {
+  LightmapScene res;
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    // cube_info lists each face as 4 vertices with tex coords (0,0) (1,0) (1,1) (0,1)
+    for (unsigned int f = 0; f < std::size(cubeVertices) / 4; ++f) {
+      auto pos = [&](unsigned int k) {
+        const auto &v = cubeVertices[4 * f + k].pos;
+        return glm::vec3(v[0], v[1], v[2]);
+      };
+      res.quads.push_back({
+          .origin = cubePos(i) + pos(0),
+          .edgeU  = pos(1) - pos(0),
+          .edgeV  = pos(3) - pos(0),
+          .albedo = albedo,
+      });
+    }
+  }
+
+  res.dirLight = { .direction = DIR_LIGHT_DIR, .color = 0.5f * DIR_LIGHT_COLOR };
+
+  for (uint32_t i = 0; i < NR_LIGHTS; ++i) {
+    auto rand3 = [i](uint32_t k) {
+      return glm::vec3(whisky2f(i, 3 * k), whisky2f(i, 3 * k + 1),
+                       whisky2f(i, 3 * k + 2));
+    };
+    bool isSpot = i % 2 == 0;
+    res.spotLights.push_back({
+        .pos         = rand3(0) * 18.0f - glm::vec3(5.0f, 5.0f, 23.0f),
+        .direction   = glm::normalize(rand3(1) - glm::vec3(0.5f)),
+        .color       = glm::normalize(rand3(2)),
+        .cosInner    = isSpot ? COS_INNER : POINT_COS_INNER,
+        .cosOuter    = isSpot ? COS_OUTER : POINT_COS_OUTER,
+        .attenuation = LIGHT_ATTENUATION,
+    });
+  }
+  return res;
+}
+
+/** loads the cached bake if it matches scene (unless force), otherwise bakes and
+ * caches it. returns what was done, for the window title. */
+std::string loadOrBake(Lightmap &lightmap, const LightmapScene &scene, ThreadPool &pool,
+                       bool force) {
+  auto     start = std::chrono::steady_clock::now();
+  uint64_t key   = lightmap.key(scene);
+  bool     baked = force || !lightmap.load(lightmapCachePath, key);
+  if (baked) {
+    lightmap.bake(scene, pool);
+    lightmap.save(lightmapCachePath, key);
+  }
+  auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                      start)
+                .count();
+  return (baked ? "baked in " : "loaded in ") + std::to_string((int)ms) + "ms";
+}
+
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+    ;
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+                         rebake = true;
+                       }
+                       if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+                         showLightmap = !showLightmap;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  cube.init();
+  cube.reload();
+
+  ThreadPool    pool;
+  LightmapScene scene = makeScene(cube.albedo);
+  Lightmap      lightmap(scene.quads.size(), LightmapSettings{});
+  auto          setTitle = [&](const std::string &bakeInfo) {
+    auto title = CURRENT_BASENAME() + " -- lightmap " + bakeInfo + ", B rebakes";
+    glfwSetWindowTitle(window, title.c_str());
+  };
+  setTitle(loadOrBake(lightmap, scene, pool, false));
+  cube.initMesh(lightmap);
+  cube.uploadLightmap(lightmap);
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(cubeVertexShaderPath) || fileChanged(cubeFragmentShaderPath)) {
+      cube.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    if (rebake) {
+      rebake = false;
+      setTitle(loadOrBake(lightmap, scene, pool, true));
+      cube.uploadLightmap(lightmap);
+    }
+
+    glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = camera.view();
+    projection =
+        glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.1f, 100.0f);
+
+    glUseProgram(cube.program);
+    glBindVertexArray(cube.vao);
+    glUniformMatrix4fv(cube.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(cube.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(cube.locs.ambient, 0.2f * DIR_LIGHT_COLOR.x, 0.2f * DIR_LIGHT_COLOR.y,
+                0.2f * DIR_LIGHT_COLOR.z);
+    glUniform1i(cube.locs.showLightmap, showLightmap);
+
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.diffuseTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, cube.lightmapTexture);
+
+    // every light in one fetch per fragment, and the whole grid in one draw
+    glDrawElements(GL_TRIANGLES, cube.nrIndices, GL_UNSIGNED_INT, 0);
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  cube.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    cube.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void CubeContext::init() {
+  diffuseTexture = 0;
+  glGenTextures(1, &diffuseTexture);
+  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+  stbi_set_flip_vertically_on_load(true);
+  auto diffuseImage = stb::Image("assets/container2.png");
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  glm::dvec3 sum(0.0);
+  size_t     nrPixels = (size_t)diffuseImage.width * diffuseImage.height;
+  for (size_t p = 0; p < nrPixels; ++p) {
+    const unsigned char *px = diffuseImage.data + p * diffuseImage.nrChannels;
+    sum += glm::dvec3(px[0], px[1], px[2]);
+  }
+  albedo = glm::vec3(sum / (255.0 * nrPixels));
+
+  lightmapTexture = 0;
+  glGenTextures(1, &lightmapTexture);
+  glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+  // no mipmaps -- coarser levels would blend neighbouring charts
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void CubeContext::initMesh(const Lightmap &lightmap) {
+  std::vector<LightmapVertex> vertices;
+  std::vector<unsigned int>   indices;
+  for (unsigned int i = 0; i < NR_CUBES; i++) {
+    glm::vec3 offset = cubePos(i);
+    for (unsigned int k = 0; k < std::size(cubeVertices); ++k) {
+      const auto &v  = cubeVertices[k];
+      uint32_t    q  = i * std::size(cubeVertices) / 4 + k / 4; // as in makeScene
+      glm::vec2   uv = lightmap.uv(q, glm::vec2(v.tex[0], v.tex[1]));
+      vertices.push_back({
+          .pos        = { v.pos[0] + offset.x, v.pos[1] + offset.y, v.pos[2] + offset.z },
+          .tex        = { v.tex[0], v.tex[1] },
+          .lightmapUv = { uv.x, uv.y },
+      });
+    }
+    for (auto idx : cubeIndices) {
+      indices.push_back(i * std::size(cubeVertices) + idx);
+    }
+  }
+  nrIndices = indices.size();
+
+  vbo = 0;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(LightmapVertex) * vertices.size(), vertices.data(),
+               GL_STATIC_DRAW);
+
+  vao = 0;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  ebo = 0;
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(),
+               indices.data(), GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LightmapVertex),
+                        (void *)offsetof(LightmapVertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(LightmapVertex),
+                        (void *)offsetof(LightmapVertex, tex)); // texture coords
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(LightmapVertex),
+                        (void *)offsetof(LightmapVertex, lightmapUv));
+  glEnableVertexAttribArray(2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+  glBindVertexArray(0);             // unbind -- for debugging
+}
+
+void CubeContext::uploadLightmap(const Lightmap &lightmap) {
+  glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB9_E5, lightmap.width(), lightmap.height(), 0,
+               GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, lightmap.texels().data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CubeContext::reload() {
+  reloadProgram(program, cubeVertexShaderPath, cubeFragmentShaderPath);
+
+  // get uniform locations
+  locs.view         = glGetUniformLocation(program, "view");
+  locs.projection   = glGetUniformLocation(program, "projection");
+  locs.diffuse      = glGetUniformLocation(program, "material.diffuse");
+  locs.lightmap     = glGetUniformLocation(program, "lightmap");
+  locs.ambient      = glGetUniformLocation(program, "ambient");
+  locs.showLightmap = glGetUniformLocation(program, "show_lightmap");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.lightmap, LIGHTMAP_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CubeContext::cleanup() {
+  glDeleteBuffers(1, &ebo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteTextures(1, &diffuseTexture);
+  glDeleteTextures(1, &lightmapTexture);
+  glDeleteProgram(program);
+}
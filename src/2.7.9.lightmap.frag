@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 tex_coord;
+in vec2 lightmap_uv;
+
+struct Material {
+    sampler2D diffuse;
+};
+
+uniform Material material;
+uniform sampler2D lightmap; // diffuse irradiance of every static light, shadows and one bounce
+uniform vec3 ambient;
+uniform bool show_lightmap;
+
+void main() {
+    vec3 albedo = show_lightmap ? vec3(1.0) : vec3(texture(material.diffuse, tex_coord));
+    vec3 irradiance = texture(lightmap, lightmap_uv).rgb;
+    FragColor = vec4(albedo * (ambient + irradiance), 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout(location = 0) in vec3 l_pos; // world space -- the baked scene is static
+layout(location = 1) in vec2 in_tex_coord;
+layout(location = 2) in vec2 in_lightmap_uv;
+
+out vec2 tex_coord;
+out vec2 lightmap_uv;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    gl_Position = projection * view * vec4(l_pos, 1.0);
+    tex_coord = in_tex_coord;
+    lightmap_uv = in_lightmap_uv;
+}
@@ -12,6 +12,7 @@
 #include "gl_debug.h"
 #include "image.h"
 #include "shader_program.h"
+#include "texture_loader.h"
 
 #include <algorithm>
 #include <array>
@@ -102,8 +103,9 @@ const char *lightFragmentShaderPath = "src/2.1.light_source.frag";
 
 float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
 
-CubeContext  cube{};
-LightContext light{};
+CubeContext   cube{};
+LightContext  light{};
+TextureLoader textures{};
 
 glm::mat4 model      = glm::mat4(1.0f);
 glm::mat4 view       = glm::mat4(1.0f);
@@ -175,6 +177,8 @@ int main() {
   glDebugMessageCallback(glDebugMessageCb, 0);
 #endif
 
+  textures.init();
+
   cube.init();
   cube.reload();
 
@@ -192,6 +196,8 @@ int main() {
 
     processInput(window);
 
+    textures.update(); // a few decoded textures replace their placeholders
+
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -240,6 +246,7 @@ int main() {
 
   cube.cleanup();
   light.cleanup();
+  textures.cleanup();
 
   glfwTerminate();
   return 0;
@@ -305,25 +312,9 @@ void Mesh::init() {
   glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
   glBindVertexArray(0);             // unbind -- for debugging
 
-  GLuint diffuseTexture = 0;
-  glGenTextures(1, &diffuseTexture);
-  glBindTexture(GL_TEXTURE_2D, diffuseTexture);
-  stbi_set_flip_vertically_on_load(true);
-  auto diffuseImage = stb::Image("assets/container2.png");
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, diffuseImage.width, diffuseImage.height, 0,
-               GL_RGBA, GL_UNSIGNED_BYTE, diffuseImage.data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  diffuses.emplace_back(diffuseTexture);
-
-  GLuint specularTexture = 0;
-  glGenTextures(1, &specularTexture);
-  glBindTexture(GL_TEXTURE_2D, specularTexture);
-  stbi_set_flip_vertically_on_load(true);
-  auto specularImage = stb::Image("assets/container2_specular.png");
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, specularImage.width, specularImage.height, 0,
-               GL_RGBA, GL_UNSIGNED_BYTE, specularImage.data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  speculars.emplace_back(specularTexture);
+  // decoded on the loader's workers -- placeholders until then
+  diffuses.emplace_back(textures.load("assets/container2.png"));
+  speculars.emplace_back(textures.load("assets/container2_specular.png"));
 }
 
 void Mesh::draw(GLuint) {
@@ -337,6 +328,12 @@ void Mesh::draw(GLuint) {
 }
 
 void Mesh::cleanup() {
+  for (const auto &texture : diffuses) {
+    glDeleteTextures(1, &texture.id);
+  }
+  for (const auto &texture : speculars) {
+    glDeleteTextures(1, &texture.id);
+  }
   glDeleteBuffers(1, &ebo);
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
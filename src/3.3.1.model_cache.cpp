@@ -0,0 +1,366 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "mesh_cache.h"
+#include "shader_program.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// usage: 3.3.1.model_cache [--packed] [model] -- model relative to the repo root, in
+// any format assimp reads. the first run imports it and caches it in
+// baked/<model>.lmesh beside it, later runs map the cache instead (see lmesh::load).
+// --packed caches and draws 16 byte PackedVertex (see vertex_pack.h) instead.
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+
+struct LightLocs {
+  GLint v_pos;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct Material {
+  TextureCache::Handle diffuse;
+  TextureCache::Handle specular;
+  float                shininess;
+};
+
+struct ModelContext {
+  GLuint program;
+  GLuint vbo;
+  GLuint vao;
+  GLuint ebo;
+  GLuint white; // for materials without a texture
+  bool   packed;
+
+  std::vector<lmesh::Submesh> submeshes;
+  std::vector<Material>       materials;
+  glm::vec3                   center;
+  float                       radius;
+
+  struct Locations {
+    GLint        model;
+    GLint        view;
+    GLint        projection;
+    GLint        dequantizeOffset;
+    GLint        dequantizeScale;
+    MaterialLocs material;
+    LightLocs    light;
+  } locs;
+
+  void init(const lmesh::MappedModel &mapped);
+  void reload();
+  void draw();
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *modelVertexShaderPath   = "src/2.4.maps_texcoord_cube.vert";
+const char *packedVertexShaderPath  = "src/3.3.1.packed_vertex.vert";
+const char *modelFragmentShaderPath = "src/2.4.2.maps_specular_cube.frag";
+
+ModelContext model{};
+TextureCache textures{};
+
+glm::mat4 view       = glm::mat4(1.0f);
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+
+int main(int argc, char **argv) {
+  std::string modelPath = "assets/container.obj";
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--packed") {
+      model.packed          = true;
+      modelVertexShaderPath = packedVertexShaderPath;
+    } else {
+      modelPath = argv[i];
+    }
+  }
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+#ifndef __APPLE__
+  glDebugMessageCallback(glDebugMessageCb, 0);
+#endif
+
+  {
+    auto start  = std::chrono::steady_clock::now();
+    auto cache  = ROOT + lmesh::cachePath(modelPath, model.packed);
+    auto cached = std::filesystem::exists(cache);
+    auto mapped = lmesh::load(modelPath, model.packed);
+    model.init(mapped); // uploads straight from the mapping
+    auto end    = std::chrono::steady_clock::now();
+    auto ms     = std::chrono::duration<float, std::milli>(end - start).count();
+    auto &h     = mapped.header();
+    auto kib    = (uint64_t)h.nrVertices * h.vertexSize / 1024;
+    auto from   = mapped.packedAsset() ? "pack" : cached ? "cache" : "import";
+    auto title  = CURRENT_BASENAME() + " -- " + modelPath + ": " +
+                 std::to_string(h.nrIndices / 3) + " triangles, " + std::to_string(kib) +
+                 "KiB of vertices, " + from + " + upload " + std::to_string(ms) + "ms";
+    glfwSetWindowTitle(window, title.c_str());
+  }
+  model.reload();
+
+  camera.pos = model.center + glm::vec3(0.0f, 0.0f, 2.5f * model.radius);
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(modelVertexShaderPath) || fileChanged(modelFragmentShaderPath)) {
+      model.reload();
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    view       = camera.view();
+    projection = glm::perspective(camera.fov, windowWidth / (float)windowHeight,
+                                  0.01f * model.radius, 100.0f * model.radius);
+
+    // the light circles the model
+    auto lightPos =
+        model.center + 1.5f * model.radius * glm::vec3(cos(time), 0.5f, sin(time));
+    auto lightColor   = glm::vec3(1.0f);
+    auto viewLightPos = view * glm::vec4(lightPos, 1.0f);
+
+    glUseProgram(model.program);
+    glUniformMatrix4fv(model.locs.model, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    glUniformMatrix4fv(model.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(model.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(model.locs.light.v_pos, viewLightPos.x, viewLightPos.y, viewLightPos.z);
+    glUniform3fv(model.locs.light.ambient, 1, glm::value_ptr(0.2f * lightColor));
+    glUniform3fv(model.locs.light.diffuse, 1, glm::value_ptr(0.5f * lightColor));
+    glUniform3fv(model.locs.light.specular, 1, glm::value_ptr(1.0f * lightColor));
+    model.draw();
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  model.cleanup();
+  textures.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    model.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void ModelContext::init(const lmesh::MappedModel &mapped) {
+  auto vertices = packed ? std::as_bytes(mapped.packedVertices())
+                         : std::as_bytes(mapped.vertices());
+  auto indices  = mapped.indices();
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
+               GL_STATIC_DRAW);
+
+  if (packed) {
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, pos));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, tex));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+  } else {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                          (void *)offsetof(lmesh::Vertex, pos));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                          (void *)offsetof(lmesh::Vertex, tex));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                          (void *)offsetof(lmesh::Vertex, normal));
+    glEnableVertexAttribArray(2);
+  }
+
+  glBindVertexArray(0);             // unbind -- for debugging
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+
+  const uint32_t opaqueWhite = 0xffffffff;
+  glGenTextures(1, &white);
+  glBindTexture(GL_TEXTURE_2D, white);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               &opaqueWhite);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // textures shared between materials are loaded once
+  for (const auto &material : mapped.materials()) {
+    auto texture = [&](uint32_t name) {
+      return name == lmesh::NO_TEXTURE ? TextureCache::Handle{}
+                                       : textures.get(std::string(mapped.string(name)));
+    };
+    materials.push_back({ .diffuse   = texture(material.diffuse),
+                          .specular  = texture(material.specular),
+                          .shininess = material.shininess });
+  }
+  submeshes.assign(mapped.submeshes().begin(), mapped.submeshes().end());
+
+  auto &header = mapped.header();
+  center       = 0.5f * (header.boundsMin + header.boundsMax);
+  radius       = 0.5f * glm::distance(header.boundsMin, header.boundsMax);
+  radius       = std::max(radius, 1e-3f);
+}
+
+void ModelContext::reload() {
+  reloadProgram(program, modelVertexShaderPath, modelFragmentShaderPath);
+
+  // get uniform locations
+  locs.model              = glGetUniformLocation(program, "model");
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.dequantizeOffset   = glGetUniformLocation(program, "dequantize_offset");
+  locs.dequantizeScale    = glGetUniformLocation(program, "dequantize_scale");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.light.v_pos        = glGetUniformLocation(program, "light.v_pos");
+  locs.light.ambient      = glGetUniformLocation(program, "light.ambient");
+  locs.light.diffuse      = glGetUniformLocation(program, "light.diffuse");
+  locs.light.specular     = glGetUniformLocation(program, "light.specular");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void ModelContext::draw() {
+  glBindVertexArray(vao);
+  for (const auto &submesh : submeshes) {
+    const Material *material =
+        submesh.material < materials.size() ? &materials[submesh.material] : nullptr;
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, material && material->diffuse ? material->diffuse.id()
+                                                               : white);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, material && material->specular ? material->specular.id()
+                                                                : white);
+    glUniform1f(locs.material.shininess, material ? material->shininess : 32.0f);
+    if (packed) {
+      auto dequantize = lmesh::dequantize(submesh);
+      glUniform3fv(locs.dequantizeOffset, 1, glm::value_ptr(dequantize.offset));
+      glUniform3fv(locs.dequantizeScale, 1, glm::value_ptr(dequantize.scale));
+    }
+    glDrawElementsBaseVertex(GL_TRIANGLES, submesh.nrIndices, GL_UNSIGNED_INT,
+                             (void *)(submesh.firstIndex * sizeof(uint32_t)),
+                             submesh.baseVertex);
+  }
+  glBindVertexArray(0);
+}
+
+void ModelContext::cleanup() {
+  materials.clear(); // releases the textures
+  glDeleteTextures(1, &white);
+  glDeleteBuffers(1, &ebo);
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(program);
+}
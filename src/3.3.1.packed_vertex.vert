@@ -0,0 +1,36 @@
+#version 330 core
+// 2.4.maps_texcoord_cube.vert for PackedVertex (src/include/vertex_pack.h): the
+// normalized position is scaled back across the mesh's bounds, the octahedral normal
+// unfolded. texture coordinates are half floats, already floats here.
+layout(location = 0) in vec3 l_pos_unorm;
+layout(location = 1) in vec2 in_tex_coord;
+layout(location = 2) in vec2 l_normal_oct;
+
+out vec3 v_pos;
+out vec3 v_normal;
+out vec2 tex_coord;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 dequantize_offset;
+uniform vec3 dequantize_scale;
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec3 l_pos = dequantize_offset + dequantize_scale * l_pos_unorm;
+    vec3 l_normal = oct_decode(l_normal_oct);
+    v_pos = (view * model * vec4(l_pos, 1.0)).xyz;
+    mat3 model_normal = transpose(inverse(mat3(view * model))); // slow, for learning only!
+    v_normal = model_normal * l_normal;
+    gl_Position = projection * view * model * vec4(l_pos, 1.0);
+    tex_coord = in_tex_coord;
+}
@@ -0,0 +1,682 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "mesh_cache.h"
+#include "meshlets.h"
+#include "shader_program.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// usage: 3.3.2.meshlets [model] -- as 3.3.1.model_cache, drawn as meshlets culled on
+// the GPU.
+//
+// Each frame:
+// 1. a compute pass culls the meshlets against the view frustum, their normal cones,
+//    and the Hi-Z pyramid of the previous frame, writing a compacted list of index
+//    ranges and a count per submesh
+// 2. each submesh draws its list with one glMultiDrawElementsIndirectCount
+// 3. the depth buffer is reduced into a new Hi-Z pyramid, for the next frame
+// Occlusion is judged against last frame's depth, from last frame's point of view: a
+// meshlet uncovered by moving the camera can show up a frame late.
+//
+// F, C and O toggle frustum, cone and occlusion culling.
+
+constexpr int DIFFUSE_TEXTURE_UNIT  = 5;
+constexpr int SPECULAR_TEXTURE_UNIT = 7;
+constexpr int HIZ_TEXTURE_UNIT      = 0;
+
+constexpr GLuint MESHLETS_BINDING       = 0;
+constexpr GLuint COMMANDS_BINDING       = 1;
+constexpr GLuint COUNTS_BINDING         = 2;
+constexpr GLuint FIRST_MESHLETS_BINDING = 3;
+constexpr GLuint HIZ_IMAGE_UNIT         = 0;
+
+// keep in sync with 3.3.2.meshlet_cull.comp and 3.3.2.hiz.comp
+constexpr GLuint CULL_GROUP_SIZE = 64;
+constexpr GLuint HIZ_GROUP_SIZE  = 8;
+
+/** the layout glMultiDrawElementsIndirect reads. */
+struct DrawCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t  baseVertex;
+  uint32_t baseInstance;
+};
+
+struct LightLocs {
+  GLint v_pos;
+  GLint ambient;
+  GLint diffuse;
+  GLint specular;
+};
+
+struct MaterialLocs {
+  GLint diffuse;
+  GLint specular;
+  GLint shininess;
+};
+
+struct Material {
+  TextureCache::Handle diffuse;
+  TextureCache::Handle specular;
+  float                shininess;
+};
+
+struct Framebuffer {
+  GLuint       fbo;
+  GLuint       colorTexture;
+  GLuint       depthTexture;
+  unsigned int width;
+  unsigned int height;
+
+  void init(unsigned int width, unsigned int height);
+  void cleanup();
+};
+
+/** farthest depth per texel, at every mip level. */
+struct HizPyramid {
+  GLuint       program;
+  GLuint       texture;
+  unsigned int width;
+  unsigned int height;
+  unsigned int nrLevels;
+  bool         built; // there is a previous frame to cull against
+  struct Locations {
+    GLint src;
+    GLint srcLod;
+    GLint copy;
+  } locs;
+
+  void resize(unsigned int width, unsigned int height);
+  void reload();
+  void build(GLuint depthTexture);
+  void cleanup();
+};
+
+struct CullContext {
+  GLuint   program;
+  GLuint   meshletsBuffer;
+  GLuint   commandsBuffer; // also the GL_DRAW_INDIRECT_BUFFER
+  GLuint   countsBuffer;   // also the GL_PARAMETER_BUFFER
+  GLuint   firstMeshletsBuffer;
+  uint32_t nrMeshlets;
+  uint32_t nrSubmeshes;
+  struct Locations {
+    GLint nrMeshlets;
+    GLint frustum;
+    GLint cameraPos;
+    GLint cullFrustum;
+    GLint cullCones;
+    GLint cullOcclusion;
+    GLint prevViewProjection;
+    GLint hiz;
+  } locs;
+
+  void init(const lmesh::MappedModel &mapped);
+  void reload();
+  void dispatch(const glm::mat4 &viewProjection, const glm::mat4 &prevViewProjection,
+                const HizPyramid &hiz);
+  uint32_t nrDrawn(); // stalls on the GPU
+  void     cleanup();
+};
+
+struct ModelContext {
+  GLuint program;
+  GLuint vbo;
+  GLuint vao;
+  GLuint ebo;
+  GLuint white; // for materials without a texture
+
+  std::vector<lmesh::Submesh> submeshes;
+  std::vector<Material>       materials;
+  glm::vec3                   center;
+  float                       radius;
+
+  struct Locations {
+    GLint        model;
+    GLint        view;
+    GLint        projection;
+    MaterialLocs material;
+    LightLocs    light;
+  } locs;
+
+  void init(const lmesh::MappedModel &mapped);
+  void reload();
+  void draw(const CullContext &cull);
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *modelVertexShaderPath   = "src/2.4.maps_texcoord_cube.vert";
+const char *modelFragmentShaderPath = "src/2.4.2.maps_specular_cube.frag";
+const char *cullComputeShaderPath   = "src/3.3.2.meshlet_cull.comp";
+const char *hizComputeShaderPath    = "src/3.3.2.hiz.comp";
+
+ModelContext model{};
+CullContext  cull{};
+HizPyramid   hiz{};
+Framebuffer  framebuffer{};
+TextureCache textures{};
+
+glm::mat4 view       = glm::mat4(1.0f);
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{};
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus      = true;
+bool frustumCulling   = true;
+bool coneCulling      = true;
+bool occlusionCulling = true;
+
+int main(int argc, char **argv) {
+  std::string modelPath = argc > 1 ? argv[1] : "assets/container.obj";
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (action != GLFW_PRESS) {
+                         return;
+                       }
+                       if (key == GLFW_KEY_F) {
+                         frustumCulling = !frustumCulling;
+                       } else if (key == GLFW_KEY_C) {
+                         coneCulling = !coneCulling;
+                       } else if (key == GLFW_KEY_O) {
+                         occlusionCulling = !occlusionCulling;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+  glDebugMessageCallback(glDebugMessageCb, 0);
+
+  {
+    auto mapped = lmesh::load(modelPath);
+    model.init(mapped);
+    cull.init(mapped);
+  }
+  model.reload();
+  cull.reload();
+  hiz.reload();
+
+  camera.pos = model.center + glm::vec3(0.0f, 0.0f, 2.5f * model.radius);
+
+  glm::mat4 prevViewProjection = glm::mat4(1.0f);
+  float     titleTime          = 0.0f;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(modelVertexShaderPath) || fileChanged(modelFragmentShaderPath)) {
+      model.reload();
+    }
+    if (fileChanged(cullComputeShaderPath)) {
+      cull.reload();
+    }
+    if (fileChanged(hizComputeShaderPath)) {
+      hiz.reload();
+    }
+    if (framebuffer.width != windowWidth || framebuffer.height != windowHeight) {
+      framebuffer.cleanup();
+      framebuffer.init(windowWidth, windowHeight);
+      hiz.resize(windowWidth, windowHeight);
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    view       = camera.view();
+    projection = glm::perspective(camera.fov, windowWidth / (float)windowHeight,
+                                  0.01f * model.radius, 100.0f * model.radius);
+    glm::mat4 viewProjection = projection * view;
+
+    // 1. cull
+    cull.dispatch(viewProjection, prevViewProjection, hiz);
+
+    // 2. draw what survived
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // the light circles the model
+    auto lightPos =
+        model.center + 1.5f * model.radius * glm::vec3(cos(time), 0.5f, sin(time));
+    auto lightColor   = glm::vec3(1.0f);
+    auto viewLightPos = view * glm::vec4(lightPos, 1.0f);
+
+    glUseProgram(model.program);
+    glUniformMatrix4fv(model.locs.model, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    glUniformMatrix4fv(model.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(model.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(model.locs.light.v_pos, viewLightPos.x, viewLightPos.y, viewLightPos.z);
+    glUniform3fv(model.locs.light.ambient, 1, glm::value_ptr(0.2f * lightColor));
+    glUniform3fv(model.locs.light.diffuse, 1, glm::value_ptr(0.5f * lightColor));
+    glUniform3fv(model.locs.light.specular, 1, glm::value_ptr(1.0f * lightColor));
+    model.draw(cull);
+
+    // 3. the pyramid the next frame culls against
+    hiz.build(framebuffer.depthTexture);
+    prevViewProjection = viewProjection;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (time - titleTime > 0.5f) {
+      titleTime  = time;
+      auto title = CURRENT_BASENAME() + " -- drawn " + std::to_string(cull.nrDrawn()) +
+                   "/" + std::to_string(cull.nrMeshlets) + " meshlets" +
+                   (frustumCulling ? "" : ", frustum off") +
+                   (coneCulling ? "" : ", cones off") +
+                   (occlusionCulling ? "" : ", occlusion off");
+      glfwSetWindowTitle(window, title.c_str());
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  model.cleanup();
+  cull.cleanup();
+  hiz.cleanup();
+  framebuffer.cleanup();
+  textures.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    model.reload();
+    cull.reload();
+    hiz.reload();
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void Framebuffer::init(unsigned int width_, unsigned int height_) {
+  width  = width_;
+  height = height_;
+
+  colorTexture = 0;
+  glGenTextures(1, &colorTexture);
+  glBindTexture(GL_TEXTURE_2D, colorTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  depthTexture = 0;
+  glGenTextures(1, &depthTexture);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  fbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         colorTexture, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture,
+                         0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "framebuffer incomplete" << std::endl;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::cleanup() {
+  glDeleteFramebuffers(1, &fbo); // 0 silently ignored
+  glDeleteTextures(1, &colorTexture);
+  glDeleteTextures(1, &depthTexture);
+}
+
+void HizPyramid::resize(unsigned int width_, unsigned int height_) {
+  width    = width_;
+  height   = height_;
+  nrLevels = 1 + (unsigned int)std::log2(std::max(width, height));
+  built    = false;
+
+  glDeleteTextures(1, &texture); // 0 silently ignored
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexStorage2D(GL_TEXTURE_2D, nrLevels, GL_R32F, width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HizPyramid::reload() {
+  reloadComputeProgram(program, hizComputeShaderPath);
+
+  locs.src    = glGetUniformLocation(program, "src");
+  locs.srcLod = glGetUniformLocation(program, "src_lod");
+  locs.copy   = glGetUniformLocation(program, "copy");
+
+  glUseProgram(program);
+  glUniform1i(locs.src, HIZ_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void HizPyramid::build(GLuint depthTexture) {
+  glUseProgram(program);
+  glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+  for (unsigned int level = 0; level < nrLevels; ++level) {
+    unsigned int w = std::max(1u, width >> level);
+    unsigned int h = std::max(1u, height >> level);
+    glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : texture);
+    glUniform1i(locs.srcLod, level == 0 ? 0 : level - 1);
+    glUniform1i(locs.copy, level == 0);
+    glBindImageTexture(HIZ_IMAGE_UNIT, texture, level, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R32F);
+    glDispatchCompute((w + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+                      (h + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glUseProgram(0); // unbind -- for debugging
+  built = true;
+}
+
+void HizPyramid::cleanup() {
+  glDeleteTextures(1, &texture);
+  glDeleteProgram(program);
+}
+
+void CullContext::init(const lmesh::MappedModel &mapped) {
+  auto meshlets  = mapped.meshlets();
+  auto submeshes = mapped.submeshes();
+  nrMeshlets     = meshlets.size();
+  nrSubmeshes    = submeshes.size();
+
+  std::vector<uint32_t> firstMeshlets;
+  for (const auto &submesh : submeshes) {
+    firstMeshlets.push_back(submesh.firstMeshlet);
+  }
+
+  glGenBuffers(1, &meshletsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshletsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, meshlets.size_bytes(), meshlets.data(),
+               GL_STATIC_DRAW);
+
+  glGenBuffers(1, &commandsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, nrMeshlets * sizeof(DrawCommand), nullptr,
+               GL_DYNAMIC_DRAW);
+
+  glGenBuffers(1, &countsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, nrSubmeshes * sizeof(uint32_t), nullptr,
+               GL_DYNAMIC_DRAW);
+
+  glGenBuffers(1, &firstMeshletsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, firstMeshletsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, firstMeshlets.size() * sizeof(uint32_t),
+               firstMeshlets.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHLETS_BINDING, meshletsBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, commandsBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, countsBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FIRST_MESHLETS_BINDING, firstMeshletsBuffer);
+}
+
+void CullContext::reload() {
+  reloadComputeProgram(program, cullComputeShaderPath);
+
+  locs.nrMeshlets         = glGetUniformLocation(program, "nr_meshlets");
+  locs.frustum            = glGetUniformLocation(program, "frustum");
+  locs.cameraPos          = glGetUniformLocation(program, "camera_pos");
+  locs.cullFrustum        = glGetUniformLocation(program, "cull_frustum");
+  locs.cullCones          = glGetUniformLocation(program, "cull_cones");
+  locs.cullOcclusion      = glGetUniformLocation(program, "cull_occlusion");
+  locs.prevViewProjection = glGetUniformLocation(program, "prev_view_projection");
+  locs.hiz                = glGetUniformLocation(program, "hiz");
+
+  glUseProgram(program);
+  glUniform1ui(locs.nrMeshlets, nrMeshlets);
+  glUniform1i(locs.hiz, HIZ_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void CullContext::dispatch(const glm::mat4 &viewProjection,
+                           const glm::mat4 &prevViewProjection, const HizPyramid &hiz) {
+  // planes from the rows of the view projection (Gribb & Hartmann), normalized so
+  // distances compare against sphere radii
+  glm::mat4 m          = glm::transpose(viewProjection);
+  glm::vec4 frustum[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1],
+                           m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+  for (auto &plane : frustum) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+
+  const uint32_t zero = 0;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countsBuffer);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                    &zero);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glUseProgram(program);
+  glUniform4fv(locs.frustum, 6, glm::value_ptr(frustum[0]));
+  glUniform3fv(locs.cameraPos, 1, glm::value_ptr(camera.pos));
+  glUniform1i(locs.cullFrustum, frustumCulling);
+  glUniform1i(locs.cullCones, coneCulling);
+  glUniform1i(locs.cullOcclusion, occlusionCulling && hiz.built);
+  glUniformMatrix4fv(locs.prevViewProjection, 1, GL_FALSE,
+                     glm::value_ptr(prevViewProjection));
+  glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, hiz.texture);
+  glDispatchCompute((nrMeshlets + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+uint32_t CullContext::nrDrawn() {
+  std::vector<uint32_t> counts(nrSubmeshes);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countsBuffer);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counts.size() * sizeof(uint32_t),
+                     counts.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  uint32_t res = 0;
+  for (uint32_t count : counts) {
+    res += count;
+  }
+  return res;
+}
+
+void CullContext::cleanup() {
+  glDeleteBuffers(1, &firstMeshletsBuffer);
+  glDeleteBuffers(1, &countsBuffer);
+  glDeleteBuffers(1, &commandsBuffer);
+  glDeleteBuffers(1, &meshletsBuffer);
+  glDeleteProgram(program);
+}
+
+void ModelContext::init(const lmesh::MappedModel &mapped) {
+  auto vertices = mapped.vertices();
+  auto indices  = mapped.indices();
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
+               GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                        (void *)offsetof(lmesh::Vertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                        (void *)offsetof(lmesh::Vertex, tex));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(lmesh::Vertex),
+                        (void *)offsetof(lmesh::Vertex, normal));
+  glEnableVertexAttribArray(2);
+
+  glBindVertexArray(0);             // unbind -- for debugging
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+
+  const uint32_t opaqueWhite = 0xffffffff;
+  glGenTextures(1, &white);
+  glBindTexture(GL_TEXTURE_2D, white);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               &opaqueWhite);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // textures shared between materials are loaded once
+  for (const auto &material : mapped.materials()) {
+    auto texture = [&](uint32_t name) {
+      return name == lmesh::NO_TEXTURE ? TextureCache::Handle{}
+                                       : textures.get(std::string(mapped.string(name)));
+    };
+    materials.push_back({ .diffuse   = texture(material.diffuse),
+                          .specular  = texture(material.specular),
+                          .shininess = material.shininess });
+  }
+  submeshes.assign(mapped.submeshes().begin(), mapped.submeshes().end());
+
+  auto &header = mapped.header();
+  center       = 0.5f * (header.boundsMin + header.boundsMax);
+  radius       = 0.5f * glm::distance(header.boundsMin, header.boundsMax);
+  radius       = std::max(radius, 1e-3f);
+}
+
+void ModelContext::reload() {
+  reloadProgram(program, modelVertexShaderPath, modelFragmentShaderPath);
+
+  // get uniform locations
+  locs.model              = glGetUniformLocation(program, "model");
+  locs.view               = glGetUniformLocation(program, "view");
+  locs.projection         = glGetUniformLocation(program, "projection");
+  locs.material.diffuse   = glGetUniformLocation(program, "material.diffuse");
+  locs.material.specular  = glGetUniformLocation(program, "material.specular");
+  locs.material.shininess = glGetUniformLocation(program, "material.shininess");
+  locs.light.v_pos        = glGetUniformLocation(program, "light.v_pos");
+  locs.light.ambient      = glGetUniformLocation(program, "light.ambient");
+  locs.light.diffuse      = glGetUniformLocation(program, "light.diffuse");
+  locs.light.specular     = glGetUniformLocation(program, "light.specular");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1i(locs.material.diffuse, DIFFUSE_TEXTURE_UNIT);
+  glUniform1i(locs.material.specular, SPECULAR_TEXTURE_UNIT);
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void ModelContext::draw(const CullContext &cull) {
+  glBindVertexArray(vao);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cull.commandsBuffer);
+  glBindBuffer(GL_PARAMETER_BUFFER, cull.countsBuffer);
+  for (uint32_t s = 0; s < submeshes.size(); ++s) {
+    const auto     &submesh = submeshes[s];
+    const Material *material =
+        submesh.material < materials.size() ? &materials[submesh.material] : nullptr;
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, material && material->diffuse ? material->diffuse.id()
+                                                               : white);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, material && material->specular ? material->specular.id()
+                                                                : white);
+    glUniform1f(locs.material.shininess, material ? material->shininess : 32.0f);
+    // the count the cull pass wrote for this submesh, up to all its meshlets
+    glMultiDrawElementsIndirectCount(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void *)(submesh.firstMeshlet * sizeof(DrawCommand)), s * sizeof(uint32_t),
+        submesh.nrMeshlets, sizeof(DrawCommand));
+  }
+  glBindBuffer(GL_PARAMETER_BUFFER, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+void ModelContext::cleanup() {
+  materials.clear(); // releases the textures
+  glDeleteTextures(1, &white);
+  glDeleteBuffers(1, &ebo);
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(program);
+}
@@ -0,0 +1,311 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "file.h"
+#include "gl_debug.h"
+#include "shader_program.h"
+#include "virtual_texture.h"
+#include "vtex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// usage: 3.4.1.virtual_texture [image] -- a ground plane PLANE_SIZE across, covered
+// by the virtual texture tools/vtex_bake made of image. The build bakes the default,
+// assets/wall.jpg, repeated 16 x 16 times: 8192 x 8192 texels.
+//
+// Each frame the plane is drawn twice: small, into the virtual texture's feedback
+// buffer, naming the pages it needs, then to the screen through the page table (see
+// virtual_texture.h). Only pages in view take up VRAM -- the title compares the page
+// cache with the whole mip chain.
+//
+// V tints pages by their level.
+
+constexpr int PAGE_TABLE_TEXTURE_UNIT = 0;
+constexpr int PHYSICAL_TEXTURE_UNIT   = 1;
+
+constexpr float    PLANE_SIZE = 64.0f;
+constexpr uint32_t CACHE_SIDE = 16; // pages
+
+struct PlaneVertex {
+  glm::vec3 pos;
+  glm::vec2 tex;
+};
+
+struct PlaneContext {
+  GLuint program;
+  GLuint feedbackProgram;
+  GLuint vbo;
+  GLuint vao;
+
+  struct Locations {
+    GLint view;
+    GLint projection;
+    GLint vtSize;
+    GLint vtNrLevels;
+    GLint pageTable;
+    GLint physical;
+    GLint showLevels;
+  } locs;
+  struct FeedbackLocations {
+    GLint view;
+    GLint projection;
+    GLint vtSize;
+    GLint vtNrLevels;
+    GLint lodBias;
+  } feedbackLocs;
+
+  void init();
+  void reload(const VirtualTexture &vt);
+  void draw();
+  void cleanup();
+};
+
+void processInput(GLFWwindow *window);
+
+unsigned int windowWidth  = 800;
+unsigned int windowHeight = 600;
+
+const char *vertexShaderPath           = "src/3.4.1.virtual_texture.vert";
+const char *fragmentShaderPath         = "src/3.4.1.virtual_texture.frag";
+const char *feedbackFragmentShaderPath = "src/3.4.1.vt_feedback.frag";
+
+PlaneContext   plane{};
+VirtualTexture vt{};
+
+glm::mat4 view       = glm::mat4(1.0f);
+glm::mat4 projection = glm::mat4(1.0f);
+Camera    camera{ glm::vec3(0.0f, 1.0f, 0.0f), -0.3f };
+
+float frameStart = 0.0f;
+float dt         = 0.0f; // time spent in last frame
+
+bool gainedFocus = true;
+bool showLevels  = false;
+
+int main(int argc, char **argv) {
+  std::string imagePath = argc > 1 ? argv[1] : "assets/wall.jpg";
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+  GLFWwindow *window = glfwCreateWindow(windowWidth, windowHeight,
+                                        CURRENT_BASENAME().c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    std::cerr << "failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    exit(1);
+  }
+  glfwMakeContextCurrent(window);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height) {
+    glViewport(0, 0, width, height);
+    windowWidth  = std::max(1, width);
+    windowHeight = std::max(1, height);
+  });
+
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetWindowFocusCallback(window, [](GLFWwindow *window, int focused) {
+    gainedFocus = focused == GLFW_TRUE;
+  });
+  glfwSetCursorPosCallback(window, [](GLFWwindow *window, double x, double y) {
+    static double px = 0.0, py = 0.0;
+    auto          dx = x - px;
+    auto          dy = y - py;
+    px               = x;
+    py               = y;
+
+    if (gainedFocus) {
+      gainedFocus = false;
+      return; // ignore movement
+    }
+
+    camera.handleMouse(dx, -dy); // (0,0) is top-left corner
+  });
+  glfwSetScrollCallback(window, [](GLFWwindow *window, double xoff, double yoff) {
+    camera.handleScroll(yoff);
+  });
+  glfwSetKeyCallback(window,
+                     [](GLFWwindow *window, int key, int scancode, int action, int mods) {
+                       if (action == GLFW_PRESS && key == GLFW_KEY_V) {
+                         showLevels = !showLevels;
+                       }
+                     });
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    exit(1);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_DEBUG_OUTPUT);
+  glDebugMessageCallback(glDebugMessageCb, 0);
+
+  vt.init(imagePath, CACHE_SIDE);
+  plane.init();
+  plane.reload(vt);
+
+  // BC1: half a byte per texel
+  uint64_t cacheKib = (uint64_t)vt.cacheTexels() * vt.cacheTexels() / 2 / 1024;
+  uint64_t fullKib  = (uint64_t)vtex::firstPage(vt.size(), vt.nrLevels()) *
+                     vtex::PAGE_SIZE * vtex::PAGE_SIZE / 2 / 1024;
+  float titleTime = 0.0f;
+
+  while (!glfwWindowShouldClose(window)) {
+    if (fileChanged(vertexShaderPath) || fileChanged(fragmentShaderPath) ||
+        fileChanged(feedbackFragmentShaderPath)) {
+      plane.reload(vt);
+    }
+
+    float time = (float)glfwGetTime();
+    dt         = time - frameStart;
+    frameStart = time;
+
+    processInput(window);
+
+    view       = camera.view();
+    projection = glm::perspective(camera.fov, windowWidth / (float)windowHeight, 0.05f,
+                                  2.0f * PLANE_SIZE);
+
+    // 1. the pages in view
+    vt.beginFeedback(windowWidth, windowHeight);
+    glUseProgram(plane.feedbackProgram);
+    glUniformMatrix4fv(plane.feedbackLocs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(plane.feedbackLocs.projection, 1, GL_FALSE,
+                       glm::value_ptr(projection));
+    plane.draw();
+    vt.endFeedback();
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    // 2. take in older feedback, upload pages streamed in since
+    vt.update();
+
+    // 3. draw through the page table
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(plane.program);
+    glUniformMatrix4fv(plane.locs.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(plane.locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1i(plane.locs.showLevels, showLevels);
+    glActiveTexture(GL_TEXTURE0 + PAGE_TABLE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, vt.pageTable());
+    glActiveTexture(GL_TEXTURE0 + PHYSICAL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, vt.physical());
+    plane.draw();
+
+    if (time - titleTime > 0.5f) {
+      titleTime  = time;
+      auto title = CURRENT_BASENAME() + " -- " + std::to_string(vt.nrResident()) + "/" +
+                   std::to_string(vt.nrSlots()) + " pages cached, " +
+                   std::to_string(vt.nrPending()) + " pending, " +
+                   std::to_string(vt.nrUploaded()) + " uploaded; cache " +
+                   std::to_string(cacheKib) + "KiB of " + std::to_string(fullKib) +
+                   "KiB";
+      glfwSetWindowTitle(window, title.c_str());
+    }
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  plane.cleanup();
+  vt.cleanup();
+
+  glfwTerminate();
+  return 0;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    glfwSetWindowShouldClose(window, true);
+  }
+  if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    plane.reload(vt);
+  }
+
+  camera.pollKeyboard(window, dt);
+}
+
+void PlaneContext::init() {
+  const float       h          = 0.5f * PLANE_SIZE;
+  const PlaneVertex vertices[] = {
+    { { -h, 0.0f, h }, { 0.0f, 0.0f } },
+    { { h, 0.0f, h }, { 1.0f, 0.0f } },
+    { { -h, 0.0f, -h }, { 0.0f, 1.0f } },
+    { { h, 0.0f, -h }, { 1.0f, 1.0f } },
+  };
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PlaneVertex),
+                        (void *)offsetof(PlaneVertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PlaneVertex),
+                        (void *)offsetof(PlaneVertex, tex));
+  glEnableVertexAttribArray(1);
+
+  glBindVertexArray(0);             // unbind -- for debugging
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind -- for debugging
+}
+
+void PlaneContext::reload(const VirtualTexture &vt) {
+  reloadProgram(program, vertexShaderPath, fragmentShaderPath);
+  reloadProgram(feedbackProgram, vertexShaderPath, feedbackFragmentShaderPath);
+
+  // get uniform locations
+  locs.view       = glGetUniformLocation(program, "view");
+  locs.projection = glGetUniformLocation(program, "projection");
+  locs.vtSize     = glGetUniformLocation(program, "vt_size");
+  locs.vtNrLevels = glGetUniformLocation(program, "vt_nr_levels");
+  locs.pageTable  = glGetUniformLocation(program, "page_table");
+  locs.physical   = glGetUniformLocation(program, "physical");
+  locs.showLevels = glGetUniformLocation(program, "show_levels");
+
+  feedbackLocs.view       = glGetUniformLocation(feedbackProgram, "view");
+  feedbackLocs.projection = glGetUniformLocation(feedbackProgram, "projection");
+  feedbackLocs.vtSize     = glGetUniformLocation(feedbackProgram, "vt_size");
+  feedbackLocs.vtNrLevels = glGetUniformLocation(feedbackProgram, "vt_nr_levels");
+  feedbackLocs.lodBias    = glGetUniformLocation(feedbackProgram, "lod_bias");
+
+  // set constant uniforms
+  glUseProgram(program);
+  glUniform1ui(locs.vtSize, vt.size());
+  glUniform1i(locs.vtNrLevels, vt.nrLevels());
+  glUniform1i(locs.pageTable, PAGE_TABLE_TEXTURE_UNIT);
+  glUniform1i(locs.physical, PHYSICAL_TEXTURE_UNIT);
+
+  glUseProgram(feedbackProgram);
+  glUniform1ui(feedbackLocs.vtSize, vt.size());
+  glUniform1i(feedbackLocs.vtNrLevels, vt.nrLevels());
+  // the feedback buffer's derivatives are FEEDBACK_DIVISOR times the screen's
+  glUniform1f(feedbackLocs.lodBias, -std::log2((float)VirtualTexture::FEEDBACK_DIVISOR));
+  glUseProgram(0); // unbind -- for debugging
+}
+
+void PlaneContext::draw() {
+  glBindVertexArray(vao);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glBindVertexArray(0);
+}
+
+void PlaneContext::cleanup() {
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(feedbackProgram);
+  glDeleteProgram(program);
+}
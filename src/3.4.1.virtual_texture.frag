@@ -0,0 +1,52 @@
+#version 460 core
+// Samples a virtual texture through its page table (see virtual_texture.h): the
+// entry for the page at the wanted level names the cache slot of that page, or of its
+// nearest resident ancestor, and the level of the page in the slot. The level is
+// chosen as in 3.4.1.vt_feedback.frag, so the pages sampled are the ones requested.
+// With show_levels, each level tints its pages.
+
+in vec2 tex_coord;
+
+out vec4 frag_color;
+
+uniform sampler2D page_table; // rgba8: slot x, y, level
+uniform sampler2D physical;
+uniform uint vt_size; // texels on a side, at level 0
+uniform int vt_nr_levels;
+uniform bool show_levels;
+
+// keep in sync with vtex.h
+const uint PAGE_SIZE = 128u;
+const uint PAGE_BORDER = 4u;
+const uint PAGE_TEXELS = PAGE_SIZE + 2u * PAGE_BORDER;
+
+const vec3 LEVEL_COLORS[8] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(1.0, 0.5, 0.0), vec3(1.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 1.0, 1.0), vec3(0.0, 0.0, 1.0), vec3(0.5, 0.0, 1.0), vec3(1.0, 0.0, 1.0));
+
+void main() {
+    vec2 texel = tex_coord * float(vt_size);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    int level = int(clamp(lod, 0.0, float(vt_nr_levels - 1)));
+
+    vec2 uv = clamp(tex_coord, 0.0, 1.0);
+    uint pages = (vt_size / PAGE_SIZE) >> level;
+    uvec2 p = min(uvec2(uv * float(pages)), uvec2(pages - 1u));
+    uvec4 entry = uvec4(round(texelFetch(page_table, ivec2(p), level) * 255.0));
+
+    // where uv falls within the page in the slot, at that page's level
+    float resident_pages = float((vt_size / PAGE_SIZE) >> entry.b);
+    vec2 page_pos = min(uv * resident_pages, vec2(resident_pages - 0.0001));
+    vec2 in_page = fract(page_pos);
+    vec2 slot_texel = vec2(entry.rg * PAGE_TEXELS + PAGE_BORDER) +
+                      in_page * float(PAGE_SIZE);
+    vec2 slot_uv = slot_texel / vec2(textureSize(physical, 0));
+    vec3 color = textureLod(physical, slot_uv, 0.0).rgb;
+
+    if (show_levels) {
+        color = mix(color, LEVEL_COLORS[entry.b % 8u], 0.4);
+    }
+    frag_color = vec4(color, 1.0);
+}
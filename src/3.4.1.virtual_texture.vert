@@ -0,0 +1,13 @@
+#version 460 core
+layout(location = 0) in vec3 l_pos;
+layout(location = 1) in vec2 in_tex_coord;
+
+out vec2 tex_coord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    gl_Position = projection * view * vec4(l_pos, 1.0);
+    tex_coord = in_tex_coord;
+}
@@ -0,0 +1,27 @@
+#version 460 core
+// The page of the virtual texture each pixel will sample (see virtual_texture.h): x,
+// y and level, with a = 1 where anything was drawn. The level is chosen as in
+// 3.4.1.virtual_texture.frag; lod_bias makes up for the feedback buffer's coarser
+// derivatives, drawn at a fraction of the screen's resolution.
+
+in vec2 tex_coord;
+
+layout(location = 0) out uvec4 page;
+
+uniform uint vt_size; // texels on a side, at level 0
+uniform int vt_nr_levels;
+uniform float lod_bias;
+
+const uint PAGE_SIZE = 128u; // keep in sync with vtex.h
+
+void main() {
+    vec2 texel = tex_coord * float(vt_size);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lod_bias;
+    int level = int(clamp(lod, 0.0, float(vt_nr_levels - 1)));
+
+    uint pages = (vt_size / PAGE_SIZE) >> level;
+    uvec2 p = min(uvec2(clamp(tex_coord, 0.0, 1.0) * float(pages)), uvec2(pages - 1u));
+    page = uvec4(p, uint(level), 1u);
+}
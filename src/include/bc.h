@@ -0,0 +1,445 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// BC1, BC3 (aka DXT1 and DXT5) and BC7 block compression on the CPU.
+//
+// Each 4x4 block's colors are fit with a line through their mean along the principal
+// axis, endpoints inset from the extremes so the interpolated colors land inside the
+// cluster, then every texel picks the nearest of the 4 palette colors. Alpha (BC3)
+// spans the block's min and max with 8 interpolated values. BC7 blocks take one of
+// two modes: 6, a line through rgba with 16 colors on it, or for opaque blocks 1, two
+// lines through rgb with 8 colors each, splitting the block by whichever of the 64
+// partitions fits best. Lines are fit the same way, then refit by least squares to
+// the colors the texels picked.
+// Rows of blocks are encoded in parallel.
+
+namespace bc {
+
+// formats to encode to
+constexpr uint32_t BC1 = 1; // rgb
+constexpr uint32_t BC3 = 3; // rgba
+constexpr uint32_t BC7 = 7; // rgba, twice BC1's size but much closer to the image
+
+inline uint32_t blockBytes(uint32_t format) { return format == BC1 ? 8 : 16; }
+
+namespace detail {
+inline uint16_t pack565(glm::vec3 c) {
+  c = glm::clamp(c, 0.0f, 255.0f);
+  auto r = (uint16_t)std::lround(c.r * 31.0f / 255.0f);
+  auto g = (uint16_t)std::lround(c.g * 63.0f / 255.0f);
+  auto b = (uint16_t)std::lround(c.b * 31.0f / 255.0f);
+  return r << 11 | g << 5 | b;
+}
+inline glm::vec3 unpack565(uint16_t v) {
+  unsigned r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+  return glm::vec3(r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+}
+inline float distance2(glm::vec3 a, glm::vec3 b) { return glm::dot(a - b, a - b); }
+
+// BC7 modes, as far as the encoder tells them apart
+struct Bc7Mode {
+  int        endpointBits; // per channel, before the low bit
+  bool       sharedLowBit; // by a subset's two endpoints, or one each
+  int        nrChannels;   // 3: alpha is 255
+  const int *weights;      // 64ths of the way from the first endpoint to the second
+  int        nrWeights;
+};
+constexpr int     BC7_WEIGHTS3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr int     BC7_WEIGHTS4[16] = { 0,  4,  9,  13, 17, 21, 26, 30,
+                                       34, 38, 43, 47, 51, 55, 60, 64 };
+constexpr Bc7Mode BC7_MODE1        = { 6, true, 3, BC7_WEIGHTS3, 8 };
+constexpr Bc7Mode BC7_MODE6        = { 7, false, 4, BC7_WEIGHTS4, 16 };
+
+// the texels of the second subset of each 2 subset partition, a bit each in row order
+constexpr uint16_t BC7_PARTITIONS[64] = {
+  0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80,
+  0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000, 0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310,
+  0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c, 0xaaaa,
+  0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc,
+  0x6996, 0xc33c, 0x9966, 0x0660, 0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6,
+  0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+// the texel of the second subset whose index is stored without its top bit (the first
+// subset's is texel 0)
+constexpr uint8_t BC7_ANCHORS[64] = {
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8,  2,  2,  8,
+  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,
+  2,  15, 15, 6,  6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+/** a subset's endpoints, quantized to a mode, and how far its texels are from them. */
+struct Bc7Endpoints {
+  glm::ivec4 q0, q1;
+  int        p0 = 0, p1 = 0; // low bits
+  int        error = INT32_MAX;
+};
+
+/** the 8 bit value of an endpoint channel stored as q and low bit p. */
+inline int bc7Unquantize(int q, int p, int endpointBits) {
+  int v = q << 1 | p, n = endpointBits + 1;
+  return (v << (8 - n) | v >> (2 * n - 8)) & 255;
+}
+
+/** e0 and e1 quantized to mode for the texels of subset (a bit each) over every choice
+ * of low bits, with the index of each of those texels. */
+inline Bc7Endpoints quantizeBc7(const glm::u8vec4 *texels, uint32_t subset, glm::vec4 e0,
+                                glm::vec4 e1, const Bc7Mode &mode, uint8_t *indices) {
+  Bc7Endpoints res;
+  int          qMax = (1 << mode.endpointBits) - 1;
+  float        vMax = (float)((2 << mode.endpointBits) - 1);
+  for (int p = 0; p < (mode.sharedLowBit ? 2 : 4); ++p) {
+    Bc7Endpoints fit;
+    fit.p0 = p & 1;
+    fit.p1 = mode.sharedLowBit ? fit.p0 : p >> 1;
+    fit.q0 = glm::ivec4(glm::round((e0 * vMax / 255.0f - (float)fit.p0) / 2.0f));
+    fit.q1 = glm::ivec4(glm::round((e1 * vMax / 255.0f - (float)fit.p1) / 2.0f));
+    fit.q0 = glm::clamp(fit.q0, 0, qMax);
+    fit.q1 = glm::clamp(fit.q1, 0, qMax);
+    glm::ivec4 c0(255), c1(255);
+    for (int c = 0; c < mode.nrChannels; ++c) {
+      c0[c] = bc7Unquantize(fit.q0[c], fit.p0, mode.endpointBits);
+      c1[c] = bc7Unquantize(fit.q1[c], fit.p1, mode.endpointBits);
+    }
+    glm::ivec4 palette[16];
+    for (int j = 0; j < mode.nrWeights; ++j) {
+      palette[j] = ((64 - mode.weights[j]) * c0 + mode.weights[j] * c1 + 32) >> 6;
+    }
+
+    uint8_t picked[16];
+    fit.error = 0;
+    for (int i = 0; i < 16; ++i) {
+      if ((subset >> i & 1) == 0) {
+        continue;
+      }
+      int best = INT32_MAX;
+      for (int j = 0; j < mode.nrWeights; ++j) {
+        glm::ivec4 d     = glm::ivec4(texels[i]) - palette[j];
+        int        error = d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+        if (error < best) {
+          best      = error;
+          picked[i] = j;
+        }
+      }
+      fit.error += best;
+    }
+    if (fit.error < res.error) {
+      res = fit;
+      for (int i = 0; i < 16; ++i) {
+        indices[i] = subset >> i & 1 ? picked[i] : indices[i];
+      }
+    }
+  }
+  return res;
+}
+
+/** the endpoints for the texels of subset (a bit each): a line through their mean
+ * along the principal axis, as for BC1, then refit by least squares to the weights
+ * the texels picked if refine. */
+inline Bc7Endpoints fitBc7(const glm::u8vec4 *texels, uint32_t subset,
+                           const Bc7Mode &mode, bool refine, uint8_t *indices) {
+  glm::vec4 mean(0.0f);
+  int       n = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (subset >> i & 1) {
+      mean += glm::vec4(texels[i]);
+      ++n;
+    }
+  }
+  mean /= (float)n;
+
+  glm::mat4 covariance(0.0f);
+  glm::vec4 lo(255.0f), hi(0.0f);
+  for (int i = 0; i < 16; ++i) {
+    if (subset >> i & 1) {
+      glm::vec4 c  = glm::vec4(texels[i]);
+      covariance  += glm::outerProduct(c - mean, c - mean);
+      lo           = glm::min(lo, c);
+      hi           = glm::max(hi, c);
+    }
+  }
+  glm::vec4 axis = hi - lo;
+  for (int i = 0; i < 4 && glm::dot(axis, axis) > 0.0f; ++i) {
+    axis  = covariance * axis;
+    axis /= std::max({ std::abs(axis.x), std::abs(axis.y), std::abs(axis.z),
+                       std::abs(axis.w), 1e-20f });
+  }
+  glm::vec4 e0 = mean, e1 = mean;
+  if (glm::dot(axis, axis) > 0.0f) {
+    axis       = glm::normalize(axis);
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+      if (subset >> i & 1) {
+        float t = glm::dot(glm::vec4(texels[i]) - mean, axis);
+        tMin    = std::min(tMin, t);
+        tMax    = std::max(tMax, t);
+      }
+    }
+    e0 = mean + axis * tMin;
+    e1 = mean + axis * tMax;
+  }
+  Bc7Endpoints res = quantizeBc7(texels, subset, e0, e1, mode, indices);
+
+  for (int iteration = 0; refine && iteration < 2 && res.error > 0; ++iteration) {
+    float     aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    glm::vec4 ac(0.0f), bc(0.0f);
+    for (int i = 0; i < 16; ++i) {
+      if (subset >> i & 1) {
+        float b  = mode.weights[indices[i]] / 64.0f;
+        float a  = 1.0f - b;
+        aa      += a * a;
+        ab      += a * b;
+        bb      += b * b;
+        ac      += a * glm::vec4(texels[i]);
+        bc      += b * glm::vec4(texels[i]);
+      }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+      break; // every texel picked the same weight
+    }
+    uint8_t      refitIndices[16];
+    glm::vec4    r0    = glm::clamp((bb * ac - ab * bc) / det, 0.0f, 255.0f);
+    glm::vec4    r1    = glm::clamp((aa * bc - ab * ac) / det, 0.0f, 255.0f);
+    Bc7Endpoints refit = quantizeBc7(texels, subset, r0, r1, mode, refitIndices);
+    if (refit.error >= res.error) {
+      break;
+    }
+    res = refit;
+    for (int i = 0; i < 16; ++i) {
+      indices[i] = subset >> i & 1 ? refitIndices[i] : indices[i];
+    }
+  }
+  return res;
+}
+
+/** swaps the endpoints of a subset if need be so the index of its anchor texel has a
+ * top bit of 0, which is not stored. */
+inline void anchorBc7(Bc7Endpoints &endpoints, uint32_t subset, int anchor,
+                      const Bc7Mode &mode, uint8_t *indices) {
+  if (indices[anchor] < mode.nrWeights / 2) {
+    return;
+  }
+  std::swap(endpoints.q0, endpoints.q1);
+  std::swap(endpoints.p0, endpoints.p1);
+  for (int i = 0; i < 16; ++i) {
+    indices[i] = subset >> i & 1 ? mode.nrWeights - 1 - indices[i] : indices[i];
+  }
+}
+
+/** packs bits, lowest first. */
+struct BitWriter {
+  uint8_t *out;
+  uint32_t at = 0;
+
+  void put(uint32_t value, uint32_t nrBits) {
+    for (uint32_t i = 0; i < nrBits; ++i, ++at) {
+      out[at / 8] |= (value >> i & 1) << (at % 8);
+    }
+  }
+};
+} // namespace detail
+
+/** the 8 byte BC1 block for 16 texels in row order. always the 4 color mode, so the
+ * block decodes the same as the color half of a BC3 block. */
+inline void encodeColorBlock(const glm::u8vec4 *texels, uint8_t *out) {
+  using namespace detail;
+  glm::vec3 colors[16];
+  glm::vec3 mean(0.0f);
+  for (int i = 0; i < 16; ++i) {
+    colors[i]  = glm::vec3(texels[i]);
+    mean      += colors[i] / 16.0f;
+  }
+
+  // principal axis by power iteration on the covariance
+  glm::mat3 covariance(0.0f);
+  glm::vec3 lo(255.0f), hi(0.0f);
+  for (auto c : colors) {
+    covariance += glm::outerProduct(c - mean, c - mean);
+    lo          = glm::min(lo, c);
+    hi          = glm::max(hi, c);
+  }
+  glm::vec3 axis = hi - lo;
+  for (int i = 0; i < 4 && glm::dot(axis, axis) > 0.0f; ++i) {
+    axis  = covariance * axis;
+    axis /= std::max({ std::abs(axis.x), std::abs(axis.y), std::abs(axis.z), 1e-20f });
+  }
+
+  glm::vec3 e0 = mean, e1 = mean;
+  if (glm::dot(axis, axis) > 0.0f) {
+    axis       = glm::normalize(axis);
+    float tMin = 0.0f, tMax = 0.0f;
+    for (auto c : colors) {
+      float t = glm::dot(c - mean, axis);
+      tMin    = std::min(tMin, t);
+      tMax    = std::max(tMax, t);
+    }
+    float inset = (tMax - tMin) / 16.0f;
+    e0          = mean + axis * (tMax - inset);
+    e1          = mean + axis * (tMin + inset);
+  }
+
+  uint16_t c0 = pack565(e0), c1 = pack565(e1);
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  glm::vec3 p0 = unpack565(c0), p1 = unpack565(c1);
+  glm::vec3 palette[4] = { p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f };
+
+  uint32_t indices = 0;
+  for (int i = 0; c0 != c1 && i < 16; ++i) {
+    uint32_t best = 0;
+    for (uint32_t j = 1; j < 4; ++j) {
+      if (distance2(colors[i], palette[j]) < distance2(colors[i], palette[best])) {
+        best = j;
+      }
+    }
+    indices |= best << (2 * i);
+  }
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+/** the 8 byte BC3 alpha block for 16 texels in row order. */
+inline void encodeAlphaBlock(const glm::u8vec4 *texels, uint8_t *out) {
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; ++i) {
+    a0 = std::max<int>(a0, texels[i].a);
+    a1 = std::min<int>(a1, texels[i].a);
+  }
+  // a0 > a1: a0, a1, then 6 values from a0 to a1
+  int palette[8] = { a0, a1 };
+  for (int j = 2; j < 8; ++j) {
+    palette[j] = ((8 - j) * a0 + (j - 1) * a1 + 3) / 7;
+  }
+
+  uint64_t indices = 0;
+  for (int i = 0; a0 != a1 && i < 16; ++i) {
+    uint64_t best = 0;
+    for (int j = 1; j < 8; ++j) {
+      if (std::abs(texels[i].a - palette[j]) < std::abs(texels[i].a - palette[best])) {
+        best = j;
+      }
+    }
+    indices |= best << (3 * i);
+  }
+  out[0] = a0;
+  out[1] = a1;
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = indices >> (8 * i);
+  }
+}
+
+/** the 16 byte BC7 block for 16 texels in row order: mode 1 (two subsets, rgb) for
+ * opaque blocks it fits better, mode 6 (one subset, rgba) otherwise. */
+inline void encodeBc7Block(const glm::u8vec4 *texels, uint8_t *out) {
+  using namespace detail;
+  uint8_t      indices[16];
+  Bc7Endpoints fit = fitBc7(texels, 0xffff, BC7_MODE6, true, indices);
+
+  bool opaque = true;
+  for (int i = 0; i < 16; ++i) {
+    opaque = opaque && texels[i].a == 255;
+  }
+  int          partition = -1;
+  uint8_t      indices1[16];
+  Bc7Endpoints fit1[2];
+  if (opaque && fit.error > 0) {
+    // the partition that fits best as is, then refit
+    int best = INT32_MAX;
+    for (int p = 0; p < 64; ++p) {
+      uint8_t  scratch[16];
+      uint32_t second = BC7_PARTITIONS[p];
+      int      error  = fitBc7(texels, ~second & 0xffff, BC7_MODE1, false, scratch).error;
+      if (error < best) {
+        error += fitBc7(texels, second, BC7_MODE1, false, scratch).error;
+      }
+      if (error < best) {
+        best      = error;
+        partition = p;
+      }
+    }
+    uint32_t second = BC7_PARTITIONS[partition];
+    fit1[0]         = fitBc7(texels, ~second & 0xffff, BC7_MODE1, true, indices1);
+    fit1[1]         = fitBc7(texels, second, BC7_MODE1, true, indices1);
+    if (fit1[0].error + fit1[1].error >= fit.error) {
+      partition = -1;
+    }
+  }
+
+  std::memset(out, 0, 16);
+  BitWriter bits{ out };
+  if (partition >= 0) {
+    uint32_t second = BC7_PARTITIONS[partition];
+    int      anchor = BC7_ANCHORS[partition];
+    anchorBc7(fit1[0], ~second & 0xffff, 0, BC7_MODE1, indices1);
+    anchorBc7(fit1[1], second, anchor, BC7_MODE1, indices1);
+    bits.put(1 << 1, 2); // mode 1
+    bits.put(partition, 6);
+    for (int c = 0; c < 3; ++c) {
+      for (const auto &subset : fit1) {
+        bits.put(subset.q0[c], 6);
+        bits.put(subset.q1[c], 6);
+      }
+    }
+    bits.put(fit1[0].p0, 1);
+    bits.put(fit1[1].p0, 1);
+    for (int i = 0; i < 16; ++i) {
+      bits.put(indices1[i], i == 0 || i == anchor ? 2 : 3);
+    }
+    return;
+  }
+  anchorBc7(fit, 0xffff, 0, BC7_MODE6, indices);
+  bits.put(1 << 6, 7); // mode 6
+  for (int c = 0; c < 4; ++c) {
+    bits.put(fit.q0[c], 7);
+    bits.put(fit.q1[c], 7);
+  }
+  bits.put(fit.p0, 1);
+  bits.put(fit.p1, 1);
+  for (int i = 0; i < 16; ++i) {
+    bits.put(indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+/** the blocks of a width x height image in row order, in format. blocks overhanging
+ * the image repeat its edge texels. */
+inline std::vector<uint8_t> encode(const glm::u8vec4 *texels, uint32_t width,
+                                   uint32_t height, uint32_t format, ThreadPool &pool) {
+  uint32_t             blocksX = (width + 3) / 4;
+  uint32_t             blocksY = (height + 3) / 4;
+  std::vector<uint8_t> res((size_t)blocksX * blocksY * blockBytes(format));
+
+  pool.parallelFor(blocksY, [&](uint32_t by) {
+    glm::u8vec4 block[16];
+    for (uint32_t bx = 0; bx < blocksX; ++bx) {
+      for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+        uint32_t y = std::min(by * 4 + i / 4, height - 1);
+        block[i]   = texels[(size_t)y * width + x];
+      }
+      uint8_t *out = res.data() + ((size_t)by * blocksX + bx) * blockBytes(format);
+      if (format == BC7) {
+        encodeBc7Block(block, out);
+        continue;
+      }
+      if (format == BC3) {
+        encodeAlphaBlock(block, out);
+        out += 8;
+      }
+      encodeColorBlock(block, out);
+    }
+  });
+  return res;
+}
+
+} // namespace bc
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Bounding volume hierarchy over axis-aligned boxes.
+// Built with binned SAH, stored as a flat array of 32-byte nodes so that a
+// traversal touches one cache line per node.
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 dir;    // not necessarily normalized -- t is in units of dir
+  glm::vec3 invDir; // derived -- 1/dir, used by the slab test
+
+  Ray(glm::vec3 origin, glm::vec3 dir)
+      : origin(origin), dir(dir), invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z) {}
+
+  glm::vec3 at(float t) const { return origin + t * dir; }
+};
+
+struct Aabb {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+  void grow(glm::vec3 p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+  void grow(const Aabb &b) {
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+  }
+  glm::vec3 centroid() const { return 0.5f * (min + max); }
+  float     area() const {
+    glm::vec3 e = max - min;
+    return e.x < 0.0f ? 0.0f : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+
+  // bounds of this box after an affine transform (Arvo)
+  Aabb transformed(const glm::mat4 &m) const {
+    Aabb res;
+    res.min = res.max = glm::vec3(m[3]);
+    for (int c = 0; c < 3; ++c) {
+      for (int r = 0; r < 3; ++r) {
+        float a = m[c][r] * min[c];
+        float b = m[c][r] * max[c];
+        res.min[r] += std::min(a, b);
+        res.max[r] += std::max(a, b);
+      }
+    }
+    return res;
+  }
+};
+
+/** returns true iff ray hits box within [0, tMax); tNear is the entry distance. */
+inline bool intersectAabb(const Ray &ray, const Aabb &box, float tMax, float &tNear) {
+  glm::vec3 t0 = (box.min - ray.origin) * ray.invDir;
+  glm::vec3 t1 = (box.max - ray.origin) * ray.invDir;
+  for (int i = 0; i < 3; ++i) {
+    if (ray.dir[i] == 0.0f) {
+      // parallel to the slab: within it for every t or for none. t0/t1 are NaN
+      // (0 * inf) when the origin lies on one of its planes
+      if (ray.origin[i] < box.min[i] || ray.origin[i] > box.max[i]) {
+        return false;
+      }
+      t0[i] = -std::numeric_limits<float>::infinity();
+      t1[i] = std::numeric_limits<float>::infinity();
+    }
+  }
+  glm::vec3 tmin = glm::min(t0, t1);
+  glm::vec3 tmax = glm::max(t0, t1);
+  tNear          = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+  float tFar     = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, tMax));
+  return tNear <= tFar;
+}
+
+/** Moller-Trumbore. returns true iff ray hits triangle (either side) closer than t. */
+inline bool intersectTriangle(const Ray &ray, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2,
+                              float &t) {
+  const float eps = 1e-8f;
+  glm::vec3   e1  = v1 - v0;
+  glm::vec3   e2  = v2 - v0;
+  glm::vec3   p   = glm::cross(ray.dir, e2);
+  float       det = glm::dot(e1, p);
+  if (std::abs(det) < eps) {
+    return false; // parallel
+  }
+  float     invDet = 1.0f / det;
+  glm::vec3 s      = ray.origin - v0;
+  float     u      = glm::dot(s, p) * invDet;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+  glm::vec3 q = glm::cross(s, e1);
+  float     v = glm::dot(ray.dir, q) * invDet;
+  if (v < 0.0f || u + v > 1.0f) {
+    return false;
+  }
+  float tHit = glm::dot(e2, q) * invDet;
+  if (tHit < 0.0f || tHit >= t) {
+    return false;
+  }
+  t = tHit;
+  return true;
+}
+
+class Bvh {
+public:
+  struct Node {
+    Aabb     bounds;
+    uint32_t first; // interior: index of left child (right is first + 1)
+                    // leaf: offset into primIndices
+    uint32_t count; // 0 for interior nodes
+  };
+  static_assert(sizeof(Node) == 32);
+
+  static constexpr uint32_t MAX_LEAF_SIZE = 4;
+  static constexpr int      NR_BINS       = 16;
+  static constexpr int      MAX_DEPTH     = 64;
+
+  std::vector<Node>     nodes;
+  std::vector<uint32_t> primIndices; // leaf ranges index into the caller's bounds
+
+  void build(std::span<const Aabb> primBounds) {
+    nodes.clear();
+    primIndices.resize(primBounds.size());
+    for (uint32_t i = 0; i < primIndices.size(); ++i) {
+      primIndices[i] = i;
+    }
+    m_centroids.resize(primBounds.size());
+    for (size_t i = 0; i < primBounds.size(); ++i) {
+      m_centroids[i] = primBounds[i].centroid();
+    }
+    if (primBounds.empty()) {
+      return;
+    }
+    nodes.reserve(2 * primBounds.size() / MAX_LEAF_SIZE + 1);
+    nodes.push_back({ {}, 0, static_cast<uint32_t>(primBounds.size()) });
+    subdivide(0, primBounds, 0);
+    m_centroids = {};
+  }
+
+  /** visits leaf primitives along ray in roughly front-to-back order.
+   * hitPrim(primIndex, tMax) returns true iff it hit, and may then shrink tMax.
+   * returns true iff any primitive was hit. */
+  template <class F> bool raycast(const Ray &ray, float &tMax, F &&hitPrim) const {
+    if (nodes.empty()) {
+      return false;
+    }
+    float tNear = 0.0f;
+    if (!intersectAabb(ray, nodes[0].bounds, tMax, tNear)) {
+      return false;
+    }
+
+    bool                            hit = false;
+    std::array<uint32_t, MAX_DEPTH> stack;
+    int                             top = 0;
+    stack[top++]                        = 0;
+    while (top > 0) {
+      const Node &node = nodes[stack[--top]];
+      if (node.count > 0) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+          hit |= hitPrim(primIndices[i], tMax);
+        }
+        continue;
+      }
+
+      uint32_t l = node.first, r = node.first + 1;
+      float    tl = 0.0f, tr = 0.0f;
+      bool     hl = intersectAabb(ray, nodes[l].bounds, tMax, tl);
+      bool     hr = intersectAabb(ray, nodes[r].bounds, tMax, tr);
+      if (hl && hr) {
+        if (tl > tr) {
+          std::swap(l, r);
+        }
+        stack[top++] = r; // far child visited last
+        stack[top++] = l;
+      } else if (hl) {
+        stack[top++] = l;
+      } else if (hr) {
+        stack[top++] = r;
+      }
+    }
+    return hit;
+  }
+
+private:
+  std::vector<glm::vec3> m_centroids; // scratch, only valid during build
+
+  void subdivide(uint32_t nodeIdx, std::span<const Aabb> primBounds, int depth) {
+    Node &node = nodes[nodeIdx];
+    Aabb  centroidBounds;
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      node.bounds.grow(primBounds[primIndices[i]]);
+      centroidBounds.grow(m_centroids[primIndices[i]]);
+    }
+    if (node.count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH - 2) {
+      return;
+    }
+
+    int   axis  = 0;
+    float split = 0.0f;
+    float cost  = findSplit(node, centroidBounds, primBounds, axis, split);
+    if (cost >= node.count * node.bounds.area()) {
+      return; // splitting doesn't pay for itself
+    }
+
+    // partition primIndices in place around split
+    auto begin = primIndices.begin() + node.first;
+    auto end   = begin + node.count;
+    auto mid   = std::partition(
+        begin, end, [&](uint32_t p) { return m_centroids[p][axis] < split; });
+    uint32_t leftCount = static_cast<uint32_t>(mid - begin);
+    if (leftCount == 0 || leftCount == node.count) {
+      return;
+    }
+
+    uint32_t first = node.first, count = node.count;
+    uint32_t left  = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({ {}, first, leftCount });
+    nodes.push_back({ {}, first + leftCount, count - leftCount });
+    nodes[nodeIdx].first = left; // node may dangle after push_back
+    nodes[nodeIdx].count = 0;
+    subdivide(left, primBounds, depth + 1);
+    subdivide(left + 1, primBounds, depth + 1);
+  }
+
+  float findSplit(const Node &node, const Aabb &centroidBounds,
+                  std::span<const Aabb> primBounds, int &axis, float &split) const {
+    // bin along the widest centroid axis only -- a third of the work of trying all
+    // three, and rarely a worse tree
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    axis  = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                : (extent.y > extent.z ? 1 : 2);
+    float lo = centroidBounds.min[axis], hi = centroidBounds.max[axis];
+    if (lo == hi) {
+      return std::numeric_limits<float>::max(); // all centroids coincide
+    }
+
+    struct Bin {
+      Aabb     bounds;
+      uint32_t count = 0;
+    };
+    std::array<Bin, NR_BINS> bins{};
+    float                    scale = NR_BINS / (hi - lo);
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      uint32_t p = primIndices[i];
+      int      b = std::min(NR_BINS - 1, (int)((m_centroids[p][axis] - lo) * scale));
+      bins[b].count++;
+      bins[b].bounds.grow(primBounds[p]);
+    }
+
+    // sweep from both sides to get the SAH cost of each of the NR_BINS-1 planes
+    std::array<float, NR_BINS - 1>    leftArea{}, rightArea{};
+    std::array<uint32_t, NR_BINS - 1> leftCount{}, rightCount{};
+    Aabb                              leftBox, rightBox;
+    uint32_t                          leftSum = 0, rightSum = 0;
+    for (int i = 0; i < NR_BINS - 1; ++i) {
+      leftSum += bins[i].count;
+      leftCount[i] = leftSum;
+      leftBox.grow(bins[i].bounds);
+      leftArea[i] = leftBox.area();
+      rightSum += bins[NR_BINS - 1 - i].count;
+      rightCount[NR_BINS - 2 - i] = rightSum;
+      rightBox.grow(bins[NR_BINS - 1 - i].bounds);
+      rightArea[NR_BINS - 2 - i] = rightBox.area();
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    for (int i = 0; i < NR_BINS - 1; ++i) {
+      float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+      if (cost < bestCost) {
+        bestCost = cost;
+        split    = lo + (i + 1) / scale;
+      }
+    }
+    return bestCost;
+  }
+};
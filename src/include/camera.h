@@ -24,6 +24,14 @@ struct Camera {
 
   glm::mat4 view() const { return glm::lookAt(pos, pos + m_z, UP); }
 
+  // world-space direction through ndc (in [-1,1]^2) for a perspective projection
+  // with this fov -- avoids inverting view/projection matrices
+  glm::vec3 rayDir(glm::vec2 ndc, float aspect) const {
+    float tanHalfFov = glm::tan(0.5f * fov);
+    return glm::normalize(m_z + ndc.x * aspect * tanHalfFov * m_x +
+                          ndc.y * tanHalfFov * m_y);
+  }
+
   // dx > 0: turn right
   // dy > 0: look up
   void handleMouse(float dx, float dy) {
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Cascade placement for directional light shadow maps, with caching.
+//
+// Each cascade is fitted to a bounding sphere of its slice of the view frustum,
+// so its size does not change as the camera turns. The region actually rendered
+// is larger than needed by MARGIN and its center is snapped to whole texels; it is
+// only moved -- and static casters re-rendered -- once the needed region would
+// leave it. Between moves the static depth can be reused as is, with only dynamic
+// casters drawn on top, and snapping keeps the edges from shimmering when it moves.
+
+class ShadowCascades {
+public:
+  static constexpr unsigned int NR_CASCADES = 4;
+  static constexpr float        MARGIN      = 0.25f; // extra half-extent, fraction
+
+  struct Cascade {
+    float     splitFar;      // view-space distance this cascade covers up to
+    glm::mat4 projection;    // light view -> clip, for the cached region
+    bool      staticChanged; // region moved this frame: re-render static casters
+  };
+
+  /** splits [zNear, shadowFar] blending logarithmic (lambda = 1) and uniform. */
+  ShadowCascades(unsigned int resolution, float zNear, float shadowFar,
+                 float lambda = 0.75f)
+      : m_resolution(resolution) {
+    float splitNear = zNear;
+    for (unsigned int i = 0; i < NR_CASCADES; ++i) {
+      float f        = float(i + 1) / NR_CASCADES;
+      float logSplit = zNear * std::pow(shadowFar / zNear, f);
+      float uniSplit = zNear + (shadowFar - zNear) * f;
+      m_splitNear[i] = splitNear;
+      m_cascades[i].splitFar = lambda * logSplit + (1.0f - lambda) * uniSplit;
+      splitNear              = m_cascades[i].splitFar;
+    }
+  }
+
+  const Cascade &cascade(unsigned int i) const { return m_cascades[i]; }
+  glm::mat4      lightView() const { return m_lightView; }
+  glm::mat4 viewProjection(unsigned int i) const {
+    return m_cascades[i].projection * m_lightView;
+  }
+  // world-space size of one shadow map texel in cascade i, eg: for normal offsets
+  float texelSize(unsigned int i) const {
+    return 2.0f * m_regions[i].halfExtent / m_resolution;
+  }
+
+  /** forces every cascade to re-render static casters, eg: after they changed. */
+  void invalidate() {
+    for (auto &c : m_regions) {
+      c.valid = false;
+    }
+  }
+
+  /** refits the cascades to the camera. lightDir points from the light into the
+   * scene; sceneBounds bounds every caster, so casters outside the view frustum
+   * still land inside each cascade's depth range. */
+  void update(const Camera &camera, float aspect, glm::vec3 lightDir,
+              const Aabb &sceneBounds) {
+    lightDir = glm::normalize(lightDir);
+    if (glm::dot(lightDir, m_lightDir) < 0.99999f || sceneBounds.min != m_sceneMin ||
+        sceneBounds.max != m_sceneMax) {
+      m_lightDir   = lightDir;
+      m_sceneMin   = sceneBounds.min;
+      m_sceneMax   = sceneBounds.max;
+      glm::vec3 up = std::abs(lightDir.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f)
+                                                  : glm::vec3(1.0f, 0.0f, 0.0f);
+      m_lightView  = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+      Aabb bounds  = sceneBounds.transformed(m_lightView);
+      m_depthNear  = -bounds.max.z - 1.0f; // looking down -z
+      m_depthFar   = -bounds.min.z + 1.0f;
+      invalidate();
+    }
+
+    glm::mat4 invView    = glm::inverse(camera.view());
+    float     tanHalfFov = glm::tan(0.5f * camera.fov);
+    for (unsigned int i = 0; i < NR_CASCADES; ++i) {
+      // bounding sphere of the slice's 8 corners, in light space
+      float     dNear = m_splitNear[i], dFar = m_cascades[i].splitFar;
+      glm::vec3 corners[8];
+      glm::vec3 center(0.0f);
+      for (int k = 0; k < 8; ++k) {
+        float     d    = k & 4 ? dFar : dNear;
+        glm::vec3 vPos = glm::vec3((k & 1 ? 1.0f : -1.0f) * d * aspect * tanHalfFov,
+                                   (k & 2 ? 1.0f : -1.0f) * d * tanHalfFov, -d);
+        corners[k]     = glm::vec3(m_lightView * invView * glm::vec4(vPos, 1.0f));
+        center += corners[k] / 8.0f;
+      }
+      float radius = 0.0f;
+      for (const auto &corner : corners) {
+        radius = std::max(radius, glm::length(corner - center));
+      }
+      radius = std::ceil(radius * 16.0f) / 16.0f; // absorb float noise between frames
+
+      Region &region     = m_regions[i];
+      float   halfExtent = radius * (1.0f + MARGIN);
+      float   texel      = 2.0f * halfExtent / m_resolution;
+      // how far the needed region may drift, in whole texels
+      float     threshold = std::floor(radius * MARGIN / texel) * texel;
+      glm::vec2 drift     = glm::abs(glm::vec2(center) - region.center);
+      bool      moved     = !region.valid || region.halfExtent != halfExtent ||
+                   std::max(drift.x, drift.y) > threshold;
+      m_cascades[i].staticChanged = moved;
+      if (moved) {
+        region.center     = glm::floor(glm::vec2(center) / texel) * texel;
+        region.halfExtent = halfExtent;
+        region.valid      = true;
+        m_cascades[i].projection =
+            glm::ortho(region.center.x - halfExtent, region.center.x + halfExtent,
+                       region.center.y - halfExtent, region.center.y + halfExtent,
+                       m_depthNear, m_depthFar);
+      }
+    }
+  }
+
+  /** true iff box (world space) can cast into cascade i's cached region. */
+  bool covers(unsigned int i, const Aabb &box) const {
+    Aabb        ls = box.transformed(m_lightView);
+    const auto &r  = m_regions[i];
+    glm::vec2   lo = r.center - r.halfExtent;
+    glm::vec2   hi = r.center + r.halfExtent;
+    return ls.max.x >= lo.x && ls.min.x <= hi.x && ls.max.y >= lo.y && ls.min.y <= hi.y;
+  }
+
+private:
+  struct Region {
+    glm::vec2 center     = glm::vec2(0.0f); // light-space xy, texel snapped
+    float     halfExtent = 0.0f;
+    bool      valid      = false;
+  };
+
+  unsigned int                     m_resolution;
+  std::array<Cascade, NR_CASCADES> m_cascades;
+  std::array<float, NR_CASCADES>   m_splitNear;
+  std::array<Region, NR_CASCADES>  m_regions;
+  glm::vec3                        m_lightDir  = glm::vec3(0.0f);
+  glm::vec3                        m_sceneMin  = glm::vec3(0.0f);
+  glm::vec3                        m_sceneMax  = glm::vec3(0.0f);
+  glm::mat4                        m_lightView = glm::mat4(1.0f);
+  float                            m_depthNear = 0.0f;
+  float                            m_depthFar  = 1.0f;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+
+// Dynamic resolution: render the scene at a fraction of the window size, chosen each
+// frame from measured GPU time against a frame budget, and upscale the result.
+
+/** GL_TIME_ELAPSED queries in a ring, read back only once the GPU has finished them,
+ * so timing never stalls the pipeline. results lag a few frames behind, so each
+ * carries the render scale its frame was drawn at. */
+class GpuTimer {
+public:
+  static constexpr unsigned int NR_QUERIES = 4; // frames in flight
+
+  struct Sample {
+    float ms;
+    float scale; // as given to begin()
+  };
+
+  void init() {
+    glGenQueries(NR_QUERIES, m_queries.data());
+    m_next    = 0;
+    m_pending = 0;
+  }
+  void cleanup() { glDeleteQueries(NR_QUERIES, m_queries.data()); }
+
+  void begin(float scale) {
+    if (m_pending == NR_QUERIES) {
+      read(true); // every query is in flight -- wait for the oldest
+    }
+    m_scales[m_next] = scale;
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+  }
+  void end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_next = (m_next + 1) % NR_QUERIES;
+    m_pending++;
+  }
+
+  /** the latest begin/end pair the GPU has finished, if any finished since the last
+   * call. */
+  std::optional<Sample> poll() {
+    std::optional<Sample> res;
+    while (m_pending > 0) {
+      auto sample = read(false);
+      if (!sample) {
+        break;
+      }
+      res = sample;
+    }
+    return res;
+  }
+
+private:
+  std::array<GLuint, NR_QUERIES> m_queries{};
+  std::array<float, NR_QUERIES>  m_scales{}; // by query
+  unsigned int                   m_next    = 0; // query the next begin() uses
+  unsigned int                   m_pending = 0; // ended but not yet read
+
+  std::optional<Sample> read(bool wait) {
+    unsigned int i     = (m_next + NR_QUERIES - m_pending) % NR_QUERIES;
+    GLuint       query = m_queries[i];
+    if (!wait) {
+      GLint available = 0;
+      glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) {
+        return std::nullopt;
+      }
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    m_pending--;
+    return Sample{ ns / 1e6f, m_scales[i] };
+  }
+};
+
+/** picks the render scale (fraction of the window's width and height) that keeps
+ * the measured GPU time under budget. */
+class ResolutionController {
+public:
+  static constexpr float HEADROOM  = 0.9f;  // aim this far under budget
+  static constexpr float SMOOTHING = 0.2f;  // weight of the newest sample
+  static constexpr float DEADBAND  = 0.02f; // ignore smaller scale changes
+  static constexpr float MAX_RAISE = 0.05f; // per update -- drop fast, climb slow
+  static constexpr float QUANTUM   = 1.0f / 64.0f;
+
+  ResolutionController(float budgetMs, float minScale = 0.5f, float maxScale = 1.0f)
+      : m_budgetMs(budgetMs), m_minScale(minScale), m_maxScale(maxScale),
+        m_scale(maxScale) {}
+
+  float scale() const { return m_scale; }
+  float smoothedMs() const { return m_smoothedMs; }
+
+  /** feeds the GPU time of a frame rendered at scale -- not the current one, when the
+   * timing lags a change; returns the scale for the next frame. */
+  float update(float gpuMs, float scale) {
+    // shading cost goes with the pixel count, ie: the square of the scale. taken as
+    // the time of a frame at the current scale, so older samples can't undo a change
+    gpuMs *= (m_scale * m_scale) / (scale * scale);
+    m_smoothedMs =
+        m_smoothedMs > 0.0f ? m_smoothedMs + SMOOTHING * (gpuMs - m_smoothedMs) : gpuMs;
+
+    float target = m_scale * std::sqrt(HEADROOM * m_budgetMs / m_smoothedMs);
+    target       = std::clamp(target, m_minScale, m_maxScale);
+    if (std::abs(target - m_scale) < DEADBAND &&
+        !(target == m_maxScale && m_scale < m_maxScale)) {
+      return m_scale;
+    }
+    target = std::min(target, m_scale + MAX_RAISE);
+    target = std::clamp(std::round(target / QUANTUM) * QUANTUM, m_minScale, m_maxScale);
+
+    // predict the average at the new scale, rather than wait for it to catch up and
+    // overshoot meanwhile
+    m_smoothedMs *= (target * target) / (m_scale * m_scale);
+    m_scale = target;
+    return m_scale;
+  }
+
+private:
+  float m_budgetMs;
+  float m_minScale;
+  float m_maxScale;
+  float m_scale;
+  float m_smoothedMs = 0.0f;
+};
@@ -2,24 +2,53 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 #include <source_location>
+#include <span>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#ifdef LEARNOPENGL2_ZSTD
+#include <zstd.h>
+#endif
 
 constexpr std::string currentBasename(std::source_location location);
 
 std::string readFile(const std::string &path);
 /** returns true iff file has changed since last time `fileChanged` was called
  * with path. */
-bool fileChanged(const std::string &path);
+bool fileChanged(std::string_view path);
+class AssetPack;
+/** the asset pack at PACK_PATH, if the build reads one (LEARNOPENGL2_ASSET_PACK) and
+ * it exists. */
+const AssetPack *assetPack();
 
 static constexpr const auto findRoot() {
   std::source_location location = std::source_location::current(); // src/include/file.h
@@ -55,16 +84,414 @@ std::string readFile(const std::string &path) {
   return res;
 }
 
-bool fileChanged(const std::string &path) {
-  static std::unordered_map<std::string, int64_t> mtimes;
+/** a whole file, read only. mapped into memory where the platform allows, so it is
+ * neither copied nor allocated; read into a buffer otherwise (windows, empty files,
+ * or if mapping fails). */
+class MappedFile {
+public:
+  /** readAhead: the file will be read front to back soon, so the kernel may page it
+   * in ahead of the reads rather than fault on each page. */
+  explicit MappedFile(const std::string &path, bool readAhead = false) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      auto msg = "could not open " + path + " for reading: " + std::strerror(errno);
+      std::cerr << msg << std::endl;
+      throw std::runtime_error(msg);
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        m_data   = (const char *)p;
+        m_size   = st.st_size;
+        m_mapped = true;
+        if (readAhead) {
+          posix_madvise(p, m_size, POSIX_MADV_SEQUENTIAL);
+          posix_madvise(p, m_size, POSIX_MADV_WILLNEED);
+        }
+      }
+    }
+    close(fd);
+#endif
+    if (!m_mapped) {
+      m_buffer = readFile(path);
+      m_data   = m_buffer.data();
+      m_size   = m_buffer.size();
+    }
+  }
+  MappedFile(MappedFile &other)            = delete;
+  MappedFile &operator=(MappedFile &other) = delete;
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_mapped, other.m_mapped);
+    std::swap(m_buffer, other.m_buffer);
+    // short strings live inside the string object, so buffers may have moved
+    m_data       = m_mapped ? m_data : m_buffer.data();
+    other.m_data = other.m_mapped ? other.m_data : other.m_buffer.data();
+    return *this;
+  }
+  ~MappedFile() {
+#ifndef _WIN32
+    if (m_mapped) {
+      munmap((void *)m_data, m_size);
+    }
+#endif
+  }
+
+  const char *data() const { return m_data; }
+  size_t      size() const { return m_size; }
+  bool        mapped() const { return m_mapped; }
+
+  std::string_view           view() const { return { m_data, m_size }; }
+  std::span<const std::byte> bytes() const {
+    return { (const std::byte *)m_data, m_size };
+  }
+
+private:
+  const char *m_data   = "";
+  size_t      m_size   = 0;
+  bool        m_mapped = false;
+  std::string m_buffer; // when not mapped
+};
+
+// An asset pack: files of the repo in one file, assets.pack at the repo root, so
+// loading them costs no opens or stats -- the pack is mapped once and each file is
+// a view of it. tools/asset_pack.cpp writes packs.
+//
+//   PackHeader
+//   PackEntry[nrEntries], sorted by hash (ties in any order)
+//   names                 not nul-terminated, an entry's at [name, name + nameSize)
+//   data                  each entry's at a multiple of PACK_ALIGNMENT
+//
+// An entry's data is stored as is, or compressed with zstd (PACK_ZSTD) where that
+// pays off, which takes a build with zstd (LEARNOPENGL2_ZSTD) to read.
+
+constexpr char     PACK_MAGIC[8]  = { 'L', 'O', 'G', 'L', 'P', 'A', 'C', 'K' };
+constexpr uint32_t PACK_VERSION   = 1;
+constexpr size_t   PACK_ALIGNMENT = 64;
+constexpr uint32_t PACK_STORED    = 0;
+constexpr uint32_t PACK_ZSTD      = 1;
+constexpr auto     PACK_PATH      = "assets.pack"; // relative to the repo root
+
+struct PackHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t nrEntries;
+  uint64_t names; // offset of the names
+  uint64_t namesSize;
+};
+
+struct PackEntry {
+  uint64_t hash; // packHash of the name
+  uint64_t offset;
+  uint64_t size;       // uncompressed
+  uint64_t storedSize; // in the pack
+  uint64_t name;       // offset into the names
+  uint32_t nameSize;
+  uint32_t compression;
+};
+
+/** 64-bit FNV-1a of s. pass the hash of what came before as h to hash in pieces. */
+constexpr uint64_t fnv1a(std::string_view s, uint64_t h = 0xcbf29ce484222325) {
+  for (char c : s) {
+    h = (h ^ (uint8_t)c) * 0x100000001b3;
+  }
+  return h;
+}
+
+/** the hash of a path relative to the repo root, with '/' separators. */
+constexpr uint64_t packHash(std::string_view name) { return fnv1a(name); }
+
+/** a pack, mapped. */
+class AssetPack {
+public:
+  explicit AssetPack(const std::string &path) : m_file(path, true) {
+    auto file = m_file.view();
+    if (file.size() < sizeof(PackHeader)) {
+      return;
+    }
+    const auto &h = *(const PackHeader *)file.data();
+    if (std::memcmp(h.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+        h.version != PACK_VERSION ||
+        sizeof(PackHeader) + (uint64_t)h.nrEntries * sizeof(PackEntry) > file.size() ||
+        h.names + h.namesSize > file.size()) {
+      return;
+    }
+    m_entries = { (const PackEntry *)(file.data() + sizeof(PackHeader)), h.nrEntries };
+    m_names   = file.substr(h.names, h.namesSize);
+    for (const auto &entry : m_entries) {
+      if (entry.offset + entry.storedSize > file.size() ||
+          entry.name + entry.nameSize > m_names.size()) {
+        m_entries = {};
+        return;
+      }
+    }
+    m_valid = true;
+  }
+  AssetPack(AssetPack &other)            = delete;
+  AssetPack &operator=(AssetPack &other) = delete;
+
+  bool   valid() const { return m_valid; }
+  size_t size() const { return m_entries.size(); }
+
+  bool contains(std::string_view name) const { return lookup(name) != nullptr; }
+
+  /** the contents of the file at name (relative to the repo root), if the pack has
+   * it. compressed entries are decompressed on first use, and kept. */
+  std::optional<std::string_view> find(std::string_view name) const {
+    const PackEntry *entry = lookup(name);
+    if (entry == nullptr) {
+      return std::nullopt;
+    }
+    auto stored = m_file.view().substr(entry->offset, entry->storedSize);
+    if (entry->compression == PACK_STORED) {
+      return stored;
+    }
+    std::lock_guard lock(m_mutex);
+    auto [it, inserted] = m_decompressed.try_emplace(entry - m_entries.data());
+    if (!inserted) {
+      return it->second; // nodes, and so the strings in them, stay put
+    }
+#ifdef LEARNOPENGL2_ZSTD
+    if (entry->compression == PACK_ZSTD) {
+      it->second.resize(entry->size);
+      auto n = ZSTD_decompress(it->second.data(), entry->size, stored.data(),
+                               stored.size());
+      if (!ZSTD_isError(n) && n == entry->size) {
+        return it->second;
+      }
+    }
+#endif
+    m_decompressed.erase(it);
+    std::cerr << "could not decompress " << name << " from the asset pack" << std::endl;
+    return std::nullopt;
+  }
+
+private:
+  MappedFile                 m_file;
+  std::span<const PackEntry> m_entries;
+  std::string_view           m_names;
+  bool                       m_valid = false;
+
+  mutable std::mutex                              m_mutex;
+  mutable std::unordered_map<size_t, std::string> m_decompressed; // by entry index
+
+  const PackEntry *lookup(std::string_view name) const {
+    auto hash = packHash(name);
+    auto it   = std::ranges::lower_bound(m_entries, hash, {}, &PackEntry::hash);
+    for (; it != m_entries.end() && it->hash == hash; ++it) {
+      if (m_names.substr(it->name, it->nameSize) == name) {
+        return &*it;
+      }
+    }
+    return nullptr;
+  }
+};
+
+const AssetPack *assetPack() {
+#ifdef LEARNOPENGL2_ASSET_PACK
+  static const auto pack = []() -> std::unique_ptr<AssetPack> {
+    std::error_code ec;
+    if (!std::filesystem::exists(ROOT + PACK_PATH, ec)) {
+      return nullptr;
+    }
+    auto res = std::make_unique<AssetPack>(ROOT + PACK_PATH);
+    if (!res->valid()) {
+      std::cerr << "ignoring " << ROOT + PACK_PATH << ": not an asset pack" << std::endl;
+      return nullptr;
+    }
+    return res;
+  }();
+  return pack.get();
+#else
+  return nullptr;
+#endif
+}
+
+/** a file of the repo, read only: its entry in the asset pack if there is one, the
+ * file itself, mapped, otherwise. */
+class Asset {
+public:
+  /** path: relative to the repo root. readAhead: as for MappedFile. */
+  explicit Asset(const std::string &path, bool readAhead = false) {
+    if (const AssetPack *pack = assetPack()) {
+      if (auto data = pack->find(path)) {
+        m_view = *data;
+        return;
+      }
+    }
+    m_file.emplace(ROOT + path, readAhead);
+    m_view = m_file->view();
+  }
+  explicit Asset(MappedFile file) : m_file(std::move(file)), m_view(m_file->view()) {}
+  Asset(Asset &other)            = delete;
+  Asset &operator=(Asset &other) = delete;
+  Asset(Asset &&other) noexcept { *this = std::move(other); }
+  Asset &operator=(Asset &&other) noexcept {
+    m_file = std::move(other.m_file);
+    m_view = m_file ? m_file->view() : other.m_view; // buffers may have moved
+    return *this;
+  }
+
+  const char      *data() const { return m_view.data(); }
+  size_t           size() const { return m_view.size(); }
+  std::string_view view() const { return m_view; }
+  /** whether it came from the asset pack. */
+  bool packed() const { return !m_file; }
+
+private:
+  std::optional<MappedFile> m_file; // when not packed
+  std::string_view          m_view;
+};
+
+/** tells which files changed since they were last asked about.
+ *
+ * on linux, a thread blocks on inotify watches of the files' directories (which
+ * survive editors that save by renaming over the file) and marks files as they change,
+ * so asking costs a lookup and no syscall. a change is reported once the file has been
+ * quiet for DEBOUNCE, so the bursts of events a save produces make one reload, of the
+ * finished file. elsewhere, or where a watch can't be added, asking compares mtimes. */
+class FileWatcher {
+public:
+  static constexpr auto DEBOUNCE = std::chrono::milliseconds(50);
+
+  FileWatcher() {
+#ifdef __linux__
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd >= 0 && pipe2(m_wake, O_CLOEXEC) == 0) {
+      m_thread = std::thread([this] { watch(); });
+    } else if (m_fd >= 0) {
+      close(m_fd);
+      m_fd = -1;
+    }
+#endif
+  }
+  FileWatcher(FileWatcher &other)            = delete;
+  FileWatcher &operator=(FileWatcher &other) = delete;
+  ~FileWatcher() {
+#ifdef __linux__
+    if (m_thread.joinable()) {
+      char stop = 0;
+      (void)!write(m_wake[1], &stop, 1);
+      m_thread.join();
+      close(m_wake[0]);
+      close(m_wake[1]);
+      close(m_fd);
+    }
+#endif
+  }
 
-  auto p     = ROOT + path;
-  auto mtime = std::filesystem::last_write_time(p).time_since_epoch().count();
-  if (mtime != mtimes[p]) {
-    mtimes[p] = mtime;
+  /** true the first time path (relative to the repo root) is asked about, and then
+   * whenever it has changed since. */
+  bool changed(std::string_view path) {
+    std::lock_guard lock(m_mutex);
+    auto            it = m_files.find(path);
+    if (it == m_files.end()) {
+      add(std::string(path));
+      return true;
+    }
+    File &file = it->second;
+    if (file.wd < 0) {
+      auto mtime = mtimeOf(ROOT + it->first);
+      return std::exchange(file.mtime, mtime) != mtime;
+    }
+    if (!file.pending || std::chrono::steady_clock::now() - file.changedAt < DEBOUNCE) {
+      return false;
+    }
+    file.pending = false;
     return true;
   }
-  return false;
+
+private:
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+  struct File {
+    int                                   wd = -1; // of the directory, or polled
+    std::string                           name;    // within the directory
+    int64_t                               mtime     = 0;
+    bool                                  pending   = false;
+    std::chrono::steady_clock::time_point changedAt = {};
+  };
+
+  using Files = std::unordered_map<std::string, File, StringHash, std::equal_to<>>;
+
+  int         m_fd      = -1;
+  int         m_wake[2] = { -1, -1 }; // written to stop the thread
+  std::thread m_thread;
+  std::mutex  m_mutex;
+  Files       m_files; // by path as asked about
+
+  static int64_t mtimeOf(const std::string &path) {
+    std::error_code ec;
+    return std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  }
+
+  void add(std::string path) {
+    auto  full = std::filesystem::path(ROOT + path);
+    File &file = m_files[std::move(path)];
+    file.name  = full.filename().string();
+#ifdef __linux__
+    if (m_fd >= 0) {
+      auto mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE;
+      file.wd   = inotify_add_watch(m_fd, full.parent_path().c_str(), mask);
+    }
+#endif
+    if (file.wd < 0) {
+      file.mtime = mtimeOf(full.string());
+    }
+  }
+
+#ifdef __linux__
+  void watch() {
+    alignas(inotify_event) char buf[4096];
+    pollfd fds[] = { { .fd = m_fd, .events = POLLIN, .revents = 0 },
+                     { .fd = m_wake[0], .events = POLLIN, .revents = 0 } };
+    while (true) {
+      if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+        return;
+      }
+      if (fds[1].revents != 0) {
+        return;
+      }
+      ssize_t n;
+      while ((n = read(m_fd, buf, sizeof(buf))) > 0) {
+        auto            now = std::chrono::steady_clock::now();
+        std::lock_guard lock(m_mutex);
+        for (ssize_t at = 0; at < n;) {
+          auto *event = (const inotify_event *)(buf + at);
+          at         += sizeof(inotify_event) + event->len;
+          if (event->len == 0) {
+            continue;
+          }
+          for (auto &[_, file] : m_files) {
+            if (file.wd == event->wd && file.name == event->name) {
+              file.pending   = true;
+              file.changedAt = now;
+            }
+          }
+        }
+      }
+    }
+  }
+#endif
+};
+
+bool fileChanged(std::string_view path) {
+  if (const AssetPack *pack = assetPack(); pack != nullptr && pack->contains(path)) {
+    static std::mutex                      mutex;
+    static std::unordered_set<std::string> seen; // packed files never change
+    std::lock_guard                        lock(mutex);
+    return seen.insert(std::string(path)).second;
+  }
+  static FileWatcher watcher;
+  return watcher.changed(path);
 }
 
 constexpr std::string currentBasename(std::source_location location) {
@@ -19,8 +19,10 @@ struct Image {
   unsigned char *data;
 
   Image(const char *path_) : path(path_) {
-    path = ROOT + path;
-    data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+    auto file = Asset(path);
+    data      = stbi_load_from_memory((const stbi_uc *)file.data(), (int)file.size(),
+                                      &width, &height, &nrChannels, 0);
+    path      = ROOT + path;
     if (data == nullptr) {
       auto msg = "could not load image: " + path;
       std::cerr << msg << std::endl;
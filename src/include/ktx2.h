@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// KTX2 containers holding one 2d texture and its mip chain in a block-compressed
+// format, without supercompression -- what tools/ktx_bake writes and the texture
+// cache reads. See https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+namespace ktx2 {
+
+// VkFormat values
+constexpr uint32_t BC1_RGB_UNORM = 131;
+constexpr uint32_t BC1_RGB_SRGB  = 132;
+constexpr uint32_t BC3_UNORM     = 137;
+constexpr uint32_t BC3_SRGB      = 138;
+constexpr uint32_t BC7_UNORM     = 145;
+constexpr uint32_t BC7_SRGB      = 146;
+
+constexpr uint8_t IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2',
+                                     '0',  0xbb, '\r', '\n', 0x1a, '\n' };
+
+inline bool isBc3(uint32_t vkFormat) {
+  return vkFormat == BC3_UNORM || vkFormat == BC3_SRGB;
+}
+inline bool isBc7(uint32_t vkFormat) {
+  return vkFormat == BC7_UNORM || vkFormat == BC7_SRGB;
+}
+inline bool isSrgb(uint32_t vkFormat) {
+  return vkFormat == BC1_RGB_SRGB || vkFormat == BC3_SRGB || vkFormat == BC7_SRGB;
+}
+inline uint32_t blockBytes(uint32_t vkFormat) {
+  return isBc3(vkFormat) || isBc7(vkFormat) ? 16 : 8;
+}
+
+/** where the baked version of an image (relative to the repo root) lives:
+ * assets/x.png -> assets/baked/x.png.ktx2 */
+inline std::string bakedPath(const std::string &path) {
+  auto p = std::filesystem::path(path);
+  return (p.parent_path() / "baked" / (p.filename().string() + ".ktx2")).generic_string();
+}
+
+/** a texture to write. */
+struct Texture {
+  uint32_t                          vkFormat = 0;
+  uint32_t                          width    = 0;
+  uint32_t                          height   = 0;
+  std::string                       orientation = "rd"; // "ru": rows stored bottom up
+  std::vector<std::vector<uint8_t>> levels;             // level 0 (largest) first
+};
+
+/** a texture read from the bytes of a file, which it points into: they must outlive
+ * it. */
+struct TextureView {
+  uint32_t         vkFormat = 0;
+  uint32_t         width    = 0;
+  uint32_t         height   = 0;
+  uint32_t         nrLevels = 0;
+  std::string_view orientation = "rd"; // "ru": rows stored bottom up
+  std::string_view file;
+
+  /** the blocks of a level, level 0 (largest) first. */
+  std::span<const uint8_t> level(uint32_t i) const;
+  uint32_t levelWidth(uint32_t level) const { return std::max(1u, width >> level); }
+  uint32_t levelHeight(uint32_t level) const { return std::max(1u, height >> level); }
+};
+
+namespace detail {
+template <class T> void put(std::vector<uint8_t> &out, size_t offset, T value) {
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+template <class T> T get(std::string_view in, size_t offset) {
+  T value{};
+  if (offset + sizeof(T) <= in.size()) {
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+  }
+  return value;
+}
+inline size_t align(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+/** basic data format descriptor for the formats above. */
+inline std::vector<uint32_t> dfd(uint32_t vkFormat) {
+  const uint32_t MODEL_BC1A = 128, MODEL_BC3 = 130, MODEL_BC7 = 134;
+  const uint32_t PRIMARIES_BT709 = 1;
+  const uint32_t TRANSFER_LINEAR = 1, TRANSFER_SRGB = 2;
+  const uint32_t CHANNEL_COLOR = 0, CHANNEL_BC3_ALPHA = 15;
+  const uint32_t QUALIFIER_LINEAR = 1 << 4; // alpha is linear in srgb formats
+
+  bool     bc3     = isBc3(vkFormat);
+  uint32_t model   = bc3 ? MODEL_BC3 : isBc7(vkFormat) ? MODEL_BC7 : MODEL_BC1A;
+  uint32_t tf      = isSrgb(vkFormat) ? TRANSFER_SRGB : TRANSFER_LINEAR;
+  uint32_t nrBytes = blockBytes(vkFormat);
+
+  std::vector<uint32_t> words = {
+    0,                                       // total size, below
+    0,                                       // vendor khronos, descriptor type basic
+    2 | (24 + 16 * (bc3 ? 2u : 1u)) << 16,   // version, block size
+    model | PRIMARIES_BT709 << 8 | tf << 16, // flags: straight alpha
+    3 | 3 << 8,                              // 4x4x1x1 texel blocks
+    nrBytes,                                 // bytes in plane 0
+    0,
+  };
+  auto sample = [&](uint32_t bitOffset, uint32_t nrBits, uint32_t channel) {
+    words.insert(words.end(),
+                 { bitOffset | (nrBits - 1) << 16 | channel << 24, 0, 0, UINT32_MAX });
+  };
+  if (bc3) {
+    sample(0, 64, CHANNEL_BC3_ALPHA | (isSrgb(vkFormat) ? QUALIFIER_LINEAR : 0));
+    sample(64, 64, CHANNEL_COLOR);
+  } else {
+    sample(0, nrBytes * 8, CHANNEL_COLOR);
+  }
+  words[0] = words.size() * 4;
+  return words;
+}
+} // namespace detail
+
+inline void write(const std::string &path, const Texture &texture) {
+  using namespace detail;
+  const size_t HEADER_SIZE = 80;
+  size_t       nrLevels    = texture.levels.size();
+
+  auto                 dfdWords = dfd(texture.vkFormat);
+  std::vector<uint8_t> kvd;
+  for (auto [key, value] : { std::pair<std::string, std::string>{ "KTXorientation",
+                                                                  texture.orientation },
+                             { "KTXwriter", "learnopengl2 ktx_bake" } }) {
+    uint32_t length = key.size() + 1 + value.size() + 1;
+    size_t   at     = kvd.size();
+    kvd.resize(align(at + 4 + length, 4));
+    put(kvd, at, length);
+    std::memcpy(kvd.data() + at + 4, key.c_str(), key.size() + 1);
+    std::memcpy(kvd.data() + at + 4 + key.size() + 1, value.c_str(), value.size() + 1);
+  }
+
+  size_t dfdOffset = HEADER_SIZE + nrLevels * 24;
+  size_t kvdOffset = dfdOffset + dfdWords.size() * 4;
+  size_t end       = kvdOffset + kvd.size();
+
+  // smallest level first, each aligned to the block size
+  std::vector<size_t> offsets(nrLevels);
+  for (size_t i = nrLevels; i-- > 0;) {
+    offsets[i] = align(end, blockBytes(texture.vkFormat));
+    end        = offsets[i] + texture.levels[i].size();
+  }
+
+  std::vector<uint8_t> out(end);
+  std::memcpy(out.data(), IDENTIFIER, sizeof(IDENTIFIER));
+  const uint32_t header[] = { texture.vkFormat, 1, texture.width, texture.height, 0, 0,
+                              1, (uint32_t)nrLevels, 0 };
+  std::memcpy(out.data() + 12, header, sizeof(header));
+  put<uint32_t>(out, 48, dfdOffset);
+  put<uint32_t>(out, 52, dfdWords.size() * 4);
+  put<uint32_t>(out, 56, kvdOffset);
+  put<uint32_t>(out, 60, kvd.size());
+  put<uint64_t>(out, 64, 0); // no supercompression global data
+  put<uint64_t>(out, 72, 0);
+  for (size_t i = 0; i < nrLevels; ++i) {
+    uint64_t size = texture.levels[i].size();
+    put<uint64_t>(out, HEADER_SIZE + i * 24, offsets[i]);
+    put<uint64_t>(out, HEADER_SIZE + i * 24 + 8, size);
+    put<uint64_t>(out, HEADER_SIZE + i * 24 + 16, size);
+    std::memcpy(out.data() + offsets[i], texture.levels[i].data(), size);
+  }
+  std::memcpy(out.data() + dfdOffset, dfdWords.data(), dfdWords.size() * 4);
+  std::memcpy(out.data() + kvdOffset, kvd.data(), kvd.size());
+
+  if (auto dir = std::filesystem::path(path).parent_path(); !dir.empty()) {
+    std::filesystem::create_directories(dir);
+  }
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char *)out.data(), out.size());
+  if (!file) {
+    throw std::runtime_error("could not write " + path);
+  }
+}
+
+inline std::span<const uint8_t> TextureView::level(uint32_t i) const {
+  auto offset = detail::get<uint64_t>(file, 80 + i * 24);
+  auto size   = detail::get<uint64_t>(file, 80 + i * 24 + 8);
+  return { (const uint8_t *)file.data() + offset, (size_t)size };
+}
+
+/** the texture in the bytes of a file, if it is one this header writes. nothing is
+ * copied: the view points into in. */
+inline std::optional<TextureView> read(std::string_view in) {
+  using namespace detail;
+  if (in.size() < 80 || std::memcmp(in.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+    return std::nullopt;
+  }
+  TextureView texture;
+  texture.vkFormat   = get<uint32_t>(in, 12);
+  texture.width      = get<uint32_t>(in, 20);
+  texture.height     = get<uint32_t>(in, 24);
+  texture.nrLevels   = std::max(1u, get<uint32_t>(in, 40));
+  texture.file       = in;
+  bool     supported = texture.vkFormat == BC1_RGB_UNORM ||
+                   texture.vkFormat == BC1_RGB_SRGB || isBc3(texture.vkFormat) ||
+                   isBc7(texture.vkFormat);
+  if (!supported || get<uint32_t>(in, 28) != 0 || get<uint32_t>(in, 32) > 1 ||
+      get<uint32_t>(in, 36) != 1 || get<uint32_t>(in, 44) != 0 ||
+      in.size() < 80 + (size_t)texture.nrLevels * 24) {
+    return std::nullopt; // 3d, array, cube or supercompressed
+  }
+
+  for (uint32_t i = 0; i < texture.nrLevels; ++i) {
+    auto offset = get<uint64_t>(in, 80 + i * 24);
+    auto size   = get<uint64_t>(in, 80 + i * 24 + 8);
+    if (offset > in.size() || size > in.size() - offset) {
+      return std::nullopt;
+    }
+  }
+
+  size_t kvd = get<uint32_t>(in, 56);
+  size_t end = kvd + get<uint32_t>(in, 60);
+  while (kvd + 4 <= end && end <= in.size()) {
+    uint32_t length = get<uint32_t>(in, kvd);
+    if (kvd + 4 + length > end) {
+      break;
+    }
+    auto entry = in.substr(kvd + 4, length);
+    auto nul   = entry.find('\0');
+    if (nul != std::string_view::npos && entry.substr(0, nul) == "KTXorientation") {
+      texture.orientation = entry.substr(nul + 1, 2);
+    }
+    kvd = align(kvd + 4 + length, 4);
+  }
+  return texture;
+}
+
+} // namespace ktx2
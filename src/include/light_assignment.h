@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// CPU light assignment: gives each object a short list of the lights that can
+// reach it, so its shader loops over those instead of over every light.
+// Lights are bucketed in a SpatialHash by influence radius; each object's bounds
+// query it, and candidates are then tested against the light's cone.
+
+struct LightInfluence {
+  glm::vec3 pos;
+  float     range;     // eg: attenuationRange() from lights.h
+  glm::vec3 direction; // normalized, ignored for point lights
+  float     cosOuter;  // cos of the outer cutoff, <= -1 for point lights
+};
+
+/** conservative: false only if no point of box is inside light's range and cone. */
+inline bool influences(const LightInfluence &light, const Aabb &box) {
+  glm::vec3 d = light.pos - glm::clamp(light.pos, box.min, box.max);
+  if (glm::dot(d, d) > light.range * light.range) {
+    return false;
+  }
+  if (light.cosOuter <= -1.0f) {
+    return true;
+  }
+  // cone vs the box's bounding sphere: signed distance from the sphere center to the
+  // cone surface, compared against the sphere radius
+  glm::vec3 c        = box.centroid();
+  float     r        = glm::length(box.max - c);
+  glm::vec3 v        = c - light.pos;
+  float     vAxis    = glm::dot(v, light.direction);
+  float     vPerp    = std::sqrt(std::max(0.0f, glm::dot(v, v) - vAxis * vAxis));
+  float     sinOuter = std::sqrt(std::max(0.0f, 1.0f - light.cosOuter * light.cosOuter));
+  float     dCone    = light.cosOuter * vPerp - vAxis * sinOuter;
+  return dCone <= r && vAxis >= -r;
+}
+
+class LightAssignment {
+public:
+  static constexpr uint32_t MAX_LIGHTS_PER_OBJECT = 8;
+  static constexpr uint16_t NO_LIGHT              = 0xffff; // terminates a short list
+
+  using LightList = std::array<uint16_t, MAX_LIGHTS_PER_OBJECT>;
+
+  // cellSize should be on the order of the light ranges
+  explicit LightAssignment(float cellSize) : m_grid(cellSize) {}
+
+  /** fills a list per object with up to MAX_LIGHTS_PER_OBJECT lights influencing its
+   * bounds, nearest to its center first. lights.size() must be below NO_LIGHT. */
+  void assign(std::span<const LightInfluence> lights, std::span<const Aabb> objects) {
+    if (m_handles.size() != lights.size()) {
+      for (auto h : m_handles) {
+        m_grid.remove(h);
+      }
+      m_handles.clear();
+      for (const auto &light : lights) {
+        m_handles.push_back(m_grid.insert(light.pos, light.range));
+      }
+    } else {
+      for (size_t i = 0; i < lights.size(); ++i) {
+        m_grid.move(m_handles[i], lights[i].pos);
+      }
+    }
+    // removed handles are recycled in any order, so map them back to lights
+    m_lightOf.resize(m_handles.empty() ? 0 : *std::ranges::max_element(m_handles) + 1);
+    for (uint16_t i = 0; i < m_handles.size(); ++i) {
+      m_lightOf[m_handles[i]] = i;
+    }
+
+    m_lists.resize(objects.size());
+    for (size_t o = 0; o < objects.size(); ++o) {
+      const Aabb &box = objects[o];
+      glm::vec3   c   = box.centroid();
+      // insertion into a short list sorted by distance, farthest dropped
+      std::array<float, MAX_LIGHTS_PER_OBJECT> dist2;
+      uint32_t                                 count = 0;
+      LightList                               &list  = m_lists[o];
+      m_grid.queryBox(box, [&](SpatialHash::Handle h) {
+        uint16_t l = m_lightOf[h];
+        if (!influences(lights[l], box)) {
+          return;
+        }
+        glm::vec3 d  = lights[l].pos - c;
+        float     d2 = glm::dot(d, d);
+        if (count == MAX_LIGHTS_PER_OBJECT && d2 >= dist2[count - 1]) {
+          return;
+        }
+        uint32_t k = std::min(count, MAX_LIGHTS_PER_OBJECT - 1);
+        for (; k > 0 && dist2[k - 1] > d2; --k) {
+          dist2[k] = dist2[k - 1];
+          list[k]  = list[k - 1];
+        }
+        dist2[k] = d2;
+        list[k]  = l;
+        count    = std::min(count + 1, MAX_LIGHTS_PER_OBJECT);
+      });
+      std::fill(list.begin() + count, list.end(), NO_LIGHT);
+    }
+  }
+
+  const LightList &lights(size_t object) const { return m_lists[object]; }
+
+private:
+  SpatialHash                      m_grid;
+  std::vector<SpatialHash::Handle> m_handles; // per light
+  std::vector<uint16_t>            m_lightOf; // per handle
+  std::vector<LightList>           m_lists;   // per object
+};
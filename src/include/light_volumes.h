@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+// Closed meshes bounding a light's area of influence, for deferred light passes.
+// Both are circumscribed -- the true sphere/cone lies entirely inside the mesh --
+// so scaling them by the light range never clips lit pixels.
+// Triangles wind counter-clockwise seen from outside.
+
+struct VolumeMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t>  indices;
+};
+
+/** unit sphere at the origin, as a UV sphere with rings latitude bands. */
+inline VolumeMesh makeSphereVolume(uint32_t rings = 8, uint32_t segments = 12) {
+  const float pi = std::numbers::pi_v<float>;
+  // faces of the polyhedron come no closer to the center than this
+  float      inset = std::cos(pi / rings) * std::cos(pi / segments);
+  VolumeMesh res;
+  for (uint32_t r = 0; r <= rings; ++r) {
+    float theta = pi * r / rings; // from +y
+    for (uint32_t s = 0; s <= segments; ++s) {
+      float phi = 2.0f * pi * s / segments;
+      res.positions.push_back(glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta),
+                                        std::sin(theta) * std::cos(phi)) /
+                              inset);
+    }
+  }
+  uint32_t stride = segments + 1;
+  for (uint32_t r = 0; r < rings; ++r) {
+    for (uint32_t s = 0; s < segments; ++s) {
+      uint32_t i0 = r * stride + s, i1 = i0 + 1;
+      uint32_t i2 = i0 + stride, i3 = i2 + 1;
+      res.indices.insert(res.indices.end(), { i0, i2, i3, i0, i3, i1 });
+    }
+  }
+  return res;
+}
+
+/** cone with its apex at the origin opening along -z, base of radius 1 at z = -1. */
+inline VolumeMesh makeConeVolume(uint32_t segments = 16) {
+  const float pi     = std::numbers::pi_v<float>;
+  float       radius = 1.0f / std::cos(pi / segments);
+  VolumeMesh  res;
+  res.positions.push_back(glm::vec3(0.0f));              // apex
+  res.positions.push_back(glm::vec3(0.0f, 0.0f, -1.0f)); // base center
+  for (uint32_t s = 0; s < segments; ++s) {
+    float phi = 2.0f * pi * s / segments;
+    res.positions.push_back(
+        glm::vec3(radius * std::cos(phi), radius * std::sin(phi), -1.0f));
+  }
+  for (uint32_t s = 0; s < segments; ++s) {
+    uint32_t a = 2 + s, b = 2 + (s + 1) % segments;
+    res.indices.insert(res.indices.end(), { 0, a, b, 1, b, a });
+  }
+  return res;
+}
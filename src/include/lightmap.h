@@ -0,0 +1,331 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "bvh.h"
+#include "lights.h"
+#include "thread_pool.h"
+#include "whisky.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <vector>
+
+// Baked diffuse lighting for static scenes.
+//
+// Geometry is given as rectangles (eg: cube faces); each gets its own square chart
+// in a single atlas, so lightmap uvs never overlap. Baking traces a shadow ray per
+// light for direct irradiance, then one bounce: cosine-weighted rays that pick up
+// the direct irradiance of whatever they hit, times its albedo.
+//
+// Texels are kept as RGB9_E5 -- the texture's own format -- and written to disk
+// behind a small header, so a cached bake is one read and one glTexImage2D.
+
+struct LightmapQuad {
+  glm::vec3 origin; // corner at chart uv (0, 0)
+  glm::vec3 edgeU;  // to the corner at (1, 0)
+  glm::vec3 edgeV;  // to the corner at (0, 1), perpendicular to edgeU
+  glm::vec3 albedo; // diffuse reflectance, for the bounce
+
+  glm::vec3 normal() const { return glm::normalize(glm::cross(edgeU, edgeV)); }
+};
+
+struct BakeDirLight {
+  glm::vec3 direction; // from light towards scene
+  glm::vec3 color;     // diffuse
+};
+
+struct BakeSpotLight {
+  glm::vec3   pos;
+  glm::vec3   direction;
+  glm::vec3   color; // diffuse
+  float       cosInner;
+  float       cosOuter;
+  Attenuation attenuation;
+};
+
+struct LightmapScene {
+  std::vector<LightmapQuad>  quads;
+  BakeDirLight               dirLight;
+  std::vector<BakeSpotLight> spotLights;
+};
+
+struct LightmapSettings {
+  uint32_t chartSize    = 8;    // texels per chart side, not counting padding
+  uint32_t padding      = 1;    // border texels copied from the chart edge
+  uint32_t width        = 1024; // of the atlas
+  uint32_t nrBounceRays = 16;   // per texel
+};
+
+class Lightmap {
+public:
+  static constexpr uint32_t VERSION = 1;
+
+  Lightmap(uint32_t nrQuads, const LightmapSettings &settings)
+      : m_settings(settings), m_nrQuads(nrQuads) {
+    uint32_t stride = chartStride();
+    m_chartsPerRow  = std::max(1u, settings.width / stride);
+    m_width         = settings.width;
+    m_height        = (nrQuads + m_chartsPerRow - 1) / m_chartsPerRow * stride;
+    m_texels.assign((size_t)m_width * m_height, 0);
+  }
+
+  uint32_t width() const { return m_width; }
+  uint32_t height() const { return m_height; }
+  // packed RGB9_E5 irradiance, row-major from the bottom row
+  const std::vector<uint32_t> &texels() const { return m_texels; }
+
+  /** atlas uv of the point at chart uv st on quad. */
+  glm::vec2 uv(uint32_t quad, glm::vec2 st) const {
+    glm::vec2 corner = glm::vec2(chartCorner(quad)) + (float)m_settings.padding;
+    return (corner + st * (float)m_settings.chartSize) / glm::vec2(m_width, m_height);
+  }
+
+  /** key identifying what a bake of scene with these settings would produce. */
+  uint64_t key(const LightmapScene &scene) const {
+    uint64_t h = 14695981039346656037ull; // FNV-1a
+    auto     mix = [&h](const void *data, size_t size) {
+      for (size_t i = 0; i < size; ++i) {
+        h = (h ^ static_cast<const unsigned char *>(data)[i]) * 1099511628211ull;
+      }
+    };
+    mix(&VERSION, sizeof(VERSION));
+    mix(&m_settings, sizeof(m_settings));
+    mix(scene.quads.data(), scene.quads.size() * sizeof(LightmapQuad));
+    mix(&scene.dirLight, sizeof(scene.dirLight));
+    mix(scene.spotLights.data(), scene.spotLights.size() * sizeof(BakeSpotLight));
+    return h;
+  }
+
+  void bake(const LightmapScene &scene, ThreadPool &pool) {
+    m_quads = &scene.quads;
+    std::vector<Aabb> bounds;
+    for (const auto &q : scene.quads) {
+      Aabb b;
+      b.grow(q.origin);
+      b.grow(q.origin + q.edgeU + q.edgeV);
+      b.min -= glm::vec3(RAY_EPS); // flat boxes have no volume for the slab test
+      b.max += glm::vec3(RAY_EPS);
+      bounds.push_back(b);
+    }
+    m_bvh.build(bounds);
+
+    uint32_t size = m_settings.chartSize;
+    m_direct.assign((size_t)m_nrQuads * size * size, glm::vec3(0.0f));
+    pool.parallelFor(m_nrQuads, [&](uint32_t q) {
+      for (uint32_t t = 0; t < size * size; ++t) {
+        m_direct[q * size * size + t] = directAt(scene, q, t);
+      }
+    });
+
+    std::vector<glm::vec3> total(m_direct.size());
+    pool.parallelFor(m_nrQuads, [&](uint32_t q) {
+      for (uint32_t t = 0; t < size * size; ++t) {
+        total[q * size * size + t] = m_direct[q * size * size + t] + bounceAt(q, t);
+      }
+    });
+
+    // pack into the atlas, padding texels repeating the nearest chart texel so
+    // bilinear filtering at chart edges never reads a neighbouring chart
+    pool.parallelFor(m_nrQuads, [&](uint32_t q) {
+      glm::uvec2 corner = chartCorner(q);
+      int        pad    = (int)m_settings.padding;
+      for (int y = -pad; y < (int)size + pad; ++y) {
+        for (int x = -pad; x < (int)size + pad; ++x) {
+          uint32_t sx = std::clamp(x, 0, (int)size - 1);
+          uint32_t sy = std::clamp(y, 0, (int)size - 1);
+          size_t   at = (size_t)(corner.y + pad + y) * m_width + corner.x + pad + x;
+          m_texels[at] = glm::packF3x9_E5(total[q * size * size + sy * size + sx]);
+        }
+      }
+    });
+
+    m_direct = {};
+    m_bvh    = {};
+    m_quads  = nullptr;
+  }
+
+  /** returns true iff path holds a bake with this key and size. */
+  bool load(const std::string &path, uint64_t key) {
+    std::FILE *fp = std::fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+      return false;
+    }
+    Header header{};
+    bool   ok = std::fread(&header, sizeof(header), 1, fp) == 1 &&
+              std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              header.key == key && header.width == m_width && header.height == m_height &&
+              std::fread(m_texels.data(), sizeof(uint32_t), m_texels.size(), fp) ==
+                  m_texels.size();
+    std::fclose(fp);
+    return ok;
+  }
+
+  /** returns false (after reporting why) if path could not be written. */
+  bool save(const std::string &path, uint64_t key) const {
+    std::FILE *fp = std::fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+      std::cerr << "could not open " << path << " for writing: " << std::strerror(errno)
+                << std::endl;
+      return false;
+    }
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.key    = key;
+    header.width  = m_width;
+    header.height = m_height;
+    bool ok       = std::fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              std::fwrite(m_texels.data(), sizeof(uint32_t), m_texels.size(), fp) ==
+                  m_texels.size();
+    std::fclose(fp);
+    if (!ok) {
+      std::cerr << "could not write " << path << std::endl;
+    }
+    return ok;
+  }
+
+private:
+  static constexpr char  MAGIC[4] = { 'L', 'M', 'A', 'P' };
+  static constexpr float RAY_EPS  = 1e-3f;
+
+  struct Header {
+    char     magic[4];
+    uint32_t width;
+    uint32_t height;
+    uint32_t pad;
+    uint64_t key; // covers VERSION
+  };
+  static_assert(sizeof(Header) == 24);
+
+  LightmapSettings                 m_settings;
+  uint32_t                         m_nrQuads;
+  uint32_t                         m_chartsPerRow;
+  uint32_t                         m_width;
+  uint32_t                         m_height;
+  std::vector<uint32_t>            m_texels;
+  // only valid during bake
+  const std::vector<LightmapQuad> *m_quads = nullptr;
+  Bvh                              m_bvh;
+  std::vector<glm::vec3>           m_direct; // per chart texel, chart by chart
+
+  uint32_t   chartStride() const { return m_settings.chartSize + 2 * m_settings.padding; }
+  glm::uvec2 chartCorner(uint32_t quad) const {
+    return glm::uvec2(quad % m_chartsPerRow, quad / m_chartsPerRow) * chartStride();
+  }
+
+  // chart uv of texel t's center
+  glm::vec2 texelSt(uint32_t t) const {
+    uint32_t size = m_settings.chartSize;
+    return (glm::vec2(t % size, t / size) + glm::vec2(0.5f)) / (float)size;
+  }
+
+  bool intersectQuad(uint32_t q, const Ray &ray, float &t) const {
+    const LightmapQuad &quad = (*m_quads)[q];
+    glm::vec3           v0 = quad.origin, v1 = v0 + quad.edgeU, v3 = v0 + quad.edgeV;
+    glm::vec3           v2 = v1 + quad.edgeV;
+    return intersectTriangle(ray, v0, v1, v2, t) || intersectTriangle(ray, v0, v2, v3, t);
+  }
+
+  /** closest quad hit by ray within tMax, or UINT32_MAX. tMax becomes its distance. */
+  uint32_t trace(const Ray &ray, float &tMax) const {
+    uint32_t res = std::numeric_limits<uint32_t>::max();
+    m_bvh.raycast(ray, tMax, [&](uint32_t q, float &t) {
+      bool hit = intersectQuad(q, ray, t);
+      if (hit) {
+        res = q;
+      }
+      return hit;
+    });
+    return res;
+  }
+
+  bool occluded(const Ray &ray, float tMax) const {
+    return m_bvh.raycast(ray, tMax, [&](uint32_t q, float &t) {
+      if (!intersectQuad(q, ray, t)) {
+        return false;
+      }
+      t = 0.0f; // any hit will do -- ends the traversal
+      return true;
+    });
+  }
+
+  glm::vec3 directAt(const LightmapScene &scene, uint32_t q, uint32_t t) const {
+    const LightmapQuad &quad  = scene.quads[q];
+    glm::vec2           st    = texelSt(t);
+    glm::vec3           n     = quad.normal();
+    glm::vec3           p     = quad.origin + st.x * quad.edgeU + st.y * quad.edgeV;
+    glm::vec3           start = p + RAY_EPS * n;
+
+    glm::vec3 res(0.0f);
+    glm::vec3 toDir    = -glm::normalize(scene.dirLight.direction);
+    float     cosTheta = glm::dot(n, toDir);
+    float     tFar     = std::numeric_limits<float>::max();
+    if (cosTheta > 0.0f && !occluded(Ray(start, toDir), tFar)) {
+      res += cosTheta * scene.dirLight.color;
+    }
+
+    for (const auto &light : scene.spotLights) {
+      glm::vec3 toLight = light.pos - p;
+      float     d       = glm::length(toLight);
+      glm::vec3 l       = toLight / d;
+      float     cosSurf = glm::dot(n, l);
+      float     cone    = glm::smoothstep(light.cosOuter, light.cosInner,
+                                          glm::dot(-l, glm::normalize(light.direction)));
+      if (cosSurf <= 0.0f || cone <= 0.0f) {
+        continue;
+      }
+      const auto &att = light.attenuation;
+      float       f   = 1.0f / (att.k0 + att.k1 * d + att.k2 * d * d);
+      if (!occluded(Ray(start, light.pos - start), 1.0f)) {
+        res += cosSurf * cone * f * light.color;
+      }
+    }
+    return res;
+  }
+
+  glm::vec3 bounceAt(uint32_t q, uint32_t t) const {
+    const LightmapQuad &quad = (*m_quads)[q];
+    glm::vec2           st   = texelSt(t);
+    glm::vec3           n    = quad.normal();
+    glm::vec3 start = quad.origin + st.x * quad.edgeU + st.y * quad.edgeV + RAY_EPS * n;
+    glm::vec3 tu    = glm::normalize(quad.edgeU);
+    glm::vec3 tv    = glm::cross(n, tu);
+
+    uint32_t  size = m_settings.chartSize;
+    glm::vec3 sum(0.0f);
+    for (uint32_t k = 0; k < m_settings.nrBounceRays; ++k) {
+      // cosine-weighted, so the mean of albedo * irradiance is the bounced irradiance
+      float     u1 = whisky3f(q, t, 2 * k), u2 = whisky3f(q, t, 2 * k + 1);
+      float     r = std::sqrt(u1), phi = 2.0f * std::numbers::pi_v<float> * u2;
+      glm::vec3 dir = r * std::cos(phi) * tu + r * std::sin(phi) * tv +
+                      std::sqrt(std::max(0.0f, 1.0f - u1)) * n;
+
+      Ray      ray(start, dir);
+      float    tHit = std::numeric_limits<float>::max();
+      uint32_t hit  = trace(ray, tHit);
+      if (hit == std::numeric_limits<uint32_t>::max()) {
+        continue; // sky -- left to the ambient term
+      }
+      const LightmapQuad &other = (*m_quads)[hit];
+      if (glm::dot(dir, other.normal()) >= 0.0f) {
+        continue; // back face
+      }
+      glm::vec3 rel = ray.at(tHit) - other.origin;
+      float     s   = glm::dot(rel, other.edgeU) / glm::dot(other.edgeU, other.edgeU);
+      float     v   = glm::dot(rel, other.edgeV) / glm::dot(other.edgeV, other.edgeV);
+      uint32_t  x   = std::min(size - 1, (uint32_t)std::max(0.0f, s * size));
+      uint32_t  y   = std::min(size - 1, (uint32_t)std::max(0.0f, v * size));
+      sum += other.albedo * m_direct[hit * size * size + y * size + x];
+    }
+    return sum / (float)std::max(1u, m_settings.nrBounceRays);
+  }
+};
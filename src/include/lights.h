@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <limits>
+
+// CPU-side helpers for the light models used by the lighting shaders.
+
+// attenuation f_att(d) = 1 / (k_0 + k_1 d + k_2 d^2), as in the *.frag files
+struct Attenuation {
+  float k0 = 1.0f;
+  float k1 = 0.009f;
+  float k2 = 0.0032f;
+};
+
+/** distance beyond which f_att * intensity drops below threshold
+ * (eg: 1/256 of full brightness). infinite if it never does. */
+inline float attenuationRange(const Attenuation &att, float intensity = 1.0f,
+                              float threshold = 1.0f / 256.0f) {
+  // solve k_2 d^2 + k_1 d + (k_0 - intensity / threshold) = 0 for d >= 0
+  float c = att.k0 - intensity / threshold;
+  if (c >= 0.0f) {
+    return 0.0f; // never bright enough
+  }
+  if (att.k2 > 0.0f) {
+    return (-att.k1 + std::sqrt(att.k1 * att.k1 - 4.0f * att.k2 * c)) / (2.0f * att.k2);
+  }
+  if (att.k1 > 0.0f) {
+    return -c / att.k1;
+  }
+  return std::numeric_limits<float>::infinity();
+}
+
+// spot light as laid out in the std430 light buffers of the tiled/clustered shaders
+struct GpuSpotLight {
+  glm::vec4 vPosRange;         // xyz: view-space position, w: attenuation range
+  glm::vec4 directionCosOuter; // xyz: view-space direction, w: cos of outer cutoff
+  glm::vec4 colorCosInner;     // rgb: color, w: cos of inner cutoff
+};
+static_assert(sizeof(GpuSpotLight) == 3 * sizeof(glm::vec4));
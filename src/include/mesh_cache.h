@@ -0,0 +1,422 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "file.h"
+#include "mesh_optimize.h"
+#include "meshlets.h"
+#include "vertex_pack.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Models imported through assimp once, then cached as .lmesh files.
+//
+// A .lmesh holds what drawing needs and nothing else: interleaved vertices, 32-bit
+// indices, submesh ranges with their bounds, meshlets (see meshlets.h), and materials
+// naming their textures.
+// Each section is aligned so it can be handed to glBufferData straight out of the
+// mapped file -- loading a cached model maps it and validates a header, no parsing.
+// The header records the size and mtime of the imported file, so editing the model
+// (or bumping VERSION when the layout or import changes) re-imports it.
+//
+// Vertices are cached either as Vertex, or as PackedVertex (see vertex_pack.h) at
+// half the size, each submesh's positions quantized across its bounds.
+
+namespace lmesh {
+
+constexpr uint8_t  MAGIC[8]   = { 'L', 'M', 'E', 'S', 'H', 0, 0, 0 };
+constexpr uint32_t VERSION    = 4;
+constexpr size_t   ALIGNMENT  = 64;
+constexpr uint32_t NO_TEXTURE = UINT32_MAX;
+
+/** the layout of CubeVertex: attributes 0, 1 and 2 of the maps shaders. */
+struct Vertex {
+  glm::vec3 pos;
+  glm::vec2 tex;
+  glm::vec3 normal;
+};
+
+/** indices [firstIndex, firstIndex + nrIndices), relative to baseVertex, split into
+ * meshlets [firstMeshlet, firstMeshlet + nrMeshlets). */
+struct Submesh {
+  uint32_t  firstIndex;
+  uint32_t  nrIndices;
+  uint32_t  baseVertex;
+  uint32_t  material;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  uint32_t  firstMeshlet;
+  uint32_t  nrMeshlets;
+};
+
+/** textures are offsets into the string table, of paths relative to the repo root. */
+struct Material {
+  uint32_t diffuse  = NO_TEXTURE;
+  uint32_t specular = NO_TEXTURE;
+  float    shininess;
+  uint32_t pad = 0;
+};
+
+struct Header {
+  uint8_t   magic[8];
+  uint32_t  version;
+  uint32_t  vertexSize;
+  uint64_t  sourceSize;
+  int64_t   sourceMtime;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  uint32_t  nrVertices;
+  uint32_t  nrIndices;
+  uint32_t  nrSubmeshes;
+  uint32_t  nrMaterials;
+  uint32_t  stringsSize;
+  uint32_t  packed; // 1: vertices are PackedVertex
+  uint32_t  nrMeshlets;
+  uint32_t  pad;
+  uint64_t  vertices; // byte offsets of the sections
+  uint64_t  indices;
+  uint64_t  submeshes;
+  uint64_t  meshlets;
+  uint64_t  materials;
+  uint64_t  strings;
+};
+
+/** a model as imported, before it is cached. */
+struct Model {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  std::vector<Submesh>  submeshes;
+  std::vector<Meshlet>  meshlets;
+  std::vector<Material> materials;
+  std::string           strings; // nul-terminated texture paths
+  glm::vec3             boundsMin = glm::vec3(0.0f);
+  glm::vec3             boundsMax = glm::vec3(0.0f);
+};
+
+/** where the cache of a model (relative to the repo root) lives:
+ * assets/x.obj -> assets/baked/x.obj.lmesh, or x.obj.packed.lmesh */
+inline std::string cachePath(const std::string &path, bool packed = false) {
+  auto p    = std::filesystem::path(path);
+  auto name = p.filename().string() + (packed ? ".packed.lmesh" : ".lmesh");
+  return (p.parent_path() / "baked" / name).generic_string();
+}
+
+/** the model at path (relative to the repo root) through assimp, flattened into
+ * one vertex and index buffer with a submesh per assimp mesh. each submesh's triangles
+ * and vertices are reordered for the vertex cache, overdraw and vertex fetch. */
+inline Model import(const std::string &path) {
+  Assimp::Importer importer;
+  const aiScene   *scene = importer.ReadFile(
+      ROOT + path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                       aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices |
+                       aiProcess_SortByPType);
+  if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0) {
+    auto msg = "could not import " + path + ": " + importer.GetErrorString();
+    std::cerr << msg << std::endl;
+    throw std::runtime_error(msg);
+  }
+
+  Model model;
+  auto  dir = std::filesystem::path(path).parent_path();
+  for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
+    const aiMaterial *material = scene->mMaterials[i];
+    auto              texture  = [&](aiTextureType type) {
+      aiString name;
+      if (material->GetTexture(type, 0, &name) != aiReturn_SUCCESS) {
+        return NO_TEXTURE;
+      }
+      auto offset    = (uint32_t)model.strings.size();
+      model.strings += (dir / name.C_Str()).lexically_normal().generic_string();
+      model.strings += '\0';
+      return offset;
+    };
+    Material res{ .diffuse   = texture(aiTextureType_DIFFUSE),
+                  .specular  = texture(aiTextureType_SPECULAR),
+                  .shininess = 32.0f };
+    material->Get(AI_MATKEY_SHININESS, res.shininess);
+    model.materials.push_back(res);
+  }
+
+  VertexCacheStats before, after;
+  for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+    const aiMesh         *mesh = scene->mMeshes[m];
+    std::vector<Vertex>   vertices(mesh->mNumVertices);
+    std::vector<uint32_t> indices;
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+      Vertex &vertex = vertices[v];
+      vertex.pos     = { mesh->mVertices[v].x, mesh->mVertices[v].y,
+                         mesh->mVertices[v].z };
+      if (mesh->HasTextureCoords(0)) {
+        vertex.tex = { mesh->mTextureCoords[0][v].x, mesh->mTextureCoords[0][v].y };
+      }
+      if (mesh->HasNormals()) {
+        vertex.normal = { mesh->mNormals[v].x, mesh->mNormals[v].y, mesh->mNormals[v].z };
+      }
+    }
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+      const aiFace &face = mesh->mFaces[f];
+      if (face.mNumIndices == 3) { // points and lines were sorted into other meshes
+        indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+      }
+    }
+    if (indices.empty()) {
+      continue;
+    }
+
+    // see mesh_optimize.h
+    auto stats = vertexCacheStats(indices, vertices.size());
+    std::vector<glm::vec3> positions;
+    for (auto &vertex : vertices) {
+      positions.push_back(vertex.pos);
+    }
+    std::vector<uint32_t> clusters;
+    indices = tipsify(indices, vertices.size(), &clusters);
+    optimizeOverdraw(indices, positions, clusters);
+    auto meshlets = buildMeshlets(indices, positions);
+    optimizeVertexFetch(std::span(indices), vertices);
+    before.nrTransformed += stats.nrTransformed;
+    before.nrTriangles   += stats.nrTriangles;
+    before.nrVertices    += stats.nrVertices;
+    stats                 = vertexCacheStats(indices, vertices.size());
+    after.nrTransformed  += stats.nrTransformed;
+    after.nrTriangles    += stats.nrTriangles;
+    after.nrVertices     += stats.nrVertices;
+
+    Submesh submesh{
+      .firstIndex   = (uint32_t)model.indices.size(),
+      .nrIndices    = (uint32_t)indices.size(),
+      .baseVertex   = (uint32_t)model.vertices.size(),
+      .material     = mesh->mMaterialIndex,
+      .boundsMin    = glm::vec3(INFINITY),
+      .boundsMax    = glm::vec3(-INFINITY),
+      .firstMeshlet = (uint32_t)model.meshlets.size(),
+      .nrMeshlets   = (uint32_t)meshlets.size(),
+    };
+    for (auto &meshlet : meshlets) {
+      meshlet.firstIndex += submesh.firstIndex;
+      meshlet.baseVertex  = submesh.baseVertex;
+      meshlet.submesh     = model.submeshes.size();
+    }
+    model.meshlets.insert(model.meshlets.end(), meshlets.begin(), meshlets.end());
+    for (auto &vertex : vertices) {
+      submesh.boundsMin = glm::min(submesh.boundsMin, vertex.pos);
+      submesh.boundsMax = glm::max(submesh.boundsMax, vertex.pos);
+    }
+    model.vertices.insert(model.vertices.end(), vertices.begin(), vertices.end());
+    model.indices.insert(model.indices.end(), indices.begin(), indices.end());
+    if (model.submeshes.empty()) {
+      model.boundsMin = submesh.boundsMin;
+      model.boundsMax = submesh.boundsMax;
+    }
+    model.boundsMin = glm::min(model.boundsMin, submesh.boundsMin);
+    model.boundsMax = glm::max(model.boundsMax, submesh.boundsMax);
+    model.submeshes.push_back(submesh);
+  }
+  std::cout << path << ": ACMR " << before.acmr() << " -> " << after.acmr() << ", ATVR "
+            << before.atvr() << " -> " << after.atvr() << std::endl;
+  return model;
+}
+
+/** submesh's dequantization, when vertices are packed. */
+inline Dequantize dequantize(const Submesh &submesh) {
+  return ::dequantize(submesh.boundsMin, submesh.boundsMax);
+}
+
+inline std::vector<PackedVertex> pack(const Model &model) {
+  std::vector<PackedVertex> res(model.vertices.size());
+  for (size_t s = 0; s < model.submeshes.size(); ++s) {
+    const Submesh &submesh = model.submeshes[s];
+    auto           d       = dequantize(submesh);
+    uint32_t       end     = s + 1 < model.submeshes.size()
+                                 ? model.submeshes[s + 1].baseVertex
+                                 : model.vertices.size();
+    for (uint32_t v = submesh.baseVertex; v < end; ++v) {
+      const Vertex &vertex = model.vertices[v];
+      res[v]               = packVertex(vertex.pos, vertex.tex, vertex.normal, d);
+    }
+  }
+  return res;
+}
+
+inline void write(const std::string &path, const Model &model, uint64_t sourceSize,
+                  int64_t sourceMtime, bool packed = false) {
+  auto align = [](size_t n) { return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; };
+  auto bytes = [](const auto &v) { return v.size() * sizeof(v[0]); };
+
+  auto packedVertices = packed ? pack(model) : std::vector<PackedVertex>{};
+  auto vertexBytes    = packed ? bytes(packedVertices) : bytes(model.vertices);
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version     = VERSION;
+  header.vertexSize  = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+  header.sourceSize  = sourceSize;
+  header.sourceMtime = sourceMtime;
+  header.boundsMin   = model.boundsMin;
+  header.boundsMax   = model.boundsMax;
+  header.nrVertices  = model.vertices.size();
+  header.nrIndices   = model.indices.size();
+  header.nrSubmeshes = model.submeshes.size();
+  header.nrMaterials = model.materials.size();
+  header.stringsSize = model.strings.size();
+  header.packed      = packed;
+  header.nrMeshlets  = model.meshlets.size();
+  header.vertices    = align(sizeof(Header));
+  header.indices     = align(header.vertices + vertexBytes);
+  header.submeshes   = align(header.indices + bytes(model.indices));
+  header.meshlets    = align(header.submeshes + bytes(model.submeshes));
+  header.materials   = align(header.meshlets + bytes(model.meshlets));
+  header.strings     = align(header.materials + bytes(model.materials));
+
+  std::vector<char> out(header.strings + model.strings.size());
+  auto              put = [&](uint64_t offset, const auto &v) {
+    std::memcpy(out.data() + offset, v.data(), bytes(v));
+  };
+  std::memcpy(out.data(), &header, sizeof(header));
+  if (packed) {
+    put(header.vertices, packedVertices);
+  } else {
+    put(header.vertices, model.vertices);
+  }
+  put(header.indices, model.indices);
+  put(header.submeshes, model.submeshes);
+  put(header.meshlets, model.meshlets);
+  put(header.materials, model.materials);
+  put(header.strings, model.strings);
+
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+  std::ofstream file(path, std::ios::binary);
+  file.write(out.data(), out.size());
+  if (!file) {
+    throw std::runtime_error("could not write " + path);
+  }
+}
+
+/** a cached model, read in place from the mapped file (or asset pack). */
+class MappedModel {
+public:
+  /** the cache at path, if it is an intact cache of this version made from a source
+   * of this size and mtime, with packed vertices or not. */
+  static std::optional<MappedModel> open(const std::string &path, uint64_t sourceSize,
+                                         int64_t sourceMtime, bool packed = false) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+      return std::nullopt;
+    }
+    auto res = open(Asset(MappedFile(path, true)), packed);
+    if (res && (res->header().sourceSize != sourceSize ||
+                res->header().sourceMtime != sourceMtime)) {
+      return std::nullopt;
+    }
+    return res;
+  }
+
+  /** the cache in file, if it is an intact cache of this version, with packed vertices
+   * or not. */
+  static std::optional<MappedModel> open(Asset file, bool packed = false) {
+    MappedModel res(std::move(file));
+    auto        bytes = res.m_file.view();
+    if (bytes.size() < sizeof(Header)) {
+      return std::nullopt;
+    }
+    const Header &h = res.header();
+    auto          fits = [&](uint64_t offset, uint64_t count, size_t size) {
+      return offset % ALIGNMENT == 0 && offset + count * size <= bytes.size();
+    };
+    auto vertexSize = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    bool ok = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+              h.packed == packed && h.vertexSize == vertexSize &&
+              fits(h.vertices, h.nrVertices, vertexSize) &&
+              fits(h.indices, h.nrIndices, sizeof(uint32_t)) &&
+              fits(h.submeshes, h.nrSubmeshes, sizeof(Submesh)) &&
+              fits(h.meshlets, h.nrMeshlets, sizeof(Meshlet)) &&
+              fits(h.materials, h.nrMaterials, sizeof(Material)) &&
+              fits(h.strings, h.stringsSize, 1);
+    if (!ok) {
+      return std::nullopt;
+    }
+    return res;
+  }
+
+  const Header &header() const { return *(const Header *)m_file.data(); }
+
+  bool packed() const { return header().packed != 0; }
+  /** the vertices, when not packed(). */
+  std::span<const Vertex> vertices() const {
+    return section<Vertex>(header().vertices, packed() ? 0 : header().nrVertices);
+  }
+  /** the vertices, when packed(). */
+  std::span<const PackedVertex> packedVertices() const {
+    return section<PackedVertex>(header().vertices, packed() ? header().nrVertices : 0);
+  }
+  std::span<const uint32_t> indices() const {
+    return section<uint32_t>(header().indices, header().nrIndices);
+  }
+  std::span<const Submesh> submeshes() const {
+    return section<Submesh>(header().submeshes, header().nrSubmeshes);
+  }
+  std::span<const Meshlet> meshlets() const {
+    return section<Meshlet>(header().meshlets, header().nrMeshlets);
+  }
+  std::span<const Material> materials() const {
+    return section<Material>(header().materials, header().nrMaterials);
+  }
+  /** the texture path at offset in the string table, or empty for NO_TEXTURE. */
+  std::string_view string(uint32_t offset) const {
+    if (offset >= header().stringsSize) {
+      return {};
+    }
+    return m_file.data() + header().strings + offset; // nul-terminated
+  }
+  /** whether it came from the asset pack. */
+  bool packedAsset() const { return m_file.packed(); }
+
+private:
+  Asset m_file;
+
+  explicit MappedModel(Asset file) : m_file(std::move(file)) {}
+
+  template <class T> std::span<const T> section(uint64_t offset, uint32_t count) const {
+    return { (const T *)(m_file.data() + offset), count };
+  }
+};
+
+/** the model at path (relative to the repo root) from its cache, importing it and
+ * writing the cache first if there is no valid one. */
+inline MappedModel load(const std::string &path, bool packed = false) {
+  // a packed cache was packed with its model, so it is as new
+  if (const AssetPack *pack = assetPack();
+      pack != nullptr && pack->contains(cachePath(path, packed))) {
+    if (auto model = MappedModel::open(Asset(cachePath(path, packed), true), packed)) {
+      return std::move(*model);
+    }
+  }
+  auto source = ROOT + path;
+  auto cache  = ROOT + cachePath(path, packed);
+  auto size   = std::filesystem::file_size(source);
+  auto mtime  = std::filesystem::last_write_time(source).time_since_epoch().count();
+  if (auto model = MappedModel::open(cache, size, mtime, packed)) {
+    return std::move(*model);
+  }
+  write(cache, import(path), size, mtime, packed);
+  if (auto model = MappedModel::open(cache, size, mtime, packed)) {
+    return std::move(*model);
+  }
+  throw std::runtime_error("could not read back " + cache);
+}
+
+} // namespace lmesh
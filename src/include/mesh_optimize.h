@@ -0,0 +1,257 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Index and vertex reordering for triangle lists, after Sander, Nehab & Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007):
+//
+// 1. tipsify: reorder triangles so vertices are reused while still in the
+//    post-transform cache, fanning around the most recently used vertices.
+// 2. optimizeOverdraw: cut that order into clusters that each keep a good cache hit
+//    rate, then draw clusters facing out from the mesh's center first, so they tend
+//    to occlude the rest.
+// 3. optimizeVertexFetch: renumber vertices in order of first use, so vertex fetches
+//    walk the vertex buffer forwards.
+//
+// Cache efficiency is measured against a FIFO cache of CACHE_SIZE vertices, as:
+// ACMR, transformed vertices per triangle (0.5 at best on large regular meshes, 3 at
+// worst), and ATVR, transformed vertices per vertex (1 at best).
+
+constexpr uint32_t CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+  uint32_t nrTransformed = 0;
+  uint32_t nrTriangles   = 0;
+  uint32_t nrVertices    = 0;
+
+  float acmr() const { return (float)nrTransformed / std::max(nrTriangles, 1u); }
+  float atvr() const { return (float)nrTransformed / std::max(nrVertices, 1u); }
+};
+
+inline VertexCacheStats vertexCacheStats(std::span<const uint32_t> indices,
+                                         uint32_t nrVertices) {
+  std::vector<uint32_t> cachedAt(nrVertices, 0); // starting time - 0: never cached
+  uint32_t              time = CACHE_SIZE + 1;
+  VertexCacheStats      res{ .nrTriangles = (uint32_t)indices.size() / 3,
+                             .nrVertices  = nrVertices };
+  for (uint32_t v : indices) {
+    if (time - cachedAt[v] > CACHE_SIZE) {
+      cachedAt[v] = time++;
+      res.nrTransformed++;
+    }
+  }
+  return res;
+}
+
+/** indices reordered for the vertex cache. the first triangle of every run that
+ * started after a dead end (no live triangle around a cached vertex) is appended to
+ * clusters, if given. */
+inline std::vector<uint32_t> tipsify(std::span<const uint32_t> indices,
+                                     uint32_t                  nrVertices,
+                                     std::vector<uint32_t>    *clusters = nullptr) {
+  uint32_t nrTriangles = indices.size() / 3;
+
+  // triangles around each vertex
+  std::vector<uint32_t> offsets(nrVertices + 1, 0);
+  for (uint32_t v : indices) {
+    offsets[v + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> live(nrVertices, 0); // triangles not yet emitted
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    adjacency[offsets[indices[i]] + live[indices[i]]++] = i / 3;
+  }
+
+  std::vector<uint32_t> res;
+  res.reserve(indices.size());
+  std::vector<uint32_t> cachedAt(nrVertices, 0);
+  std::vector<bool>     emitted(nrTriangles, false);
+  std::vector<uint32_t> deadEnds; // recently used vertices, most recent last
+  std::vector<uint32_t> candidates;
+  uint32_t              time    = CACHE_SIZE + 1;
+  uint32_t              cursor  = 0; // vertices before it have no live triangles
+  int64_t               fanning = nrVertices > 0 ? 0 : -1;
+  bool                  jumped  = true;
+
+  while (fanning >= 0) {
+    if (jumped && clusters != nullptr) {
+      clusters->push_back(res.size() / 3);
+    }
+    candidates.clear();
+    for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+      uint32_t t = adjacency[a];
+      if (emitted[t]) {
+        continue;
+      }
+      for (uint32_t v : indices.subspan(3 * t, 3)) {
+        res.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cachedAt[v] > CACHE_SIZE) {
+          cachedAt[v] = time++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // next: the candidate that stays cached the longest yet, whose remaining
+    // triangles would not push it out of the cache
+    fanning          = -1;
+    int64_t priority = -1;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      uint32_t age = time - cachedAt[v];
+      int64_t  p   = age + 2 * live[v] <= CACHE_SIZE ? age : 0;
+      if (p > priority) {
+        priority = p;
+        fanning  = v;
+      }
+    }
+    jumped = fanning < 0;
+    while (fanning < 0 && !deadEnds.empty()) {
+      uint32_t v = deadEnds.back();
+      deadEnds.pop_back();
+      fanning = live[v] > 0 ? (int64_t)v : -1;
+    }
+    while (fanning < 0 && cursor < nrVertices) {
+      fanning = live[cursor] > 0 ? (int64_t)cursor : -1;
+      cursor++;
+    }
+  }
+  return res;
+}
+
+/** reorders the clusters of the triangles in indices outside in: by how far each
+ * faces away from the mesh's center, so the first drawn tend to occlude the rest.
+ * starts: the first triangle of each cluster, then the number of triangles. returns
+ * the clusters in their new order. */
+inline std::vector<uint32_t> sortOutsideIn(std::span<uint32_t>        indices,
+                                           std::span<const glm::vec3> positions,
+                                           std::span<const uint32_t>  starts) {
+  // area weighted center and normal of each cluster, and of the mesh
+  struct Cluster {
+    uint32_t  begin;
+    uint32_t  end;
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+    float     area   = 0.0f;
+    float     sortKey;
+  };
+  std::vector<Cluster> clusters;
+  glm::vec3            meshCenter(0.0f);
+  float                meshArea = 0.0f;
+  for (size_t c = 0; c + 1 < starts.size(); ++c) {
+    Cluster cluster{ .begin = starts[c], .end = starts[c + 1] };
+    for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+      glm::vec3 p0    = positions[indices[3 * t]];
+      glm::vec3 p1    = positions[indices[3 * t + 1]];
+      glm::vec3 p2    = positions[indices[3 * t + 2]];
+      glm::vec3 n     = glm::cross(p1 - p0, p2 - p0); // twice the area
+      float     area  = glm::length(n);
+      cluster.center += area * (p0 + p1 + p2) / 3.0f;
+      cluster.normal += n;
+      cluster.area   += area;
+    }
+    meshCenter += cluster.center;
+    meshArea   += cluster.area;
+    clusters.push_back(cluster);
+  }
+  meshCenter /= std::max(meshArea, 1e-20f);
+  for (auto &cluster : clusters) {
+    cluster.center  /= std::max(cluster.area, 1e-20f);
+    cluster.sortKey  = glm::dot(cluster.center - meshCenter, cluster.normal);
+  }
+  std::vector<uint32_t> res(clusters.size());
+  std::iota(res.begin(), res.end(), 0);
+  std::ranges::stable_sort(res, std::greater{},
+                           [&](uint32_t c) { return clusters[c].sortKey; });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (uint32_t c : res) {
+    sorted.insert(sorted.end(), indices.begin() + 3 * clusters[c].begin,
+                  indices.begin() + 3 * clusters[c].end);
+  }
+  std::ranges::copy(sorted, indices.begin());
+  return res;
+}
+
+/** reorders the clusters of the triangles in indices outside in. clusters (the first
+ * triangle of each, as tipsify gives them) are split further wherever the triangles
+ * so far keep the cache hit rate within threshold of the whole cluster's. */
+inline void optimizeOverdraw(std::span<uint32_t>        indices,
+                             std::span<const glm::vec3> positions,
+                             std::span<const uint32_t>  clusters,
+                             float                      threshold = 1.05f) {
+  uint32_t nrTriangles = indices.size() / 3;
+
+  // a FIFO cache simulated across calls, emptied by flush()
+  std::vector<uint32_t> cachedAt(positions.size(), 0);
+  uint32_t              time   = CACHE_SIZE + 1;
+  auto                  misses = [&](uint32_t t) {
+    uint32_t res = 0;
+    for (uint32_t v : indices.subspan(3 * t, 3)) {
+      if (time - cachedAt[v] > CACHE_SIZE) {
+        cachedAt[v] = time++;
+        res++;
+      }
+    }
+    return res;
+  };
+  auto flush = [&] { time += CACHE_SIZE + 1; };
+
+  std::vector<uint32_t> starts;
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    uint32_t begin = clusters[c];
+    uint32_t end   = c + 1 < clusters.size() ? clusters[c + 1] : nrTriangles;
+    uint32_t total = 0;
+    flush();
+    for (uint32_t t = begin; t < end; ++t) {
+      total += misses(t);
+    }
+    float acmr = (float)total / (end - begin);
+
+    flush();
+    starts.push_back(begin);
+    uint32_t sofar = 0;
+    for (uint32_t t = begin; t + 1 < end; ++t) {
+      sofar      += misses(t);
+      uint32_t n  = t + 1 - starts.back();
+      // n >= 8: the first triangles after a cut always miss -- give clusters a few
+      if (n >= 8 && sofar <= acmr * threshold * n) {
+        starts.push_back(t + 1);
+        flush();
+        sofar = 0;
+      }
+    }
+  }
+  starts.push_back(nrTriangles);
+  sortOutsideIn(indices, positions, starts);
+}
+
+/** renumbers vertices in order of first use by indices, dropping unused vertices. */
+template <class Vertex>
+void optimizeVertexFetch(std::span<uint32_t> indices, std::vector<Vertex> &vertices) {
+  std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+  std::vector<Vertex>   res;
+  res.reserve(vertices.size());
+  for (uint32_t &v : indices) {
+    if (remap[v] == UINT32_MAX) {
+      remap[v] = res.size();
+      res.push_back(vertices[v]);
+    }
+    v = remap[v];
+  }
+  vertices = std::move(res);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Meshlets: small clusters of at most MESHLET_MAX_VERTICES vertices and
+// MESHLET_MAX_TRIANGLES triangles, each a contiguous range of the index buffer, so a
+// culled mesh draws as a list of index ranges (see 3.3.2.meshlet_cull.comp).
+//
+// Each meshlet carries the bounds its culling needs:
+// - a bounding sphere, for the frustum and for occlusion
+// - a normal cone: the average facing of its triangles and how far they spread from
+//   it. when the camera sees all of them from behind, the meshlet is backfacing
+//   (coneCutoff is 1 when they spread too far for that to happen)
+//
+// The limits are the sizes commonly used for mesh shaders.
+
+constexpr uint32_t MESHLET_MAX_VERTICES  = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/** std430 layout, see 3.3.2.meshlet_cull.comp. */
+struct Meshlet {
+  uint32_t  firstIndex;
+  uint32_t  nrIndices;
+  uint32_t  baseVertex;
+  uint32_t  submesh;
+  glm::vec3 center;
+  float     radius;
+  glm::vec3 coneAxis;
+  float     coneCutoff; // sin of the cone's half angle
+};
+
+/** bounding sphere and normal cone of the triangles in indices. */
+inline void meshletBounds(Meshlet &meshlet, std::span<const uint32_t> indices,
+                          std::span<const glm::vec3> positions) {
+  glm::vec3 lo(INFINITY), hi(-INFINITY);
+  for (uint32_t v : indices) {
+    lo = glm::min(lo, positions[v]);
+    hi = glm::max(hi, positions[v]);
+  }
+  meshlet.center = 0.5f * (lo + hi);
+  meshlet.radius = 0.0f;
+  for (uint32_t v : indices) {
+    float d        = glm::distance(meshlet.center, positions[v]);
+    meshlet.radius = std::max(meshlet.radius, d);
+  }
+
+  std::vector<glm::vec3> normals;
+  glm::vec3              axis(0.0f);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    glm::vec3 p0 = positions[indices[i]];
+    glm::vec3 p1 = positions[indices[i + 1]];
+    glm::vec3 p2 = positions[indices[i + 2]];
+    glm::vec3 n  = glm::cross(p1 - p0, p2 - p0);
+    if (glm::dot(n, n) > 0.0f) {
+      normals.push_back(glm::normalize(n));
+      axis += normals.back();
+    }
+  }
+  meshlet.coneAxis   = glm::vec3(0.0f, 0.0f, 1.0f);
+  meshlet.coneCutoff = 1.0f; // never backfacing
+  if (glm::dot(axis, axis) == 0.0f) {
+    return;
+  }
+  meshlet.coneAxis = glm::normalize(axis);
+  float minDot     = 1.0f;
+  for (auto n : normals) {
+    minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+  }
+  if (minDot > 0.0f) {
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+  }
+}
+
+/** reorders the triangles in indices into meshlets and returns them, with firstIndex
+ * and nrIndices into indices (baseVertex and submesh are left 0).
+ *
+ * meshlets grow greedily from the first triangle not yet in one: next comes the
+ * triangle sharing vertices with the meshlet that adds the fewest new vertices, or
+ * the next triangle in the current order when none do, so a well ordered mesh (see
+ * mesh_optimize.h) keeps its locality. meshlets are then sorted outside in, as
+ * optimizeOverdraw sorts its clusters, so indices keep its overdraw order too. */
+inline std::vector<Meshlet> buildMeshlets(std::span<uint32_t>        indices,
+                                          std::span<const glm::vec3> positions) {
+  uint32_t nrTriangles = indices.size() / 3;
+  uint32_t nrVertices  = positions.size();
+
+  // triangles around each vertex
+  std::vector<uint32_t> offsets(nrVertices + 1, 0);
+  for (uint32_t v : indices) {
+    offsets[v + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> filled(nrVertices, 0);
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    adjacency[offsets[indices[i]] + filled[indices[i]]++] = i / 3;
+  }
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  std::vector<bool>     emitted(nrTriangles, false);
+  std::vector<uint32_t> meshletOf(nrVertices, UINT32_MAX); // last meshlet using it
+  std::vector<uint32_t> candidates;
+  std::vector<Meshlet>  res;
+  uint32_t              cursor       = 0; // triangles before it are emitted
+  uint32_t              meshletVerts = 0;
+  uint32_t              meshletTris  = 0;
+  auto                  newVertices  = [&](uint32_t t) {
+    uint32_t n = 0;
+    for (uint32_t v : indices.subspan(3 * t, 3)) {
+      n += meshletOf[v] != res.size();
+    }
+    return n;
+  };
+  auto finish = [&] {
+    uint32_t first = res.empty() ? 0 : res.back().firstIndex + res.back().nrIndices;
+    res.push_back({ .firstIndex = first, .nrIndices = (uint32_t)sorted.size() - first });
+    meshletVerts = 0;
+    meshletTris  = 0;
+    candidates.clear();
+  };
+
+  while (sorted.size() < indices.size()) {
+    int64_t  best    = -1;
+    uint32_t bestNew = 4;
+    for (size_t i = 0; i < candidates.size();) {
+      uint32_t t = candidates[i];
+      if (emitted[t]) {
+        candidates[i] = candidates.back();
+        candidates.pop_back();
+        continue;
+      }
+      uint32_t n = newVertices(t);
+      if (n < bestNew) {
+        best    = t;
+        bestNew = n;
+      }
+      ++i;
+    }
+    if (best < 0) {
+      while (emitted[cursor]) {
+        cursor++;
+      }
+      best    = cursor;
+      bestNew = newVertices(cursor);
+    }
+    if (meshletVerts + bestNew > MESHLET_MAX_VERTICES ||
+        meshletTris == MESHLET_MAX_TRIANGLES) {
+      finish();
+    }
+
+    for (uint32_t v : indices.subspan(3 * best, 3)) {
+      sorted.push_back(v);
+      if (meshletOf[v] == res.size()) {
+        continue;
+      }
+      meshletOf[v] = res.size();
+      meshletVerts++;
+      for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+        if (!emitted[adjacency[a]]) {
+          candidates.push_back(adjacency[a]);
+        }
+      }
+    }
+    emitted[best] = true;
+    meshletTris++;
+  }
+  if (meshletTris > 0) {
+    finish();
+  }
+
+  std::ranges::copy(sorted, indices.begin());
+
+  // meshlets drawn outside in, as optimizeOverdraw drew its clusters
+  std::vector<uint32_t> starts;
+  for (auto &meshlet : res) {
+    starts.push_back(meshlet.firstIndex / 3);
+  }
+  starts.push_back(nrTriangles);
+  auto                 order    = sortOutsideIn(indices, positions, starts);
+  std::vector<Meshlet> unsorted = std::move(res);
+  res.clear();
+  for (uint32_t m : order) {
+    uint32_t first = res.empty() ? 0 : res.back().firstIndex + res.back().nrIndices;
+    res.push_back({ .firstIndex = first, .nrIndices = unsorted[m].nrIndices });
+  }
+  for (auto &meshlet : res) {
+    meshletBounds(meshlet, indices.subspan(meshlet.firstIndex, meshlet.nrIndices),
+                  positions);
+  }
+  return res;
+}
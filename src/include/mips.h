@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Mip levels computed on the CPU, for the bake tools.
+
+inline float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+inline float linearToSrgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+struct Level {
+  uint32_t                 width;
+  uint32_t                 height;
+  std::vector<glm::u8vec4> texels;
+};
+
+/** the level below src: half the size (rounded down), each texel the area weighted
+ * average of the texels of src it covers. */
+inline Level downsample(const Level &src, bool linear, ThreadPool &pool) {
+  static const auto toLinear = [] {
+    std::array<float, 256> res;
+    for (int i = 0; i < 256; ++i) {
+      res[i] = srgbToLinear(i / 255.0f);
+    }
+    return res;
+  }();
+
+  Level dst{ std::max(1u, src.width / 2), std::max(1u, src.height / 2), {} };
+  dst.texels.resize((size_t)dst.width * dst.height);
+  float sx = (float)src.width / dst.width;
+  float sy = (float)src.height / dst.height;
+
+  pool.parallelFor(dst.height, [&](uint32_t y) {
+    float    y0   = y * sy, y1 = (y + 1) * sy;
+    uint32_t jEnd = std::min(src.height, (uint32_t)std::ceil(y1));
+    for (uint32_t x = 0; x < dst.width; ++x) {
+      float     x0   = x * sx, x1 = (x + 1) * sx;
+      uint32_t  iEnd = std::min(src.width, (uint32_t)std::ceil(x1));
+      glm::vec3 color(0.0f);
+      float     alpha = 0.0f, weight = 0.0f;
+      for (auto j = (uint32_t)y0; j < jEnd; ++j) {
+        float wy = std::min(y1, j + 1.0f) - std::max(y0, (float)j);
+        for (auto i = (uint32_t)x0; i < iEnd; ++i) {
+          float wx = std::min(x1, i + 1.0f) - std::max(x0, (float)i);
+          auto  t  = src.texels[(size_t)j * src.width + i];
+          auto  c  = linear ? glm::vec3(t) / 255.0f
+                            : glm::vec3(toLinear[t.r], toLinear[t.g], toLinear[t.b]);
+          float a  = t.a / 255.0f;
+          color   += c * a * wx * wy;
+          alpha   += a * wx * wy;
+          weight  += wx * wy;
+        }
+      }
+      color = alpha > 0.0f ? color / alpha : glm::vec3(0.0f);
+      if (!linear) {
+        color = { linearToSrgb(color.r), linearToSrgb(color.g), linearToSrgb(color.b) };
+      }
+      auto texel = glm::round(glm::clamp(glm::vec4(color, alpha / weight), 0.0f, 1.0f) *
+                              255.0f);
+      dst.texels[(size_t)y * dst.width + x] = glm::u8vec4(texel);
+    }
+  });
+  return dst;
+}
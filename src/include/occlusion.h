@@ -0,0 +1,260 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Software occlusion culling.
+// Occluder triangles are rasterized on the CPU into a small depth buffer stored
+// as 8x4 pixel tiles (one AVX2 register per tile row), with a per-tile farthest
+// depth on top as the coarse level of the hierarchy. Occludee boxes are then
+// tested against the coarse level, so culling decisions need no GPU readback.
+// Depth is window-space z in [0, 1], 1 being the far plane.
+
+class OcclusionBuffer {
+public:
+  static constexpr int   TILE_W      = 8;
+  static constexpr int   TILE_H      = 4;
+  static constexpr int   TILE_PIXELS = TILE_W * TILE_H;
+  static constexpr int   BAND_TILES  = 4; // tile rows rasterized per job
+  static constexpr float NEAR_W      = 1e-4f;
+
+  OcclusionBuffer(int width, int height)
+      : m_tilesX((width + TILE_W - 1) / TILE_W), m_tilesY((height + TILE_H - 1) / TILE_H),
+        m_depth(m_tilesX * m_tilesY * TILE_PIXELS), m_tileMax(m_tilesX * m_tilesY) {}
+
+  int width() const { return m_tilesX * TILE_W; }
+  int height() const { return m_tilesY * TILE_H; }
+
+  /** starts a new frame: forgets occluders and resets depth to the far plane. */
+  void begin(const glm::mat4 &viewProjection) {
+    m_viewProjection = viewProjection;
+    m_tris.clear();
+    std::ranges::fill(m_depth, 1.0f);
+    std::ranges::fill(m_tileMax, 1.0f);
+  }
+
+  /** queues an indexed triangle mesh as occluder. */
+  void addOccluder(std::span<const glm::vec3> positions,
+                   std::span<const uint32_t> indices, const glm::mat4 &model) {
+    glm::mat4              mvp = m_viewProjection * model;
+    std::vector<glm::vec4> clip(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      clip[i] = mvp * glm::vec4(positions[i], 1.0f);
+    }
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      addClipTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+    }
+  }
+
+  /** rasterizes all queued occluders, one band of tile rows per job. */
+  void rasterize(ThreadPool &pool) {
+    uint32_t nrBands = (m_tilesY + BAND_TILES - 1) / BAND_TILES;
+    pool.parallelFor(nrBands, [this](uint32_t band) { rasterizeBand(band); });
+  }
+
+  /** conservative: false only if the world-space box is fully hidden by occluders
+   * (or fully off-screen). */
+  bool isVisible(const Aabb &box) const {
+    glm::vec2 lo(std::numeric_limits<float>::max());
+    glm::vec2 hi(-std::numeric_limits<float>::max());
+    float     minZ = 1.0f;
+    for (int c = 0; c < 8; ++c) {
+      glm::vec3 corner((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y,
+                       (c & 4) ? box.max.z : box.min.z);
+      glm::vec4 p = m_viewProjection * glm::vec4(corner, 1.0f);
+      if (p.w < NEAR_W || p.z < -p.w) {
+        return true; // straddles the near plane
+      }
+      glm::vec3 s = toScreen(p);
+      lo          = glm::min(lo, glm::vec2(s));
+      hi          = glm::max(hi, glm::vec2(s));
+      minZ        = std::min(minZ, s.z);
+    }
+    if (hi.x < 0.0f || hi.y < 0.0f || lo.x >= width() || lo.y >= height()) {
+      return false;
+    }
+    int tx0 = tileX(lo.x), tx1 = tileX(hi.x);
+    int ty0 = tileY(lo.y), ty1 = tileY(hi.y);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        if (minZ <= m_tileMax[ty * m_tilesX + tx]) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /** depth at pixel (x, y), (0, 0) being the bottom-left corner -- for debugging. */
+  float depth(int x, int y) const {
+    int tile = (y / TILE_H) * m_tilesX + x / TILE_W;
+    return m_depth[tile * TILE_PIXELS + (y % TILE_H) * TILE_W + x % TILE_W];
+  }
+
+private:
+  using Edges = std::array<float, 3>; // one coefficient per edge function
+
+  struct ScreenTri {
+    std::array<glm::vec3, 3> v; // pixels, pixels, depth
+  };
+
+  int                    m_tilesX;
+  int                    m_tilesY;
+  std::vector<float>     m_depth;   // tile-major, row-major within a tile
+  std::vector<float>     m_tileMax; // farthest depth per tile
+  glm::mat4              m_viewProjection{ 1.0f };
+  std::vector<ScreenTri> m_tris;
+
+  // tile containing pixel coordinate, clamped to the buffer
+  int tileX(float x) const { return std::clamp((int)(x / TILE_W), 0, m_tilesX - 1); }
+  int tileY(float y) const { return std::clamp((int)(y / TILE_H), 0, m_tilesY - 1); }
+
+  glm::vec3 toScreen(const glm::vec4 &clip) const {
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * width(), (ndc.y * 0.5f + 0.5f) * height(),
+                     ndc.z * 0.5f + 0.5f);
+  }
+
+  // clips against the near plane (z >= -w), then fans into screen triangles
+  void addClipTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c) {
+    std::array<glm::vec4, 3> in{ a, b, c };
+    std::array<glm::vec4, 4> out;
+    int                      n = 0;
+    for (int i = 0; i < 3; ++i) {
+      const glm::vec4 &p  = in[i];
+      const glm::vec4 &q  = in[(i + 1) % 3];
+      float            dp = p.z + p.w;
+      float            dq = q.z + q.w;
+      if (dp >= 0.0f) {
+        out[n++] = p;
+      }
+      if ((dp >= 0.0f) != (dq >= 0.0f)) {
+        out[n++] = p + (q - p) * (dp / (dp - dq));
+      }
+    }
+    if (n < 3) {
+      return;
+    }
+    std::array<glm::vec3, 4> s;
+    for (int i = 0; i < n; ++i) {
+      if (out[i].w < NEAR_W) {
+        return;
+      }
+      s[i] = toScreen(out[i]);
+    }
+    for (int i = 1; i + 1 < n; ++i) {
+      m_tris.push_back({ { s[0], s[i], s[i + 1] } });
+    }
+  }
+
+  void rasterizeBand(uint32_t band) {
+    int ty0 = band * BAND_TILES;
+    int ty1 = std::min(m_tilesY, ty0 + BAND_TILES);
+    for (const auto &tri : m_tris) {
+      rasterizeTriangle(tri, ty0, ty1);
+    }
+    for (int tile = ty0 * m_tilesX; tile < ty1 * m_tilesX; ++tile) {
+      const float *d = &m_depth[tile * TILE_PIXELS];
+      m_tileMax[tile] = *std::max_element(d, d + TILE_PIXELS);
+    }
+  }
+
+  void rasterizeTriangle(const ScreenTri &tri, int ty0, int ty1) {
+    const glm::vec3 &v0 = tri.v[0], &v1 = tri.v[1], &v2 = tri.v[2];
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) < 1e-6f) {
+      return;
+    }
+    float sign = area > 0.0f ? 1.0f : -1.0f; // rasterize both windings
+
+    // edge functions e_i(x, y) = a_i x + b_i y + c_i, >= 0 inside
+    Edges ea, eb, ec;
+    auto  edge = [&](int i, const glm::vec3 &p, const glm::vec3 &q) {
+      ea[i] = sign * (p.y - q.y);
+      eb[i] = sign * (q.x - p.x);
+      ec[i] = sign * (p.x * q.y - p.y * q.x);
+    };
+    edge(0, v1, v2);
+    edge(1, v2, v0);
+    edge(2, v0, v1);
+
+    // depth plane z(x, y) = za x + zb y + zc
+    float     invArea = 1.0f / (sign * area);
+    glm::vec3 zs(v0.z, v1.z, v2.z);
+    float     dza = glm::dot(glm::vec3(ea[0], ea[1], ea[2]), zs) * invArea;
+    float     dzb = glm::dot(glm::vec3(eb[0], eb[1], eb[2]), zs) * invArea;
+    float     dzc = glm::dot(glm::vec3(ec[0], ec[1], ec[2]), zs) * invArea;
+
+    float minX = std::min({ v0.x, v1.x, v2.x }), maxX = std::max({ v0.x, v1.x, v2.x });
+    float minY = std::min({ v0.y, v1.y, v2.y }), maxY = std::max({ v0.y, v1.y, v2.y });
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width() || minY >= height()) {
+      return;
+    }
+    int tx0 = tileX(minX), tx1 = tileX(maxX);
+    ty0     = std::max(ty0, tileY(minY));
+    ty1     = std::min(ty1 - 1, tileY(maxY));
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        float *d = &m_depth[(ty * m_tilesX + tx) * TILE_PIXELS];
+        rasterizeTile(d, tx * TILE_W, ty * TILE_H, ea, eb, ec, dza, dzb, dzc);
+      }
+    }
+  }
+
+#if defined(__AVX2__)
+  static void rasterizeTile(float *d, int x0, int y0, const Edges &ea, const Edges &eb,
+                            const Edges &ec, float dza, float dzb, float dzc) {
+    __m256 xs =
+        _mm256_add_ps(_mm256_set1_ps(x0 + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 e0x = _mm256_mul_ps(_mm256_set1_ps(ea[0]), xs);
+    __m256 e1x = _mm256_mul_ps(_mm256_set1_ps(ea[1]), xs);
+    __m256 e2x = _mm256_mul_ps(_mm256_set1_ps(ea[2]), xs);
+    __m256 zx  = _mm256_mul_ps(_mm256_set1_ps(dza), xs);
+    __m256 zero = _mm256_setzero_ps();
+    for (int r = 0; r < TILE_H; ++r) {
+      float  y    = y0 + r + 0.5f;
+      __m256 e0   = _mm256_add_ps(e0x, _mm256_set1_ps(eb[0] * y + ec[0]));
+      __m256 e1   = _mm256_add_ps(e1x, _mm256_set1_ps(eb[1] * y + ec[1]));
+      __m256 e2   = _mm256_add_ps(e2x, _mm256_set1_ps(eb[2] * y + ec[2]));
+      __m256 in   = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                                                _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                  _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+      __m256 z    = _mm256_add_ps(zx, _mm256_set1_ps(dzb * y + dzc));
+      __m256 cur  = _mm256_loadu_ps(d + r * TILE_W);
+      __m256 next = _mm256_blendv_ps(cur, _mm256_min_ps(cur, z), in);
+      _mm256_storeu_ps(d + r * TILE_W, next);
+    }
+  }
+#else
+  static void rasterizeTile(float *d, int x0, int y0, const Edges &ea, const Edges &eb,
+                            const Edges &ec, float dza, float dzb, float dzc) {
+    for (int r = 0; r < TILE_H; ++r) {
+      float y = y0 + r + 0.5f;
+      for (int c = 0; c < TILE_W; ++c) {
+        float x  = x0 + c + 0.5f;
+        bool  in = ea[0] * x + eb[0] * y + ec[0] >= 0.0f &&
+                  ea[1] * x + eb[1] * y + ec[1] >= 0.0f &&
+                  ea[2] * x + eb[2] * y + ec[2] >= 0.0f;
+        if (in) {
+          float &cur = d[r * TILE_W + c];
+          cur        = std::min(cur, dza * x + dzb * y + dzc);
+        }
+      }
+    }
+  }
+#endif
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Ray picking against a set of instanced meshes.
+// A BVH over the world-space bounds of each object narrows the ray down to a
+// handful of candidates, which are then tested triangle-exactly in object space.
+
+struct PickMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t>  indices; // triangle list
+  Aabb                   bounds;
+
+  PickMesh() = default;
+  template <class Vertex>
+  PickMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices_)
+      : indices(indices_.begin(), indices_.end()) {
+    positions.reserve(vertices.size());
+    for (const auto &v : vertices) {
+      positions.emplace_back(v.pos[0], v.pos[1], v.pos[2]);
+      bounds.grow(positions.back());
+    }
+  }
+};
+
+struct PickObject {
+  glm::mat4 model;
+  uint32_t  mesh; // index into Picker::meshes
+};
+
+struct PickHit {
+  uint32_t  object; // index into Picker::objects
+  glm::vec3 point;  // world space
+  float     t;      // distance along the (unnormalized) ray
+};
+
+/** world-space ray through window pixel (x, y), with (0, 0) the top-left corner. */
+inline Ray cursorRay(const Camera &camera, double x, double y, unsigned int width,
+                     unsigned int height) {
+  glm::vec2 ndc(2.0f * (float)x / width - 1.0f, 1.0f - 2.0f * (float)y / height);
+  return Ray(camera.pos, camera.rayDir(ndc, width / (float)height));
+}
+
+struct Picker {
+  std::vector<PickMesh>   meshes;
+  std::vector<PickObject> objects;
+  Bvh                     bvh;
+
+  /** (re)builds the object BVH -- call after objects change. */
+  void build() {
+    std::vector<Aabb> bounds;
+    bounds.reserve(objects.size());
+    for (const auto &obj : objects) {
+      bounds.push_back(meshes[obj.mesh].bounds.transformed(obj.model));
+    }
+    bvh.build(bounds);
+  }
+
+  std::optional<PickHit> pick(const Ray &ray,
+                              float tMax = std::numeric_limits<float>::max()) const {
+    PickHit best{};
+    bool    hit = bvh.raycast(ray, tMax, [&](uint32_t objIdx, float &t) {
+      const PickObject &obj  = objects[objIdx];
+      const PickMesh   &mesh = meshes[obj.mesh];
+
+      // same t parametrization in object space since dir is transformed, not normalized
+      glm::mat4 inv = glm::inverse(obj.model);
+      Ray       local(glm::vec3(inv * glm::vec4(ray.origin, 1.0f)),
+                      glm::vec3(inv * glm::vec4(ray.dir, 0.0f)));
+      float     tNear = 0.0f;
+      if (!intersectAabb(local, mesh.bounds, t, tNear)) {
+        return false;
+      }
+      bool objHit = false;
+      for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        objHit |= intersectTriangle(local, mesh.positions[mesh.indices[i]],
+                                    mesh.positions[mesh.indices[i + 1]],
+                                    mesh.positions[mesh.indices[i + 2]], t);
+      }
+      if (objHit) {
+        best.object = objIdx;
+        best.t      = t;
+      }
+      return objHit;
+    });
+    if (!hit) {
+      return std::nullopt;
+    }
+    best.point = ray.at(best.t);
+    return best;
+  }
+};
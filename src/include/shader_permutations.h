@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "shader_program.h"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Compiled variants of one uber-shader, one per set of defines.
+//
+// Features and light counts are preprocessor symbols rather than uniforms, so each
+// variant is specialized: disabled features compile away and loops have constant
+// bounds the compiler can unroll. Variants are compiled on first use and cached
+// under their define block, which a ShaderDefines map spells out canonically.
+
+template <class Locations> class ShaderPermutations {
+public:
+  struct Variant {
+    GLuint        program = 0;
+    ShaderDefines defines;
+    Locations     locs;
+  };
+  // called after each (re)link -- looks up uniform locations and sets the constant
+  // ones. program is current while it runs.
+  using LinkFn = std::function<Locations(GLuint program, const ShaderDefines &defines)>;
+
+  ShaderPermutations(const char *vertPath, const char *fragPath, LinkFn onLink)
+      : m_vertPath(vertPath), m_fragPath(fragPath), m_onLink(std::move(onLink)) {}
+  ShaderPermutations(ShaderPermutations &other)            = delete;
+  ShaderPermutations &operator=(ShaderPermutations &other) = delete;
+
+  size_t size() const { return m_variants.size(); }
+
+  /** the variant for defines, compiling it if this is its first use. */
+  const Variant &get(const ShaderDefines &defines) {
+    auto [it, inserted] = m_variants.try_emplace(key(defines));
+    if (inserted) {
+      it->second.defines = defines;
+      link(it->second);
+    }
+    return it->second;
+  }
+
+  /** recompiles every cached variant, eg: after the sources changed. */
+  void reload() {
+    for (auto &[_, variant] : m_variants) {
+      link(variant);
+    }
+  }
+
+  void cleanup() {
+    for (auto &[_, variant] : m_variants) {
+      glDeleteProgram(variant.program);
+    }
+    m_variants.clear();
+  }
+
+private:
+  const char                              *m_vertPath;
+  const char                              *m_fragPath;
+  LinkFn                                   m_onLink;
+  std::unordered_map<std::string, Variant> m_variants;
+
+  static std::string key(const ShaderDefines &defines) {
+    std::string res;
+    for (const auto &[name, value] : defines) {
+      res += name + "=" + std::to_string(value) + ";";
+    }
+    return res;
+  }
+
+  void link(Variant &variant) {
+    reloadProgram(variant.program, m_vertPath, m_fragPath, variant.defines);
+    glUseProgram(variant.program);
+    variant.locs = m_onLink(variant.program, variant.defines);
+    glUseProgram(0); // unbind -- for debugging
+  }
+};
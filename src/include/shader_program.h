@@ -5,10 +5,52 @@
 #include "file.h"
 
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
-void reloadProgram(GLuint &shaderProgram, const char *vertPath, const char *fragPath);
+// preprocessor symbols injected into shader sources, eg: { { "NR_SPOT_LIGHTS", 4 } }.
+// ordered, so equal sets always produce the same source text.
+using ShaderDefines = std::map<std::string, int>;
+
+void reloadProgram(GLuint &shaderProgram, const char *vertPath, const char *fragPath,
+                   const ShaderDefines &defines = {});
+void reloadComputeProgram(GLuint &shaderProgram, const char *compPath,
+                          const ShaderDefines &defines = {});
+
+/** a shader's source with a #define line per entry of defines inserted after its
+ * #version line (which must come first). held in pieces around the defines: source
+ * is used as is, rather than copied. */
+struct PreprocessedSource {
+  std::string_view version;
+  std::string      block; // the #defines
+  std::string_view body;
+
+  PreprocessedSource(std::string_view source, const ShaderDefines &defines) {
+    for (const auto &[name, value] : defines) {
+      block += "#define " + name + " " + std::to_string(value) + "\n";
+    }
+    size_t versionEnd = source.starts_with("#version") ? source.find('\n') : 0;
+    versionEnd        = versionEnd == std::string::npos ? source.size() : versionEnd + 1;
+    version           = source.substr(0, versionEnd);
+    body              = source.substr(versionEnd);
+  }
+};
+
+static void shaderSource(GLuint shader, const PreprocessedSource &source) {
+  const char *strings[] = { source.version.data(), source.block.data(),
+                            source.body.data() };
+  const GLint lengths[] = { (GLint)source.version.size(), (GLint)source.block.size(),
+                            (GLint)source.body.size() };
+  glShaderSource(shader, 3, strings, lengths);
+}
 
 static void checkShaderError(const int shader, const std::string &type) {
   int  success = 0;
@@ -21,7 +63,8 @@ static void checkShaderError(const int shader, const std::string &type) {
   }
 }
 
-static void checkProgramError(const GLuint program) {
+/** returns whether program linked. */
+static bool checkProgramError(const GLuint program) {
   int  success = 0;
   char infoLog[512];
   glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -29,33 +72,165 @@ static void checkProgramError(const GLuint program) {
     glGetProgramInfoLog(program, 512, NULL, infoLog);
     std::cerr << "ERROR:PROGRAM::COMPILATION_FAILED\n" << infoLog << std::endl;
   }
+  return success;
+}
+
+// Linked programs are cached on disk, so warm starts skip compiling and linking: the
+// driver's binary of each (glGetProgramBinary) is kept in PROGRAM_CACHE_DIR, named for
+// a hash of its preprocessed sources and of the driver, whose binaries no other driver
+// takes. glProgramBinary may still refuse one (eg: after an update that kept the
+// driver's version string), and the program is then built from source and cached
+// anew. Nothing is ever evicted: delete the directory to clear it.
+
+constexpr char    PROGRAM_CACHE_MAGIC[8] = { 'L', 'O', 'G', 'L', 'P', 'R', 'O', 'G' };
+const std::string PROGRAM_CACHE_DIR      = ROOT + ".cache/programs/";
+
+struct ProgramBinaryHeader {
+  char     magic[8];
+  uint64_t key;
+  uint32_t format; // of the binary, as glGetProgramBinary gave it
+  uint32_t size;   // of the binary, which follows
+};
+
+static bool programBinariesSupported() {
+  static bool res = [] {
+    GLint nrFormats = 0;
+    if (GLAD_GL_VERSION_4_1) {
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nrFormats);
+    }
+    return nrFormats > 0;
+  }();
+  return res;
 }
 
-void reloadProgram(GLuint &shaderProgram, const char *vertPath, const char *fragPath) {
-  auto vPath = ROOT + vertPath;
-  auto fPath = ROOT + fragPath;
+/** a shader of a program: its type, the name to report errors by, and its source. */
+struct ShaderStage {
+  GLenum                    type;
+  const char               *name;
+  const PreprocessedSource &source;
+};
 
+/** the key of the program linked from stages, in order, on this driver. */
+static uint64_t programKey(std::initializer_list<ShaderStage> stages) {
+  uint64_t res = fnv1a("");
+  for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+    const char *s = (const char *)glGetString(name);
+    res           = fnv1a(std::string_view(s ? s : "", s ? std::strlen(s) + 1 : 1), res);
+  }
+  for (const auto &stage : stages) {
+    res = fnv1a(std::string_view((const char *)&stage.type, sizeof(stage.type)), res);
+    res = fnv1a(stage.source.version, res);
+    res = fnv1a(stage.source.block, res);
+    res = fnv1a(stage.source.body, res);
+  }
+  return res;
+}
+
+static std::string programCachePath(uint64_t key) {
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+  return PROGRAM_CACHE_DIR + name + ".bin";
+}
+
+/** links program from the binary cached for key, if there is one the driver takes. */
+static bool loadProgramBinary(GLuint program, uint64_t key) {
+  if (!programBinariesSupported()) {
+    return false;
+  }
+  std::ifstream       file(programCachePath(key), std::ios::binary);
+  ProgramBinaryHeader header{};
+  if (!file.read((char *)&header, sizeof(header)) ||
+      std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 ||
+      header.key != key) {
+    return false;
+  }
+  std::vector<char> binary(header.size);
+  if (!file.read(binary.data(), binary.size())) {
+    return false;
+  }
+  glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success;
+}
+
+/** caches the binary of program, linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT. */
+static void saveProgramBinary(GLuint program, uint64_t key) {
+  GLint size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0) {
+    return;
+  }
+  std::vector<char>   binary(size);
+  ProgramBinaryHeader header{};
+  GLenum              format = 0;
+  glGetProgramBinary(program, size, &size, &format, binary.data());
+  std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+  header.key    = key;
+  header.format = format;
+  header.size   = size;
+
+  // written aside and renamed into place, so no app ever reads half a binary
+  std::error_code ec;
+  std::filesystem::create_directories(PROGRAM_CACHE_DIR, ec);
+  auto path = programCachePath(key);
+  {
+    std::ofstream file(path + ".tmp", std::ios::binary);
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), header.size);
+    if (!file) {
+      std::cerr << "could not write " << path << ".tmp" << std::endl;
+      return;
+    }
+  }
+  std::filesystem::rename(path + ".tmp", path, ec);
+}
+
+/** a program of stages, from the cache if it has it, else compiled and linked. */
+static GLuint linkProgram(std::initializer_list<ShaderStage> stages) {
+  GLuint   program = glCreateProgram();
+  uint64_t key     = programKey(stages);
+  if (loadProgramBinary(program, key)) {
+    return program;
+  }
+
+  std::vector<GLuint> shaders;
+  for (const auto &stage : stages) {
+    GLuint shader = glCreateShader(stage.type);
+    shaderSource(shader, stage.source);
+    glCompileShader(shader);
+    checkShaderError(shader, stage.name);
+    glAttachShader(program, shader);
+    shaders.push_back(shader);
+  }
+  if (programBinariesSupported()) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glLinkProgram(program);
+  for (GLuint shader : shaders) {
+    glDeleteShader(shader);
+  }
+  if (checkProgramError(program) && programBinariesSupported()) {
+    saveProgramBinary(program, key);
+  }
+  return program;
+}
+
+void reloadProgram(GLuint &shaderProgram, const char *vertPath, const char *fragPath,
+                   const ShaderDefines &defines) {
   glDeleteProgram(shaderProgram); // 0 silently ignored
 
-  unsigned int vertexShader       = glCreateShader(GL_VERTEX_SHADER);
-  std::string  triangleVertSource = readFile(vPath);
-  const char  *cStr               = triangleVertSource.c_str();
-  glShaderSource(vertexShader, 1, &cStr, nullptr);
-  glCompileShader(vertexShader);
-  checkShaderError(vertexShader, "VERTEX");
-
-  unsigned int fragmentShader     = glCreateShader(GL_FRAGMENT_SHADER);
-  std::string  triangleFragSource = readFile(fPath);
-  cStr                            = triangleFragSource.c_str();
-  glShaderSource(fragmentShader, 1, &cStr, NULL);
-  glCompileShader(fragmentShader);
-  checkShaderError(fragmentShader, "FRAGMENT");
-
-  shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-  checkProgramError(shaderProgram);
-}
\ No newline at end of file
+  Asset vert(vertPath), frag(fragPath);
+  shaderProgram =
+      linkProgram({ { GL_VERTEX_SHADER, "VERTEX", { vert.view(), defines } },
+                    { GL_FRAGMENT_SHADER, "FRAGMENT", { frag.view(), defines } } });
+}
+
+void reloadComputeProgram(GLuint &shaderProgram, const char *compPath,
+                          const ShaderDefines &defines) {
+  glDeleteProgram(shaderProgram); // 0 silently ignored
+
+  Asset comp(compPath);
+  shaderProgram =
+      linkProgram({ { GL_COMPUTE_SHADER, "COMPUTE", { comp.view(), defines } } });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Shading level of detail: objects farther from the eye get a cheaper shader.
+//
+// Levels are separated by distance bands. An object only changes level once it is
+// hysteresis * band past the boundary, so objects near a boundary don't flicker
+// between shaders as the camera moves. Objects are bucketed per level, so each level
+// is drawn with one program and one instanced draw.
+
+class ShadingLod {
+public:
+  /** bands: increasing distances at which level i becomes level i + 1. */
+  ShadingLod(std::vector<float> bands, float hysteresis)
+      : m_bands(std::move(bands)), m_hysteresis(hysteresis),
+        m_buckets(m_bands.size() + 1) {
+    for (size_t i = 1; i < m_bands.size(); ++i) {
+      assert(m_bands[i - 1] < m_bands[i]);
+    }
+  }
+
+  unsigned int nrLevels() const { return m_buckets.size(); }
+  unsigned int level(uint32_t object) const { return m_levels[object]; }
+  /** indices of the objects at level, ascending. */
+  const std::vector<uint32_t> &bucket(unsigned int level) const {
+    return m_buckets[level];
+  }
+  /** objects that changed level during the last update. */
+  unsigned int nrSwitches() const { return m_nrSwitches; }
+
+  /** re-levels every object from the distance of its center to eye. the first update
+   * (or one with a different number of objects) picks levels without hysteresis. */
+  void update(std::span<const glm::vec3> centers, glm::vec3 eye) {
+    bool fresh = m_levels.size() != centers.size();
+    m_levels.resize(centers.size());
+    m_nrSwitches = 0;
+    for (auto &bucket : m_buckets) {
+      bucket.clear();
+    }
+
+    for (uint32_t i = 0; i < centers.size(); ++i) {
+      float        d     = glm::distance(centers[i], eye);
+      unsigned int level = fresh ? 0 : m_levels[i];
+      float        h     = fresh ? 0.0f : m_hysteresis;
+      while (level < m_bands.size() && d > m_bands[level] * (1.0f + h)) {
+        ++level;
+      }
+      while (level > 0 && d < m_bands[level - 1] * (1.0f - h)) {
+        --level;
+      }
+      m_nrSwitches += !fresh && level != m_levels[i];
+      m_levels[i]   = level;
+      m_buckets[level].push_back(i);
+    }
+  }
+
+private:
+  std::vector<float>                 m_bands;
+  float                              m_hysteresis;
+  std::vector<unsigned int>          m_levels;
+  std::vector<std::vector<uint32_t>> m_buckets;
+  unsigned int                       m_nrSwitches = 0;
+};
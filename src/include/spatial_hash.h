@@ -0,0 +1,146 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over unbounded space, hashed by integer cell coordinate.
+// Each entity lives in the one cell containing its center, so insert, move and
+// remove are O(1); queries widen their search by the largest entity radius seen.
+// Suited to things that move every frame (lights, animated objects) where
+// rebuilding a tree per frame would cost more than the queries save.
+
+class SpatialHash {
+public:
+  using Handle = uint32_t;
+
+  // cellSize should be on the order of typical query radii
+  explicit SpatialHash(float cellSize) : m_invCellSize(1.0f / cellSize) {}
+
+  Handle insert(glm::vec3 pos, float radius = 0.0f) {
+    Handle h;
+    if (!m_free.empty()) {
+      h = m_free.back();
+      m_free.pop_back();
+    } else {
+      h = static_cast<Handle>(m_entities.size());
+      m_entities.emplace_back();
+    }
+    Entity &e   = m_entities[h];
+    e.pos       = pos;
+    e.radius    = radius;
+    m_maxRadius = std::max(m_maxRadius, radius);
+    link(h, cellKey(cellOf(pos)));
+    return h;
+  }
+
+  void move(Handle h, glm::vec3 pos) {
+    Entity  &e   = m_entities[h];
+    uint64_t key = cellKey(cellOf(pos));
+    e.pos        = pos;
+    if (key != e.cell) {
+      unlink(h);
+      link(h, key);
+    }
+  }
+
+  void remove(Handle h) {
+    unlink(h);
+    m_free.push_back(h);
+  }
+
+  glm::vec3 position(Handle h) const { return m_entities[h].pos; }
+  float     radius(Handle h) const { return m_entities[h].radius; }
+
+  /** calls fn(handle) for every entity whose bounding sphere overlaps box. */
+  template <class F> void queryBox(const Aabb &box, F &&fn) const {
+    forCells(box.min - m_maxRadius, box.max + m_maxRadius, [&](Handle h) {
+      const Entity &e = m_entities[h];
+      glm::vec3     d = e.pos - glm::clamp(e.pos, box.min, box.max);
+      if (glm::dot(d, d) <= e.radius * e.radius) {
+        fn(h);
+      }
+    });
+  }
+
+  /** calls fn(handle) for every entity whose bounding sphere overlaps the sphere. */
+  template <class F> void querySphere(glm::vec3 center, float radius, F &&fn) const {
+    float reach = radius + m_maxRadius;
+    forCells(center - reach, center + reach, [&](Handle h) {
+      const Entity &e = m_entities[h];
+      glm::vec3     d = e.pos - center;
+      float         r = radius + e.radius;
+      if (glm::dot(d, d) <= r * r) {
+        fn(h);
+      }
+    });
+  }
+
+private:
+  struct Entity {
+    glm::vec3 pos;
+    float     radius;
+    uint64_t  cell; // key of the cell this entity is linked into
+    uint32_t  slot; // index within that cell's list
+  };
+
+  float                                             m_invCellSize;
+  float                                             m_maxRadius = 0.0f;
+  std::vector<Entity>                               m_entities;
+  std::vector<Handle>                               m_free; // removed handles, reused
+  std::unordered_map<uint64_t, std::vector<Handle>> m_cells;
+
+  glm::ivec3 cellOf(glm::vec3 p) const {
+    return glm::ivec3(glm::floor(p * m_invCellSize));
+  }
+
+  // 21 bits per axis -- cells wrap every ~2M cells, which only costs extra candidates
+  static uint64_t cellKey(glm::ivec3 c) {
+    const uint64_t mask = (1u << 21) - 1;
+    return ((uint64_t)(c.x & mask) << 42) | ((uint64_t)(c.y & mask) << 21) |
+           (uint64_t)(c.z & mask);
+  }
+
+  void link(Handle h, uint64_t key) {
+    auto &list         = m_cells[key];
+    m_entities[h].cell = key;
+    m_entities[h].slot = static_cast<uint32_t>(list.size());
+    list.push_back(h);
+  }
+
+  // swap-remove from the cell list, and the cell once empty so the map only holds
+  // occupied cells
+  void unlink(Handle h) {
+    auto     it                 = m_cells.find(m_entities[h].cell);
+    auto    &list               = it->second;
+    uint32_t slot               = m_entities[h].slot;
+    list[slot]                  = list.back();
+    m_entities[list[slot]].slot = slot;
+    list.pop_back();
+    if (list.empty()) {
+      m_cells.erase(it);
+    }
+  }
+
+  template <class F> void forCells(glm::vec3 lo, glm::vec3 hi, F &&fn) const {
+    glm::ivec3 c0 = cellOf(lo), c1 = cellOf(hi);
+    for (int x = c0.x; x <= c1.x; ++x) {
+      for (int y = c0.y; y <= c1.y; ++y) {
+        for (int z = c0.z; z <= c1.z; ++z) {
+          auto it = m_cells.find(cellKey(glm::ivec3(x, y, z)));
+          if (it == m_cells.end()) {
+            continue;
+          }
+          for (Handle h : it->second) {
+            fn(h);
+          }
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "file.h"
+#include "image.h"
+#include "ktx2.h"
+
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+// Textures shared by everything that loads the same image the same way.
+//
+// Entries are keyed by canonical path plus the load parameters, and handed out as
+// reference-counted handles, so a repeated load costs a lookup. Entries nobody
+// references stay resident (a later load is still free) until their total size
+// exceeds the budget, then the least recently released go first.
+//
+// Images baked by tools/ktx_bake (see ktx2::bakedPath) are uploaded from their block
+// compressed mip chain instead, unless the source is newer than the bake.
+//
+// GL thread only. Every handle must be gone before cleanup().
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+class TextureCache {
+  struct Entry;
+
+public:
+  static constexpr size_t DEFAULT_BUDGET = 256 << 20; // bytes of unreferenced textures
+
+  class Handle {
+  public:
+    Handle() = default;
+    Handle(const Handle &other) : m_cache(other.m_cache), m_entry(other.m_entry) {
+      acquire();
+    }
+    Handle(Handle &&other) noexcept
+        : m_cache(std::exchange(other.m_cache, nullptr)),
+          m_entry(std::exchange(other.m_entry, nullptr)) {}
+    Handle &operator=(Handle other) noexcept {
+      std::swap(m_cache, other.m_cache);
+      std::swap(m_entry, other.m_entry);
+      return *this;
+    }
+    ~Handle() {
+      if (m_entry != nullptr) {
+        m_cache->release(*m_entry);
+      }
+    }
+
+    GLuint id() const { return m_entry == nullptr ? 0 : m_entry->texture; }
+    explicit operator bool() const { return m_entry != nullptr; }
+
+  private:
+    friend class TextureCache;
+
+    TextureCache *m_cache = nullptr;
+    Entry        *m_entry = nullptr;
+
+    Handle(TextureCache *cache, Entry *entry) : m_cache(cache), m_entry(entry) {
+      acquire();
+    }
+    void acquire() {
+      if (m_entry != nullptr) {
+        m_cache->acquire(*m_entry);
+      }
+    }
+  };
+
+  explicit TextureCache(size_t budget = DEFAULT_BUDGET) : m_budget(budget) {}
+  TextureCache(TextureCache &other)            = delete;
+  TextureCache &operator=(TextureCache &other) = delete;
+
+  /** the texture for path (relative to the repo root) loaded with these parameters,
+   * loading it unless a handle to it exists or it is still cached. */
+  Handle get(const std::string &path, bool flip = true, GLint internalFormat = GL_RGBA8) {
+    // a packed path names its entry as spelled, and canonicalizing asks the disk
+    const AssetPack *pack      = assetPack();
+    auto             canonical = pack != nullptr && pack->contains(path)
+                                     ? ROOT + path
+                                     : std::filesystem::weakly_canonical(ROOT + path)
+                                           .generic_string();
+    auto key = canonical + "|" + std::to_string(flip) + "|" +
+               std::to_string(internalFormat);
+    auto [it, inserted] = m_entries.try_emplace(key);
+    Entry &entry        = it->second;
+    if (inserted) {
+      ++m_nrMisses;
+      entry.key = key;
+      try {
+        load(entry, path, flip, internalFormat);
+      } catch (...) {
+        m_entries.erase(it); // so the next get tries again, rather than hits nothing
+        throw;
+      }
+      m_residentBytes += entry.bytes;
+    } else {
+      ++m_nrHits;
+    }
+    return Handle(this, &entry);
+  }
+
+  size_t size() const { return m_entries.size(); }
+  size_t residentBytes() const { return m_residentBytes; }
+  size_t unreferencedBytes() const { return m_unreferencedBytes; }
+  size_t nrHits() const { return m_nrHits; }
+  size_t nrMisses() const { return m_nrMisses; }
+
+  /** deletes every texture. */
+  void cleanup() {
+    for (auto &[_, entry] : m_entries) {
+      glDeleteTextures(1, &entry.texture);
+    }
+    m_entries.clear();
+    m_lru.clear();
+    m_residentBytes     = 0;
+    m_unreferencedBytes = 0;
+  }
+
+private:
+  struct Entry {
+    std::string                      key;
+    GLuint                           texture = 0;
+    size_t                           bytes   = 0; // including mips
+    unsigned int                     nrRefs  = 0;
+    bool                             inLru   = false;
+    std::list<std::string>::iterator lru;
+  };
+
+  size_t                                 m_budget;
+  std::unordered_map<std::string, Entry> m_entries; // nodes: entry addresses are stable
+  std::list<std::string>                 m_lru;     // unreferenced keys, oldest first
+  size_t                                 m_residentBytes     = 0;
+  size_t                                 m_unreferencedBytes = 0;
+  size_t                                 m_nrHits            = 0;
+  size_t                                 m_nrMisses          = 0;
+
+  void acquire(Entry &entry) {
+    if (entry.nrRefs++ == 0 && entry.inLru) {
+      m_lru.erase(entry.lru);
+      entry.inLru          = false;
+      m_unreferencedBytes -= entry.bytes;
+    }
+  }
+
+  void release(Entry &entry) {
+    if (--entry.nrRefs > 0) {
+      return;
+    }
+    entry.lru            = m_lru.insert(m_lru.end(), entry.key);
+    entry.inLru          = true;
+    m_unreferencedBytes += entry.bytes;
+    while (m_unreferencedBytes > m_budget) {
+      auto victim = m_entries.find(m_lru.front());
+      m_lru.pop_front();
+      glDeleteTextures(1, &victim->second.texture);
+      m_unreferencedBytes -= victim->second.bytes;
+      m_residentBytes     -= victim->second.bytes;
+      m_entries.erase(victim);
+    }
+  }
+
+  static void load(Entry &entry, const std::string &path, bool flip,
+                   GLint internalFormat) {
+    if (loadBaked(entry, path, flip, internalFormat)) {
+      return;
+    }
+    stbi_set_flip_vertically_on_load(flip);
+    auto         image     = stb::Image(path.c_str());
+    const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rgb rows need not be 4-byte aligned
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0,
+                 formats[image.nrChannels - 1], GL_UNSIGNED_BYTE, image.data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // 4 bytes per texel is close enough for the budget; mips add a third
+    entry.bytes = (size_t)image.width * image.height * 4 * 4 / 3;
+  }
+
+  /** uploads the baked mip chain of path as is, if there is a bake at least as new as
+   * path, stored the same way up, that the driver can sample as internalFormat. */
+  static bool loadBaked(Entry &entry, const std::string &path, bool flip,
+                        GLint internalFormat) {
+    bool srgb = internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8;
+    if (!srgb && internalFormat != GL_RGB8 && internalFormat != GL_RGBA8) {
+      return false;
+    }
+    auto             baked = ktx2::bakedPath(path);
+    const AssetPack *pack  = assetPack();
+    std::error_code  ec;
+    // a packed bake was packed with its image, so it is as new
+    if ((pack == nullptr || !pack->contains(baked)) &&
+        (!std::filesystem::exists(ROOT + baked, ec) ||
+         std::filesystem::last_write_time(ROOT + baked) <
+             std::filesystem::last_write_time(ROOT + path))) {
+      return false;
+    }
+    auto file    = Asset(baked, true); // the levels are uploaded straight from it
+    auto texture = ktx2::read(file.view());
+    if (!texture || texture->orientation != (flip ? "ru" : "rd")) {
+      return false;
+    }
+    // BPTC is core from 4.2, which macOS lacks
+    bool bc7 = ktx2::isBc7(texture->vkFormat);
+    if (bc7 ? !GLAD_GL_VERSION_4_2 : !s3tcSupported()) {
+      return false;
+    }
+
+    // the bake's own transfer function only decided how its mips were filtered
+    GLenum format = bc7 ? (srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                                : GL_COMPRESSED_RGBA_BPTC_UNORM)
+                    : ktx2::isBc3(texture->vkFormat)
+                        ? (srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                                : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                        : (srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                                : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    for (uint32_t level = 0; level < texture->nrLevels; ++level) {
+      auto data = texture->level(level);
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, format, texture->levelWidth(level),
+                             texture->levelHeight(level), 0, data.size(), data.data());
+      entry.bytes += data.size();
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->nrLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+  }
+
+  static bool s3tcSupported() {
+    static const bool supported = [] {
+      GLint nrExtensions = 0;
+      glGetIntegerv(GL_NUM_EXTENSIONS, &nrExtensions);
+      for (GLint i = 0; i < nrExtensions; ++i) {
+        auto name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+          return true;
+        }
+      }
+      return false;
+    }();
+    return supported;
+  }
+};
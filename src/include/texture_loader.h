@@ -0,0 +1,300 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "file.h"
+#include "image.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Textures loaded off the GL thread.
+//
+// load() hands out a texture name at once, holding a placeholder. A worker pool
+// decodes the image and copies the pixels into a persistently mapped pixel-unpack
+// buffer; update() then uploads a few finished textures per frame from there, so
+// neither decoding nor copying pixels stalls the frame. A fence per upload tells
+// when its staging region may be reused.
+//
+// stb decodes into its own allocation, so each image is copied once into staging.
+// Images that don't fit in staging (or without GL 4.4 buffer storage) are uploaded
+// from the decoded copy instead.
+
+/** first-in, first-out allocator over a fixed byte range, releasable in any order.
+ * space is reclaimed once the oldest allocations are released. */
+class StagingRing {
+public:
+  static constexpr size_t ALIGNMENT = 256;
+
+  size_t capacity() const { return m_capacity; }
+
+  /** forgets every allocation. */
+  void reset(size_t capacity) {
+    std::lock_guard lock(m_mutex);
+    m_capacity = capacity;
+    m_head     = 0;
+    m_regions.clear();
+  }
+
+  std::optional<size_t> allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    std::lock_guard lock(m_mutex);
+    size_t          offset;
+    if (m_regions.empty()) {
+      if (size > m_capacity) {
+        return std::nullopt;
+      }
+      offset = 0;
+    } else {
+      size_t tail = m_regions.front().offset;
+      if (m_head > tail) {
+        // free: [head, capacity) and [0, tail)
+        if (m_capacity - m_head >= size) {
+          offset = m_head;
+        } else if (size <= tail) {
+          offset = 0;
+        } else {
+          return std::nullopt;
+        }
+      } else if (m_head < tail && tail - m_head >= size) {
+        offset = m_head; // free: [head, tail)
+      } else {
+        return std::nullopt; // head == tail: full
+      }
+    }
+    m_regions.push_back({ .offset = offset, .released = false });
+    m_head = offset + size;
+    return offset;
+  }
+
+  void release(size_t offset) {
+    std::lock_guard lock(m_mutex);
+    for (auto &region : m_regions) {
+      if (region.offset == offset) {
+        region.released = true;
+        break;
+      }
+    }
+    while (!m_regions.empty() && m_regions.front().released) {
+      m_regions.pop_front();
+    }
+  }
+
+private:
+  struct Region {
+    size_t offset;
+    bool   released;
+  };
+
+  size_t             m_capacity = 0;
+  size_t             m_head     = 0; // end of the newest region
+  std::deque<Region> m_regions;     // oldest first
+  std::mutex         m_mutex;
+};
+
+class TextureLoader {
+public:
+  static constexpr size_t STAGING_SIZE = 64 << 20;
+
+  explicit TextureLoader(
+      unsigned int nrThreads = std::max(2u, std::thread::hardware_concurrency()) - 1)
+      : m_pool(nrThreads) {}
+  TextureLoader(TextureLoader &other)            = delete;
+  TextureLoader &operator=(TextureLoader &other) = delete;
+
+  /** creates the staging buffer -- call once the GL context is current. */
+  void init() {
+    m_staging.reset(GLAD_GL_VERSION_4_4 ? STAGING_SIZE : 0);
+    if (m_staging.capacity() == 0) {
+      return;
+    }
+    glGenBuffers(1, &m_pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, STAGING_SIZE, nullptr, flags);
+    m_mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, STAGING_SIZE,
+                                                 flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  /** waits out decodes in flight, then frees the staging buffer. textures handed out
+   * by load() belong to the caller. */
+  void cleanup() {
+    {
+      std::unique_lock lock(m_mutex);
+      m_cancelled = true;
+      m_idle.wait(lock, [this] { return m_nrDecoding == 0; });
+      for (auto &ready : m_ready) {
+        stbi_image_free(ready.pixels);
+      }
+      m_ready.clear();
+    }
+    for (auto &upload : m_uploads) {
+      glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+      glDeleteSync(upload.fence);
+    }
+    m_uploads.clear();
+    if (m_pbo != 0) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      glDeleteBuffers(1, &m_pbo);
+      m_pbo = 0;
+    }
+  }
+
+  /** a texture showing a placeholder until path (relative to the repo root) has been
+   * decoded and uploaded by update(). */
+  GLuint load(const std::string &path, bool flip = true) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    const uint32_t checker[] = { 0xff808080, 0xffc0c0c0, 0xffc0c0c0, 0xff808080 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 checker);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // one level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    {
+      std::lock_guard lock(m_mutex);
+      ++m_nrDecoding;
+    }
+    m_pool.submit([this, texture, path, flip] { decode(texture, path, flip); });
+    return texture;
+  }
+
+  /** uploads at most maxUploads decoded textures, without waiting on workers or the
+   * GPU. call once per frame; returns the number uploaded. */
+  unsigned int update(unsigned int maxUploads = 2) {
+    // staging regions whose uploads the GPU has finished may be reused
+    while (!m_uploads.empty()) {
+      GLenum status = glClientWaitSync(m_uploads.front().fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        break;
+      }
+      glDeleteSync(m_uploads.front().fence);
+      m_staging.release(m_uploads.front().offset);
+      m_uploads.pop_front();
+    }
+
+    unsigned int nrUploaded = 0;
+    while (nrUploaded < maxUploads) {
+      Decoded decoded;
+      {
+        std::lock_guard lock(m_mutex);
+        if (m_ready.empty()) {
+          break;
+        }
+        decoded = m_ready.front();
+        m_ready.pop_front();
+      }
+
+      glBindTexture(GL_TEXTURE_2D, decoded.texture);
+      if (decoded.pixels == nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, decoded.width, decoded.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, (void *)decoded.offset);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, decoded.width, decoded.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, decoded.pixels);
+        stbi_image_free(decoded.pixels);
+      }
+      glGenerateMipmap(GL_TEXTURE_2D);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glBindTexture(GL_TEXTURE_2D, 0);
+
+      if (decoded.pixels == nullptr) {
+        m_uploads.push_back({ .fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+                              .offset = decoded.offset });
+      }
+      ++nrUploaded;
+    }
+    return nrUploaded;
+  }
+
+  /** textures still showing their placeholder. */
+  unsigned int pending() {
+    std::lock_guard lock(m_mutex);
+    return m_nrDecoding + m_ready.size();
+  }
+
+private:
+  struct Decoded {
+    GLuint         texture;
+    int            width;
+    int            height;
+    size_t         offset; // into staging, when pixels is null
+    unsigned char *pixels; // decoded copy, when staging was full
+  };
+  struct Upload {
+    GLsync fence;
+    size_t offset;
+  };
+
+  StagingRing             m_staging;
+  GLuint                  m_pbo    = 0;
+  unsigned char          *m_mapped = nullptr;
+  std::deque<Upload>      m_uploads; // oldest first, GL thread only
+  std::deque<Decoded>     m_ready;
+  unsigned int            m_nrDecoding = 0;
+  bool                    m_cancelled  = false;
+  std::mutex              m_mutex;
+  std::condition_variable m_idle;
+  ThreadPool              m_pool; // last: joined before the members above go away
+
+  void decode(GLuint texture, const std::string &path, bool flip) {
+    Decoded decoded{ .texture = texture, .offset = 0, .pixels = nullptr };
+    unsigned char *pixels = nullptr;
+    if (!cancelled()) {
+      stbi_set_flip_vertically_on_load_thread(flip);
+      int nrChannels;
+      try {
+        auto file = Asset(path);
+        pixels    = stbi_load_from_memory(
+            (const stbi_uc *)file.data(), (int)file.size(), &decoded.width,
+            &decoded.height, &nrChannels, 4); // always rgba -- rows stay 4-byte aligned
+      } catch (const std::runtime_error &) {
+        // reported below
+      }
+      if (pixels == nullptr) {
+        std::cerr << "could not load image: " << ROOT + path << std::endl;
+      }
+    }
+    if (pixels != nullptr) {
+      size_t size   = (size_t)decoded.width * decoded.height * 4;
+      auto   offset = m_staging.allocate(size);
+      if (offset) {
+        std::memcpy(m_mapped + *offset, pixels, size);
+        stbi_image_free(pixels);
+        decoded.offset = *offset;
+      } else {
+        decoded.pixels = pixels;
+      }
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (pixels != nullptr) {
+      m_ready.push_back(decoded);
+    }
+    --m_nrDecoding;
+    m_idle.notify_all();
+  }
+
+  bool cancelled() {
+    std::lock_guard lock(m_mutex);
+    return m_cancelled;
+  }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads with a single shared job queue.
+
+class ThreadPool {
+public:
+  explicit ThreadPool(
+      unsigned int nrThreads = std::max(1u, std::thread::hardware_concurrency()))
+      : m_stop(false) {
+    for (unsigned int i = 0; i < nrThreads; ++i) {
+      m_workers.emplace_back([this] { work(); });
+    }
+  }
+  ThreadPool(ThreadPool &other)             = delete;
+  ThreadPool(ThreadPool &&other)            = delete;
+  ThreadPool &operator=(ThreadPool &other)  = delete;
+  ThreadPool &operator=(ThreadPool &&other) = delete;
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto &worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  unsigned int size() const { return static_cast<unsigned int>(m_workers.size()); }
+
+  void submit(std::function<void()> job) {
+    {
+      std::lock_guard lock(m_mutex);
+      m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+  }
+
+  /** runs fn(i) for i in [0, count) on the pool and the calling thread.
+   * returns once every call has finished. */
+  template <class F> void parallelFor(uint32_t count, F &&fn) {
+    if (count == 0) {
+      return;
+    }
+    std::atomic<uint32_t> next = 0;
+    auto                  run  = [&] {
+      for (uint32_t i = next++; i < count; i = next++) {
+        fn(i);
+      }
+    };
+    uint32_t    nrHelpers = std::min<uint32_t>(size(), count - 1);
+    std::latch  done(nrHelpers);
+    for (uint32_t h = 0; h < nrHelpers; ++h) {
+      submit([&] {
+        run();
+        done.count_down();
+      });
+    }
+    run();
+    done.wait();
+  }
+
+private:
+  std::vector<std::thread>          m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex                        m_mutex;
+  std::condition_variable           m_cv;
+  bool                              m_stop;
+
+  void work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+        if (m_stop && m_jobs.empty()) {
+          return;
+        }
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+      job();
+    }
+  }
+};
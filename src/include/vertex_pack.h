@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// A 16 byte vertex, half of the 32 bytes of floats in a CubeVertex:
+// - position: 3 x unorm16 across the bounds of its mesh, which the vertex shader maps
+//   back with the mesh's Dequantize (to within 1/65535 of the bounds' extent)
+// - normal: 2 x snorm16, octahedral -- the unit sphere folded onto a square
+// - texture coordinates: 2 x half float
+// src/3.3.1.packed_vertex.vert decodes it.
+
+struct PackedVertex {
+  uint16_t pos[3];
+  uint16_t pad;
+  int16_t  normal[2];
+  uint16_t tex[2];
+};
+
+/** pos = offset + scale * packed pos */
+struct Dequantize {
+  glm::vec3 offset;
+  glm::vec3 scale;
+};
+
+inline Dequantize dequantize(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+  return { boundsMin, boundsMax - boundsMin };
+}
+
+/** unit vector n as a point in [-1, 1]^2: the upper half of the octahedron
+ * |x| + |y| + |z| = 1 projected down, the lower half folded out to the corners. */
+inline glm::vec2 octEncode(glm::vec3 n) {
+  n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (n.z >= 0.0f) {
+    return { n.x, n.y };
+  }
+  return { (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+           (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f) };
+}
+
+inline glm::vec3 octDecode(glm::vec2 e) {
+  glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+  float     t  = std::max(-n.z, 0.0f);
+  n.x         += n.x >= 0.0f ? -t : t;
+  n.y         += n.y >= 0.0f ? -t : t;
+  return glm::normalize(n);
+}
+
+inline PackedVertex packVertex(glm::vec3 pos, glm::vec2 tex, glm::vec3 normal,
+                               const Dequantize &dequantize) {
+  PackedVertex res{};
+  for (int i = 0; i < 3; ++i) {
+    float t    = dequantize.scale[i] > 0.0f
+                     ? (pos[i] - dequantize.offset[i]) / dequantize.scale[i]
+                     : 0.0f;
+    res.pos[i] = glm::packUnorm1x16(t);
+  }
+  // a missing normal decodes to +z
+  glm::vec2 oct = glm::dot(normal, normal) > 0.0f ? octEncode(glm::normalize(normal))
+                                                  : glm::vec2(0.0f);
+  res.normal[0] = (int16_t)glm::packSnorm1x16(oct.x);
+  res.normal[1] = (int16_t)glm::packSnorm1x16(oct.y);
+  res.tex[0]    = glm::packHalf1x16(tex.x);
+  res.tex[1]    = glm::packHalf1x16(tex.y);
+  return res;
+}
+
+/** what the vertex shader sees of a packed vertex: position, texture coordinates and
+ * normal. */
+inline void unpackVertex(const PackedVertex &v, const Dequantize &dequantize,
+                         glm::vec3 &pos, glm::vec2 &tex, glm::vec3 &normal) {
+  for (int i = 0; i < 3; ++i) {
+    pos[i] = dequantize.offset[i] + dequantize.scale[i] * glm::unpackUnorm1x16(v.pos[i]);
+  }
+  tex    = { glm::unpackHalf1x16(v.tex[0]), glm::unpackHalf1x16(v.tex[1]) };
+  normal = octDecode({ glm::unpackSnorm1x16(v.normal[0]),
+                       glm::unpackSnorm1x16(v.normal[1]) });
+}
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "file.h"
+#include "vtex.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A virtual texture: a texture too large to keep in VRAM, drawn from the few of its
+// pages (see vtex.h) that the view needs. On the GPU it is:
+// - a physical page cache: one texture with room for cacheSide x cacheSide pages,
+//   held in any slot
+// - a page table: a texel per page at every level, telling which slot holds the page
+//   or, when it is missing, its nearest resident ancestor -- and that one's level
+// Each frame:
+// 1. the scene is drawn small into a feedback buffer, each pixel the page (x, y,
+//    level) it will sample (between beginFeedback() and endFeedback())
+// 2. update() reads the feedback back, frames later so it never stalls, and queues
+//    the missing pages, coarsest first
+// 3. a streaming thread copies queued pages out of the mapped .vtex
+// 4. update() uploads a few copied pages per frame, evicting the pages least
+//    recently seen in the feedback, and rewrites the page table
+// The last level is a single page, loaded up front and never evicted, so every lookup
+// finds something. Until its own page arrives, a pixel is drawn blurrier, from an
+// ancestor.
+
+class VirtualTexture {
+public:
+  static constexpr unsigned int FEEDBACK_DIVISOR = 8; // on each axis, of the screen
+  static constexpr unsigned int NR_READBACKS     = 3; // feedback frames in flight
+
+  VirtualTexture() = default;
+  VirtualTexture(VirtualTexture &other)            = delete;
+  VirtualTexture &operator=(VirtualTexture &other) = delete;
+  ~VirtualTexture() { stop(); }
+
+  /** the virtual texture baked from the image at path (relative to the repo root),
+   * with room for cacheSide x cacheSide pages. call once the GL context is current. */
+  void init(const std::string &path, uint32_t cacheSide = 16) {
+    m_file.emplace(vtex::bakedPath(path), true);
+    m_header = vtex::header(m_file->view());
+    if (m_header == nullptr) {
+      auto msg = "not a virtual texture: " + ROOT + vtex::bakedPath(path);
+      std::cerr << msg << std::endl;
+      throw std::runtime_error(msg);
+    }
+    uint32_t nrPages = vtex::firstPage(size(), nrLevels());
+    m_cacheSide      = std::min(cacheSide, 255u); // slots fit in a byte
+    m_slots.assign(m_cacheSide * m_cacheSide, NO_PAGE);
+    m_slotOf.assign(nrPages, NO_SLOT);
+    m_lastSeen.assign(nrPages, 0);
+    m_requested.assign(nrPages, false);
+    for (uint32_t level = 0; level < nrLevels(); ++level) {
+      uint32_t n = vtex::pagesPerSide(size(), level);
+      m_table.emplace_back(n * n);
+    }
+
+    glGenTextures(1, &m_physical);
+    glBindTexture(GL_TEXTURE_2D, m_physical);
+    // sampled as stored, like the textures TextureCache loads as GL_RGBA8
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, cacheTexels(),
+                   cacheTexels());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenTextures(1, &m_pageTable);
+    glBindTexture(GL_TEXTURE_2D, m_pageTable);
+    glTexStorage2D(GL_TEXTURE_2D, nrLevels(), GL_RGBA8, vtex::pagesPerSide(size(), 0),
+                   vtex::pagesPerSide(size(), 0));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the last level's page, for good
+    uint32_t root = nrPages - 1;
+    m_lastSeen[root] = UINT64_MAX;
+    upload(root, page(root));
+    writePageTable();
+
+    m_thread = std::thread([this] { stream(); });
+  }
+
+  /** stops streaming and frees the textures and feedback buffers. */
+  void cleanup() {
+    stop();
+    for (auto &readback : m_readbacks) {
+      glDeleteSync(readback.fence); // 0 silently ignored
+      glDeleteBuffers(1, &readback.pbo);
+      readback = {};
+    }
+    glDeleteFramebuffers(1, &m_feedbackFbo);
+    glDeleteTextures(1, &m_feedbackColor);
+    glDeleteTextures(1, &m_feedbackDepth);
+    glDeleteTextures(1, &m_pageTable);
+    glDeleteTextures(1, &m_physical);
+    m_feedbackFbo = m_feedbackColor = m_feedbackDepth = m_pageTable = m_physical = 0;
+  }
+
+  uint32_t size() const { return m_header->size; }
+  uint32_t nrLevels() const { return m_header->nrLevels; }
+  uint32_t cacheTexels() const { return m_cacheSide * vtex::PAGE_TEXELS; }
+  GLuint   pageTable() const { return m_pageTable; }
+  GLuint   physical() const { return m_physical; }
+
+  /** binds and clears the feedback buffer for a screen of width x height, and sets
+   * the viewport to it. */
+  void beginFeedback(unsigned int width, unsigned int height) {
+    unsigned int w = std::max(1u, width / FEEDBACK_DIVISOR);
+    unsigned int h = std::max(1u, height / FEEDBACK_DIVISOR);
+    if (w != m_feedbackWidth || h != m_feedbackHeight) {
+      resizeFeedback(w, h);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFbo);
+    glViewport(0, 0, w, h);
+    const GLuint none[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+
+  /** starts reading the feedback back, unless every readback is still in flight, and
+   * binds the default framebuffer. */
+  void endFeedback() {
+    for (auto &readback : m_readbacks) {
+      if (readback.fence != 0) {
+        continue;
+      }
+      size_t bytes = (size_t)m_feedbackWidth * m_feedbackHeight * 4;
+      if (readback.pbo == 0) {
+        glGenBuffers(1, &readback.pbo);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+      if (readback.capacity < bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        readback.capacity = bytes;
+      }
+      glReadPixels(0, 0, m_feedbackWidth, m_feedbackHeight, GL_RGBA_INTEGER,
+                   GL_UNSIGNED_BYTE, nullptr);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      readback.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      readback.width  = m_feedbackWidth;
+      readback.height = m_feedbackHeight;
+      readback.issued = m_nrIssued++;
+      break;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  /** takes in finished feedback and uploads at most maxUploads streamed pages,
+   * without waiting on the GPU or the streaming thread. call once per frame; returns
+   * the number uploaded. */
+  unsigned int update(unsigned int maxUploads = 8) {
+    // oldest first, so the newest feedback decides the queue
+    while (true) {
+      Readback *oldest = nullptr;
+      for (auto &readback : m_readbacks) {
+        if (readback.fence != 0 && (!oldest || readback.issued < oldest->issued)) {
+          oldest = &readback;
+        }
+      }
+      if (oldest == nullptr) {
+        break;
+      }
+      GLenum status = glClientWaitSync(oldest->fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        break;
+      }
+      glDeleteSync(oldest->fence);
+      oldest->fence = 0;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->pbo);
+      size_t bytes  = (size_t)oldest->width * oldest->height * 4;
+      auto  *pixels = (const glm::u8vec4 *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                             bytes, GL_MAP_READ_BIT);
+      if (pixels != nullptr) {
+        request({ pixels, (size_t)oldest->width * oldest->height });
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    unsigned int nrUploaded = 0;
+    while (nrUploaded < maxUploads) {
+      Streamed streamed;
+      {
+        std::lock_guard lock(m_mutex);
+        if (m_streamed.empty()) {
+          break;
+        }
+        streamed = std::move(m_streamed.front());
+        m_streamed.pop_front();
+      }
+      if (!upload(streamed.page, streamed.data)) {
+        // every slot is in view: kept for when one leaves it, rather than read again
+        std::lock_guard lock(m_mutex);
+        m_streamed.push_front(std::move(streamed));
+        break;
+      }
+      m_requested[streamed.page] = false;
+      ++nrUploaded;
+    }
+    if (nrUploaded > 0) {
+      writePageTable();
+    }
+    m_nrUploaded += nrUploaded;
+    return nrUploaded;
+  }
+
+  /** pages in the cache. */
+  uint32_t nrResident() const {
+    return std::ranges::count_if(m_slots, [](uint32_t page) { return page != NO_PAGE; });
+  }
+  uint32_t nrSlots() const { return m_slots.size(); }
+  /** pages queued or streamed, not yet uploaded. */
+  uint32_t nrPending() {
+    std::lock_guard lock(m_mutex);
+    return m_queue.size() + m_streamed.size();
+  }
+  uint64_t nrUploaded() const { return m_nrUploaded; }
+
+private:
+  static constexpr uint32_t NO_PAGE = UINT32_MAX;
+  static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+  struct Readback {
+    GLuint       pbo      = 0;
+    GLsync       fence    = 0; // set while in flight
+    size_t       capacity = 0;
+    unsigned int width    = 0;
+    unsigned int height   = 0;
+    uint64_t     issued   = 0;
+  };
+  struct Streamed {
+    uint32_t             page;
+    std::vector<uint8_t> data;
+  };
+
+  std::optional<Asset> m_file;
+  const vtex::Header  *m_header    = nullptr;
+  uint32_t             m_cacheSide = 0;
+
+  GLuint m_physical  = 0;
+  GLuint m_pageTable = 0;
+  std::vector<std::vector<glm::u8vec4>> m_table; // by level: slot x, y, level, 255
+
+  // GL thread only
+  std::vector<uint32_t> m_slots;     // page in each slot
+  std::vector<uint32_t> m_slotOf;    // by page
+  std::vector<uint64_t> m_lastSeen;  // by page, feedback number
+  std::vector<bool>     m_requested; // by page: queued or streamed
+  uint64_t              m_nrFeedbacks = 0;
+  uint64_t              m_nrUploaded  = 0;
+
+  GLuint       m_feedbackFbo    = 0;
+  GLuint       m_feedbackColor  = 0;
+  GLuint       m_feedbackDepth  = 0;
+  unsigned int m_feedbackWidth  = 0;
+  unsigned int m_feedbackHeight = 0;
+  Readback     m_readbacks[NR_READBACKS];
+  uint64_t     m_nrIssued = 0;
+
+  // shared with the streaming thread
+  std::deque<uint32_t>    m_queue; // coarsest first
+  std::deque<Streamed>    m_streamed;
+  bool                    m_stop = false;
+  std::mutex              m_mutex;
+  std::condition_variable m_cv;
+  std::thread             m_thread;
+
+  uint32_t pageIndex(uint32_t level, uint32_t x, uint32_t y) const {
+    return vtex::firstPage(size(), level) + y * vtex::pagesPerSide(size(), level) + x;
+  }
+
+  std::span<const uint8_t> page(uint32_t index) const {
+    return { (const uint8_t *)m_file->data() + m_header->pages +
+                 (size_t)index * vtex::PAGE_BYTES,
+             vtex::PAGE_BYTES };
+  }
+
+  void stop() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+  void stream() {
+    while (true) {
+      uint32_t index;
+      {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop) {
+          return;
+        }
+        index = m_queue.front();
+        m_queue.pop_front();
+      }
+      // reading the mapping is what faults the page in from disk
+      auto     data = page(index);
+      Streamed streamed{ index, { data.begin(), data.end() } };
+      std::lock_guard lock(m_mutex);
+      m_streamed.push_back(std::move(streamed));
+    }
+  }
+
+  void resizeFeedback(unsigned int width, unsigned int height) {
+    m_feedbackWidth  = width;
+    m_feedbackHeight = height;
+    glDeleteFramebuffers(1, &m_feedbackFbo); // 0 silently ignored
+    glDeleteTextures(1, &m_feedbackColor);
+    glDeleteTextures(1, &m_feedbackDepth);
+
+    glGenTextures(1, &m_feedbackColor);
+    glBindTexture(GL_TEXTURE_2D, m_feedbackColor);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8UI, width, height);
+    glGenTextures(1, &m_feedbackDepth);
+    glBindTexture(GL_TEXTURE_2D, m_feedbackDepth);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_feedbackFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           m_feedbackColor, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                           m_feedbackDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "feedback framebuffer incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  /** marks the pages in the feedback (and their ancestors, which stand in for them)
+   * as seen, and queues the missing ones in place of what was queued. */
+  void request(std::span<const glm::u8vec4> feedback) {
+    uint64_t              seen = ++m_nrFeedbacks;
+    std::vector<uint32_t> missing;
+    for (auto texel : feedback) {
+      if (texel.a == 0 || texel.b >= nrLevels()) {
+        continue; // nothing drawn
+      }
+      uint32_t x = texel.r, y = texel.g;
+      for (uint32_t level = texel.b; level < nrLevels(); ++level, x /= 2, y /= 2) {
+        uint32_t n = vtex::pagesPerSide(size(), level);
+        if (x >= n || y >= n) {
+          break;
+        }
+        uint32_t index = pageIndex(level, x, y);
+        if (m_lastSeen[index] >= seen) {
+          break; // so were its ancestors
+        }
+        m_lastSeen[index] = seen;
+        if (m_slotOf[index] == NO_SLOT) {
+          missing.push_back(index);
+        }
+      }
+    }
+    // pages are numbered finest level first
+    std::ranges::sort(missing, std::greater<>());
+
+    std::lock_guard lock(m_mutex);
+    for (uint32_t index : m_queue) {
+      m_requested[index] = false;
+    }
+    m_queue.clear();
+    for (uint32_t index : missing) {
+      if (!m_requested[index]) {
+        m_requested[index] = true;
+        m_queue.push_back(index);
+      }
+    }
+    m_cv.notify_one();
+  }
+
+  /** copies data into a free slot, or the slot of the page seen least recently --
+   * unless that is in view too. */
+  bool upload(uint32_t index, std::span<const uint8_t> data) {
+    uint32_t slot = NO_SLOT;
+    for (uint32_t s = 0; s < m_slots.size(); ++s) {
+      if (m_slots[s] == NO_PAGE) {
+        slot = s;
+        break;
+      }
+      if (slot == NO_SLOT || m_lastSeen[m_slots[s]] < m_lastSeen[m_slots[slot]]) {
+        slot = s;
+      }
+    }
+    if (m_slots[slot] != NO_PAGE) {
+      if (m_lastSeen[m_slots[slot]] >= m_nrFeedbacks) {
+        return false;
+      }
+      m_slotOf[m_slots[slot]] = NO_SLOT;
+    }
+    m_slots[slot]  = index;
+    m_slotOf[index] = slot;
+
+    glBindTexture(GL_TEXTURE_2D, m_physical);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, slot % m_cacheSide * vtex::PAGE_TEXELS,
+                              slot / m_cacheSide * vtex::PAGE_TEXELS, vtex::PAGE_TEXELS,
+                              vtex::PAGE_TEXELS, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                              data.size(), data.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+  }
+
+  /** every page's entry: its own slot if resident, its parent's entry otherwise. */
+  void writePageTable() {
+    glBindTexture(GL_TEXTURE_2D, m_pageTable);
+    for (uint32_t level = nrLevels(); level-- > 0;) {
+      uint32_t n     = vtex::pagesPerSide(size(), level);
+      auto    &table = m_table[level];
+      for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+          uint32_t slot = m_slotOf[pageIndex(level, x, y)];
+          table[y * n + x] =
+              slot != NO_SLOT
+                  ? glm::u8vec4(slot % m_cacheSide, slot / m_cacheSide, level, 255)
+                  : m_table[level + 1][y / 2 * (n / 2) + x / 2];
+        }
+      }
+      glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, n, n, GL_RGBA, GL_UNSIGNED_BYTE,
+                      table.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Virtual texture files (.vtex): a texture's mip chain cut into pages of PAGE_SIZE x
+// PAGE_SIZE texels, BC1 compressed, so a virtual texture (see virtual_texture.h) can
+// stream in just the pages a view needs. tools/vtex_bake writes them.
+//
+//   Header
+//   pages   from offset pages, PAGE_BYTES each: level 0's, then level 1's, ..., each
+//           level's in rows from the bottom up
+//
+// Each page is stored with a border of PAGE_BORDER texels copied from its neighbours
+// (the level's edge texels repeat past it), so it filters on its own wherever it
+// lands in the cache. Textures are square, a power of two PAGE_SIZE or more texels
+// on a side, and their levels go down to a single page.
+
+namespace vtex {
+
+constexpr uint8_t  MAGIC[8]           = { 'L', 'V', 'T', 'E', 'X', 0, 0, 0 };
+constexpr uint32_t VERSION            = 1;
+constexpr uint32_t PAGE_SIZE          = 128;
+constexpr uint32_t PAGE_BORDER        = 4; // a whole BC1 block, so blocks stay aligned
+constexpr uint32_t PAGE_TEXELS        = PAGE_SIZE + 2 * PAGE_BORDER; // on a side
+constexpr uint32_t PAGE_BYTES         = (PAGE_TEXELS / 4) * (PAGE_TEXELS / 4) * 8;
+constexpr uint32_t MAX_PAGES_PER_SIDE = 256; // page coordinates fit in a byte
+
+struct Header {
+  uint8_t  magic[8];
+  uint32_t version;
+  uint32_t size; // texels on a side at level 0
+  uint32_t nrLevels;
+  uint32_t pageBytes;
+  uint64_t pages; // offset of the first page
+};
+
+inline bool validSize(uint32_t size) {
+  return size >= PAGE_SIZE && (size & (size - 1)) == 0 &&
+         size / PAGE_SIZE <= MAX_PAGES_PER_SIDE;
+}
+
+inline uint32_t levelCount(uint32_t size) {
+  uint32_t res = 1;
+  while ((PAGE_SIZE << (res - 1)) < size) {
+    ++res;
+  }
+  return res;
+}
+
+inline uint32_t pagesPerSide(uint32_t size, uint32_t level) {
+  return (size / PAGE_SIZE) >> level;
+}
+
+/** index of the first page of level, which is also the number of pages before it. */
+inline uint32_t firstPage(uint32_t size, uint32_t level) {
+  uint32_t res = 0;
+  for (uint32_t l = 0; l < level; ++l) {
+    res += pagesPerSide(size, l) * pagesPerSide(size, l);
+  }
+  return res;
+}
+
+/** where vtex_bake puts the pages of the image at path: next to it, in baked/. */
+inline std::string bakedPath(const std::string &path) {
+  auto p = std::filesystem::path(path);
+  return (p.parent_path() / "baked" / (p.filename().string() + ".vtex")).generic_string();
+}
+
+/** the header of the .vtex in in, if it is an intact one of this version. */
+inline const Header *header(std::string_view in) {
+  if (in.size() < sizeof(Header)) {
+    return nullptr;
+  }
+  const auto *h       = (const Header *)in.data();
+  uint64_t    nrPages = 0;
+  bool        ok      = std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                h->version == VERSION && validSize(h->size) &&
+                h->nrLevels == levelCount(h->size) && h->pageBytes == PAGE_BYTES;
+  if (ok) {
+    nrPages = firstPage(h->size, h->nrLevels);
+  }
+  return ok && h->pages + nrPages * PAGE_BYTES <= in.size() ? h : nullptr;
+}
+
+/** pages: every page of a texture size texels on a side, in file order. */
+inline void write(const std::string &path, uint32_t size,
+                  const std::vector<std::vector<uint8_t>> &pages) {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version   = VERSION;
+  header.size      = size;
+  header.nrLevels  = levelCount(size);
+  header.pageBytes = PAGE_BYTES;
+  header.pages     = 64;
+  if (!validSize(size) || pages.size() != firstPage(size, header.nrLevels)) {
+    throw std::runtime_error("not the pages of a virtual texture: " + path);
+  }
+
+  if (auto dir = std::filesystem::path(path).parent_path(); !dir.empty()) {
+    std::filesystem::create_directories(dir);
+  }
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char *)&header, sizeof(header));
+  file.write(std::string(header.pages - sizeof(header), '\0').data(),
+             header.pages - sizeof(header));
+  for (const auto &page : pages) {
+    if (page.size() != PAGE_BYTES) {
+      throw std::runtime_error("not the pages of a virtual texture: " + path);
+    }
+    file.write((const char *)page.data(), page.size());
+  }
+  if (!file) {
+    throw std::runtime_error("could not write " + path);
+  }
+}
+
+} // namespace vtex
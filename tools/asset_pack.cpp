@@ -0,0 +1,140 @@
+// Writes an asset pack (see file.h): the given files of the repo in one file, which
+// apps built with LEARNOPENGL2_ASSET_PACK read instead of the files themselves.
+//
+//   asset_pack [--zstd] output file...
+//
+// Files are relative to the repo root, or absolute within it. --zstd compresses the
+// files it shrinks by at least an eighth (needs a build with LEARNOPENGL2_ZSTD);
+// the rest, and everything without it, are stored as is, to be used in place.
+
+#include "file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+static size_t align(size_t n) {
+  return (n + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+int main(int argc, char **argv) {
+  bool                     zstd = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--zstd") {
+      zstd = true;
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() < 2) {
+    std::cerr << "usage: asset_pack [--zstd] output file..." << std::endl;
+    return 2;
+  }
+#ifndef LEARNOPENGL2_ZSTD
+  if (zstd) {
+    std::cerr << "asset_pack: built without zstd, storing files as is" << std::endl;
+    zstd = false;
+  }
+#endif
+
+  // names relative to the root, as apps ask for them
+  std::vector<std::string> names;
+  for (size_t i = 1; i < args.size(); ++i) {
+    auto path = std::filesystem::path(args[i]);
+    if (path.is_absolute()) {
+      path = std::filesystem::relative(path, ROOT);
+    }
+    auto name = path.lexically_normal().generic_string();
+    if (name.starts_with("..")) {
+      std::cerr << "asset_pack: " << args[i] << " is outside the repo" << std::endl;
+      return 1;
+    }
+    names.push_back(name);
+  }
+  std::ranges::sort(names);
+  auto [last, end] = std::ranges::unique(names);
+  names.erase(last, end);
+
+  std::vector<PackEntry>   entries;
+  std::vector<std::string> data; // stored, by entry
+  std::string              namesBlock;
+  uint64_t                 totalSize = 0;
+  for (const auto &name : names) {
+    auto      file = MappedFile(ROOT + name, true);
+    PackEntry entry{ .hash        = packHash(name),
+                     .offset      = 0,
+                     .size        = file.size(),
+                     .storedSize  = file.size(),
+                     .name        = namesBlock.size(),
+                     .nameSize    = (uint32_t)name.size(),
+                     .compression = PACK_STORED };
+    std::string stored(file.view());
+#ifdef LEARNOPENGL2_ZSTD
+    if (zstd && file.size() > 0) {
+      std::string compressed(ZSTD_compressBound(file.size()), '\0');
+      auto        n = ZSTD_compress(compressed.data(), compressed.size(), file.data(),
+                                    file.size(), 19);
+      if (!ZSTD_isError(n) && n <= file.size() - file.size() / 8) {
+        compressed.resize(n);
+        stored            = std::move(compressed);
+        entry.storedSize  = n;
+        entry.compression = PACK_ZSTD;
+      }
+    }
+#endif
+    namesBlock += name;
+    totalSize  += file.size();
+    entries.push_back(entry);
+    data.push_back(std::move(stored));
+  }
+
+  // entries sorted by hash, and their data in name order after the names
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, {}, [&](size_t i) { return entries[i].hash; });
+
+  PackHeader header{};
+  std::copy(std::begin(PACK_MAGIC), std::end(PACK_MAGIC), header.magic);
+  header.version   = PACK_VERSION;
+  header.nrEntries = entries.size();
+  header.names     = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+  header.namesSize = namesBlock.size();
+  uint64_t offset  = align(header.names + header.namesSize);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    entries[i].offset = offset;
+    offset            = align(offset + entries[i].storedSize);
+  }
+
+  std::string out(offset, '\0');
+  std::memcpy(out.data(), &header, sizeof(header));
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::memcpy(out.data() + sizeof(header) + i * sizeof(PackEntry), &entries[order[i]],
+                sizeof(PackEntry));
+  }
+  std::ranges::copy(namesBlock, out.begin() + header.names);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    std::ranges::copy(data[i], out.begin() + entries[i].offset);
+  }
+
+  auto output = std::filesystem::path(args[0]);
+  if (output.has_parent_path()) {
+    std::filesystem::create_directories(output.parent_path());
+  }
+  std::ofstream file(output, std::ios::binary);
+  file.write(out.data(), out.size());
+  if (!file) {
+    std::cerr << "asset_pack: could not write " << args[0] << std::endl;
+    return 1;
+  }
+  std::cout << args[0] << ": " << entries.size() << " files, " << totalSize
+            << " bytes -> " << out.size() << std::endl;
+  return 0;
+}
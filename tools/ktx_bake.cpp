@@ -0,0 +1,89 @@
+// Bakes an image into a KTX2 container: a precomputed mip chain, block compressed.
+//
+//   ktx_bake [--linear] [--no-flip] input output
+//
+// Mips are box filtered from the level above in linear light (unless --linear says
+// the texels are data, eg: a specular mask, not srgb colors), with color weighted by
+// alpha so transparent texels don't bleed into their neighbours. Colors become BC7;
+// data becomes BC3 if it has any alpha below 255, BC1 otherwise. Rows are stored
+// bottom up unless --no-flip, which matches stbi_set_flip_vertically_on_load(true) at
+// runtime.
+
+#include <glm/glm.hpp>
+
+#include "bc.h"
+#include "image.h"
+#include "ktx2.h"
+#include "mips.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  bool                     linear = false;
+  bool                     flip   = true;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--linear") {
+      linear = true;
+    } else if (arg == "--no-flip") {
+      flip = false;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << "usage: ktx_bake [--linear] [--no-flip] input output" << std::endl;
+    return 2;
+  }
+
+  stbi_set_flip_vertically_on_load(flip);
+  int            width, height, nrChannels;
+  unsigned char *pixels = stbi_load(paths[0].c_str(), &width, &height, &nrChannels, 4);
+  if (pixels == nullptr) {
+    std::cerr << "could not load image: " << paths[0] << std::endl;
+    return 1;
+  }
+  Level level{ (uint32_t)width, (uint32_t)height, {} };
+  level.texels.resize((size_t)width * height);
+  std::memcpy(level.texels.data(), pixels, level.texels.size() * 4);
+  stbi_image_free(pixels);
+
+  bool     alpha  = std::ranges::any_of(level.texels, [](auto t) { return t.a < 255; });
+  uint32_t format = !linear ? bc::BC7 : alpha ? bc::BC3 : bc::BC1;
+  ktx2::Texture texture{
+    .vkFormat    = format == bc::BC7   ? ktx2::BC7_SRGB
+                   : format == bc::BC3 ? ktx2::BC3_UNORM
+                                       : ktx2::BC1_RGB_UNORM,
+    .width       = level.width,
+    .height      = level.height,
+    .orientation = flip ? "ru" : "rd",
+    .levels      = {},
+  };
+
+  ThreadPool pool;
+  while (true) {
+    texture.levels.push_back(
+        bc::encode(level.texels.data(), level.width, level.height, format, pool));
+    if (level.width == 1 && level.height == 1) {
+      break;
+    }
+    level = downsample(level, linear, pool);
+  }
+  ktx2::write(paths[1], texture);
+
+  size_t size = 0;
+  for (auto &l : texture.levels) {
+    size += l.size();
+  }
+  std::cout << paths[0] << ": " << width << "x" << height << ", "
+            << texture.levels.size() << " levels, BC" << format << ", "
+            << size << " bytes" << std::endl;
+  return 0;
+}
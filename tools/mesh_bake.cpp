@@ -0,0 +1,82 @@
+// Imports models and writes their lmesh caches ahead of time (see mesh_cache.h), so
+// the first run of an app doesn't pay for the import.
+//
+//   mesh_bake [--packed] model...
+//
+// Models are relative to the repo root. --packed writes caches of PackedVertex (see
+// vertex_pack.h) instead, and reports the largest error packing introduced: in
+// positions relative to their submesh's extent, in normals as an angle.
+
+#include <glm/glm.hpp>
+
+#include "mesh_cache.h"
+#include "vertex_pack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  bool                     packed = false;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--packed") {
+      packed = true;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.empty()) {
+    std::cerr << "usage: mesh_bake [--packed] model..." << std::endl;
+    return 2;
+  }
+
+  for (const auto &path : paths) {
+    auto source = ROOT + path;
+    auto size   = std::filesystem::file_size(source);
+    auto mtime  = std::filesystem::last_write_time(source).time_since_epoch().count();
+    auto model  = lmesh::import(path);
+    lmesh::write(ROOT + lmesh::cachePath(path, packed), model, size, mtime, packed);
+
+    auto vertexBytes = model.vertices.size() * sizeof(lmesh::Vertex);
+    std::cout << path << ": " << model.vertices.size() << " vertices, "
+              << model.indices.size() / 3 << " triangles, " << vertexBytes << " bytes";
+    if (!packed) {
+      std::cout << std::endl;
+      continue;
+    }
+
+    auto  packedVertices = lmesh::pack(model);
+    float posError       = 0.0f; // relative to the extent
+    float normalCos      = 1.0f; // of the largest angle
+    for (size_t s = 0; s < model.submeshes.size(); ++s) {
+      auto     dequantize = lmesh::dequantize(model.submeshes[s]);
+      float    extent     = std::max({ dequantize.scale.x, dequantize.scale.y,
+                                       dequantize.scale.z, 1e-20f });
+      uint32_t begin      = model.submeshes[s].baseVertex;
+      uint32_t end        = s + 1 < model.submeshes.size()
+                                ? model.submeshes[s + 1].baseVertex
+                                : model.vertices.size();
+      for (uint32_t v = begin; v < end; ++v) {
+        const auto &vertex = model.vertices[v];
+        glm::vec3   pos, normal;
+        glm::vec2   tex;
+        unpackVertex(packedVertices[v], dequantize, pos, tex, normal);
+        posError = std::max(posError, glm::length(pos - vertex.pos) / extent);
+        if (glm::dot(vertex.normal, vertex.normal) > 0.0f) {
+          float cos = glm::dot(glm::normalize(vertex.normal), normal);
+          normalCos = std::min(normalCos, cos);
+        }
+      }
+    }
+    float normalError = glm::degrees(std::acos(std::clamp(normalCos, -1.0f, 1.0f)));
+    std::cout << " -> " << packedVertices.size() * sizeof(PackedVertex)
+              << " packed, max error: position " << posError << ", normal "
+              << normalError << " degrees" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Bakes an image into the pages of a virtual texture (see vtex.h).
+//
+//   vtex_bake [--repeat n] input output
+//
+// --repeat tiles the image n x n times first, to make a texture larger than the
+// image -- the texture must come out a square power of two of at least PAGE_SIZE
+// texels. Mips are filtered as for ktx_bake, in linear light, and rows are stored
+// bottom up.
+
+#include <glm/glm.hpp>
+
+#include "bc.h"
+#include "image.h"
+#include "mips.h"
+#include "thread_pool.h"
+#include "vtex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  uint32_t                 repeat = 1;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--repeat" && i + 1 < argc) {
+      repeat = std::max(1, std::stoi(argv[++i]));
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << "usage: vtex_bake [--repeat n] input output" << std::endl;
+    return 2;
+  }
+
+  stbi_set_flip_vertically_on_load(true);
+  int            width, height, nrChannels;
+  unsigned char *pixels = stbi_load(paths[0].c_str(), &width, &height, &nrChannels, 4);
+  if (pixels == nullptr) {
+    std::cerr << "could not load image: " << paths[0] << std::endl;
+    return 1;
+  }
+  uint32_t size = width * repeat;
+  if (width != height || !vtex::validSize(size)) {
+    std::cerr << paths[0] << ": " << width << "x" << height << " repeated " << repeat
+              << " times is not a square power of two of " << vtex::PAGE_SIZE << " to "
+              << vtex::PAGE_SIZE * vtex::MAX_PAGES_PER_SIDE << " texels" << std::endl;
+    stbi_image_free(pixels);
+    return 1;
+  }
+  Level level{ size, size, {} };
+  level.texels.resize((size_t)size * size);
+  auto *image = (const glm::u8vec4 *)pixels;
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      level.texels[(size_t)y * size + x] = image[(y % height) * width + x % width];
+    }
+  }
+  stbi_image_free(pixels);
+
+  ThreadPool                        pool;
+  std::vector<std::vector<uint8_t>> pages;
+  std::vector<glm::u8vec4>          page(vtex::PAGE_TEXELS * vtex::PAGE_TEXELS);
+  uint32_t                          nrLevels = vtex::levelCount(size);
+  for (uint32_t l = 0; l < nrLevels; ++l) {
+    uint32_t n = vtex::pagesPerSide(size, l);
+    for (uint32_t py = 0; py < n; ++py) {
+      for (uint32_t px = 0; px < n; ++px) {
+        for (uint32_t y = 0; y < vtex::PAGE_TEXELS; ++y) {
+          for (uint32_t x = 0; x < vtex::PAGE_TEXELS; ++x) {
+            // the page's texels and its border, the level's edges repeating
+            int64_t lx = (int64_t)(px * vtex::PAGE_SIZE + x) - vtex::PAGE_BORDER;
+            int64_t ly = (int64_t)(py * vtex::PAGE_SIZE + y) - vtex::PAGE_BORDER;
+            lx         = std::clamp<int64_t>(lx, 0, level.width - 1);
+            ly         = std::clamp<int64_t>(ly, 0, level.height - 1);
+            page[y * vtex::PAGE_TEXELS + x] = level.texels[ly * level.width + lx];
+          }
+        }
+        pages.push_back(bc::encode(page.data(), vtex::PAGE_TEXELS, vtex::PAGE_TEXELS,
+                                   bc::BC1, pool));
+      }
+    }
+    if (l + 1 < nrLevels) {
+      level = downsample(level, false, pool);
+    }
+  }
+  vtex::write(paths[1], size, pages);
+
+  std::cout << paths[0] << ": " << size << "x" << size << ", " << nrLevels << " levels, "
+            << pages.size() << " pages, " << pages.size() * vtex::PAGE_BYTES << " bytes"
+            << std::endl;
+  return 0;
+}